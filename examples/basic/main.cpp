@@ -13,6 +13,7 @@
 #include <coffee/core/CDebug>
 #include <coffee/imgui/graphics_widgets.h>
 #include <coffee/imgui/imgui_binding.h>
+#include <coffee/imgui/imgui_textures.h>
 #include <imgui.h>
 
 #if defined(FEATURE_ENABLE_ASIO)
@@ -21,11 +22,7 @@
 
 using namespace Coffee;
 
-#if defined(COFFEE_IMGUI_USE_GLEAM)
-using GFX = RHI::GLEAM::GLEAM_API;
-#else
-using GFX = RHI::NullAPI;
-#endif
+using GFX = CImGui::ImGuiAPI;
 
 struct RData
 {
@@ -108,6 +105,7 @@ void cleanup(
     data.input.resize(0);
 
     CImGui::Shutdown();
+    CImGui::ReleaseProgramCache();
 
     data.load_api = nullptr;
     GFX::UnloadAPI();
@@ -0,0 +1,631 @@
+/* Benchmarks of the binding's hot paths, rendered through the NullAPI so no
+ *  GPU work is measured or required:
+ *
+ *  ImGuiBench [output.json] [frames]
+ *
+ * Every scene runs a few warm-up frames and then `frames` timed frames,
+ *  split into CImGui::NewFrame(), the widgets, ImGui::Render() and the
+ *  renderer. The last frame of every scene is then rasterised by the
+ *  SoftwareRenderer, and submitted once with scissor clipping and once with
+ *  RenderFlag_ShaderClip to compare their draw calls, and once with
+ *  RenderFlag_QuantizedVertices to compare uploads. It is submitted twice
+ *  with RenderFlag_RetainedLists to check that nothing is re-uploaded.
+ *  The dashboard scene is rendered with and without RenderFlag_Primitives
+ *  to compare uploads, and with RenderFlag_DeferredSubmit to time the
+ *  snapshot handed to SubmitPendingFrame().
+ *  The font atlas is built as a bitmap and as an SDF.
+ * Results are written as JSON, to stdout without an output path.
+ */
+
+#include <coffee/core/CApplication>
+
+#include <coffee/comp_app/app_wrap.h>
+#include <coffee/comp_app/bundle.h>
+#include <coffee/comp_app/subsystems.h>
+#include <coffee/core/input/eventhandlers.h>
+#include <coffee/core/platform_data.h>
+#include <coffee/graphics/apis/CGLeamRHI>
+
+#include <coffee/imgui/imgui_binding.h>
+#include <coffee/imgui/imgui_capture.h>
+#include <coffee/imgui/imgui_primitives.h>
+#include <coffee/imgui/imgui_software.h>
+#include <coffee/imgui/imgui_textures.h>
+#include <imgui.h>
+
+#include "imgui_primitive_stream.h"
+#include "imgui_sdf.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace Coffee;
+
+using GFX         = RHI::NullAPI;
+using bench_clock = Chrono::high_resolution_clock;
+
+static constexpr u32 warmup_frames = 10;
+
+static cstring bench_output = nullptr;
+static u32     bench_frames = 200;
+
+struct Result
+{
+    CString scene;
+    CString stage;
+
+    /* Nanoseconds per run, or empty for results with values */
+    Vector<i64> samples;
+
+    /* Named values, eg. throughput per second or counts */
+    Vector<Pair<cstring, f64>> values;
+};
+
+struct RData
+{
+    GFX::API_CONTEXT load_api;
+    Vector<Result>   results;
+};
+
+struct Scene
+{
+    cstring name;
+    void (*draw)(u32 frame);
+};
+
+static void SceneWindows(u32 frame)
+{
+    static f32 values[64] = {};
+
+    for(int i = 0; i < 64; i++)
+    {
+        char title[32];
+        std::snprintf(title, sizeof(title), "Window %i", i);
+
+        ImGui::SetNextWindowPos(ImVec2((i % 8) * 120.f, (i / 8) * 90.f));
+        ImGui::SetNextWindowSize(ImVec2(160.f, 120.f));
+
+        ImGui::Begin(title);
+        ImGui::Text("Frame %u", frame);
+        ImGui::Button("Button");
+        ImGui::SliderFloat("Value", &values[i], 0.f, 1.f);
+        ImGui::Separator();
+        ImGui::Text("%i: %.3f", i, values[i]);
+        ImGui::End();
+    }
+}
+
+static void SceneTable(u32 frame)
+{
+    ImGui::SetNextWindowPos(ImVec2(0.f, 0.f));
+    ImGui::SetNextWindowSize(ImVec2(1024.f, 768.f));
+
+    ImGui::Begin("Table");
+    ImGui::Columns(8, "table");
+
+    for(u32 row = 0; row < 400; row++)
+        for(u32 column = 0; column < 8; column++)
+        {
+            ImGui::Text("%u:%u %u", row, column, frame + row * column);
+            ImGui::NextColumn();
+        }
+
+    ImGui::Columns(1);
+    ImGui::End();
+}
+
+static void SceneText(u32)
+{
+    static CString text;
+
+    if(text.empty())
+        for(u32 i = 0; i < 400; i++)
+            text += "The quick brown fox jumps over the lazy dog, "
+                    "sphinx of black quartz, judge my vow. ";
+
+    ImGui::SetNextWindowPos(ImVec2(0.f, 0.f));
+    ImGui::SetNextWindowSize(ImVec2(1024.f, 768.f));
+
+    ImGui::Begin("Text");
+    ImGui::PushTextWrapPos(0.f);
+    ImGui::TextUnformatted(text.c_str(), text.c_str() + text.size());
+    ImGui::PopTextWrapPos();
+    ImGui::End();
+}
+
+static void ScenePlots(u32 frame)
+{
+    static f32 points[2048];
+
+    for(u32 i = 0; i < 2048; i++)
+        points[i] = std::sin((i + frame) * 0.05f) * std::cos(i * 0.013f);
+
+    ImGui::SetNextWindowPos(ImVec2(0.f, 0.f));
+    ImGui::SetNextWindowSize(ImVec2(1024.f, 768.f));
+
+    ImGui::Begin("Plots");
+
+    for(int i = 0; i < 16; i++)
+    {
+        char label[32];
+        std::snprintf(label, sizeof(label), "Plot %i", i);
+
+        ImGui::PlotLines(
+            label, points, 2048, 0, nullptr, -1.f, 1.f, ImVec2(0.f, 40.f));
+    }
+
+    ImGui::End();
+}
+
+/* Rounded panels with outlines and indicators, through imgui_primitives.h */
+static void SceneDashboard(u32 frame)
+{
+    ImGui::SetNextWindowPos(ImVec2(0.f, 0.f));
+    ImGui::SetNextWindowSize(ImVec2(1024.f, 768.f));
+
+    ImGui::Begin("Dashboard");
+
+    auto       list   = ImGui::GetWindowDrawList();
+    const auto origin = ImGui::GetCursorScreenPos();
+    const auto white  = IM_COL32(255, 255, 255, 255);
+
+    for(u32 i = 0; i < 512; i++)
+    {
+        const f32    x = origin.x + (i % 32) * 31.f;
+        const f32    y = origin.y + (i / 32) * 44.f;
+        const ImVec2 a(x, y);
+        const ImVec2 b(x + 28.f, y + 40.f);
+
+        const auto col = IM_COL32(40 + (i * 7 + frame) % 200, 120, 200, 255);
+
+        CImGui::AddRectFilled(list, a, b, col, 6.f);
+        CImGui::AddRect(list, a, b, white, 6.f);
+        CImGui::AddCircleFilled(list, ImVec2(x + 14.f, y + 14.f), 8.f, white);
+    }
+
+    ImGui::End();
+}
+
+static const Scene bench_scenes[] = {
+    {"windows", SceneWindows},
+    {"table", SceneTable},
+    {"text", SceneText},
+    {"plots", ScenePlots},
+    {"dashboard", SceneDashboard},
+};
+
+static i64 Elapsed(bench_clock::time_point const& start)
+{
+    const auto elapsed = bench_clock::now() - start;
+
+    return Chrono::duration_cast<Chrono::nanoseconds>(elapsed).count();
+}
+
+/* Flags which read every frame from scratch */
+static u32 UncachedFlags(u32 flags)
+{
+    return flags &
+           ~(CImGui::RenderFlag_SkipUnchanged | CImGui::RenderFlag_LayerCache);
+}
+
+static void RecreateDevice(u32 flags)
+{
+    CImGui::imgui_error_code ec;
+
+    CImGui::DestroyDeviceObjects<GFX>();
+    CImGui::SetRenderFlags(flags);
+
+    if(!CImGui::CreateDeviceObjects<GFX>(ec))
+        std::fprintf(stderr, "failed to recreate ImGui device objects\n");
+}
+
+/* Recreates the device objects with `flags` and submits the first frame of
+ *  `capture` */
+static CImGui::RenderStats SubmitWithFlags(
+    CImGui::DrawCapture& capture, u32 flags)
+{
+    RecreateDevice(flags);
+    CImGui::RenderDrawData<GFX>(capture.frame(0));
+
+    return CImGui::GetRenderStats<GFX>();
+}
+
+static void RunScene(
+    Components::EntityContainer& r, RData& data, Scene const& scene)
+{
+    ImGuiIO& io = ImGui::GetIO();
+
+    /* Render() only builds the draw data, the renderer is timed apart */
+    io.RenderDrawListsFn = nullptr;
+
+    Result stages[4] = {
+        {scene.name, "new_frame"},
+        {scene.name, "widgets"},
+        {scene.name, "render"},
+        {scene.name, "render_draw_lists"},
+    };
+
+    CImGui::DrawCapture capture;
+
+    for(u32 i = 0; i < warmup_frames + bench_frames; i++)
+    {
+        const bool timed = i >= warmup_frames;
+
+        auto start = bench_clock::now();
+        CImGui::NewFrame(r);
+        const auto new_frame = Elapsed(start);
+
+        start = bench_clock::now();
+        scene.draw(i);
+        const auto widgets = Elapsed(start);
+
+        start = bench_clock::now();
+        ImGui::Render();
+        const auto render = Elapsed(start);
+
+        auto draw_data = ImGui::GetDrawData();
+
+        if(i + 1 == warmup_frames + bench_frames)
+            capture.record(draw_data, &CImGui::detail::FramePrimitives());
+
+        start = bench_clock::now();
+        CImGui::RenderDrawData<GFX>(draw_data);
+        const auto draw_lists = Elapsed(start);
+
+        if(!timed)
+            continue;
+
+        stages[0].samples.push_back(new_frame);
+        stages[1].samples.push_back(widgets);
+        stages[2].samples.push_back(render);
+        stages[3].samples.push_back(draw_lists);
+    }
+
+    for(auto& stage : stages)
+        data.results.push_back(std::move(stage));
+
+    /* Software rasterisation of the last frame */
+    int            width, height;
+    unsigned char* pixels;
+    io.Fonts->GetTexDataAsAlpha8(&pixels, &width, &height);
+
+    CImGui::SoftwareRenderer software;
+    software.addTexture(
+        io.Fonts->TexID,
+        {pixels, C_CAST<u32>(width), C_CAST<u32>(height), true});
+
+    Result raster    = {scene.name, "software"};
+    u64    triangles = 0, covered = 0;
+    i64    total     = 0;
+
+    for(u32 i = 0; i < bench_frames; i++)
+    {
+        auto draw_data = capture.frame(0);
+
+        auto start = bench_clock::now();
+        software.render(draw_data);
+        total += Elapsed(start);
+
+        triangles += software.stats().triangles;
+        covered += software.stats().pixels;
+    }
+
+    if(total > 0)
+        raster.values = {{"triangles_per_s", triangles * 1e9 / total},
+                         {"pixels_per_s", covered * 1e9 / total}};
+
+    data.results.push_back(std::move(raster));
+
+    /* Draw calls of the last frame with either clipping method */
+    const auto flags = CImGui::GetRenderFlags();
+    const auto base  = UncachedFlags(flags);
+
+    const auto scissor = SubmitWithFlags(capture, base);
+    const auto shader  = SubmitWithFlags(
+        capture, base | CImGui::RenderFlag_ShaderClip);
+
+    /* Batched lists share their vertices, and merge across lists */
+    const auto batched = SubmitWithFlags(
+        capture,
+        (base & ~CImGui::RenderFlag_ShaderClip) |
+            CImGui::RenderFlag_BatchUpload);
+
+    Result clip = {scene.name, "clip_draws"};
+    clip.values = {{"draws_before", scissor.draws_before},
+                   {"scissor_draws", scissor.draws_after},
+                   {"scissor_runs", scissor.draw_runs},
+                   {"batched_draws", batched.draws_after},
+                   {"batched_runs", batched.draw_runs},
+                   {"shader_clip_draws", shader.draws_after},
+                   {"shader_clip_runs", shader.draw_runs}};
+
+    data.results.push_back(std::move(clip));
+
+    /* Upload size of the last frame with either vertex format */
+    const auto plain     = base & ~CImGui::RenderFlag_ShaderClip;
+    const auto unpacked  = SubmitWithFlags(capture, plain);
+    const auto quantized = SubmitWithFlags(
+        capture, plain | CImGui::RenderFlag_QuantizedVertices);
+
+    Result upload = {scene.name, "vertex_upload"};
+    upload.values = {{"float_bytes", unpacked.upload_bytes},
+                     {"quantized_bytes", quantized.upload_bytes},
+                     {"bytes_saved", quantized.quantized_bytes_saved},
+                     {"fallbacks", quantized.quantize_fallbacks}};
+
+    data.results.push_back(std::move(upload));
+
+    /* The same frame again with retained lists, which uploads nothing */
+    const auto first = SubmitWithFlags(
+        capture, plain | CImGui::RenderFlag_RetainedLists);
+    CImGui::RenderDrawData<GFX>(capture.frame(0));
+    const auto again = CImGui::GetRenderStats<GFX>();
+
+    Result retained = {scene.name, "retained_lists"};
+    retained.values = {{"first_bytes", first.retained_bytes_uploaded},
+                       {"reused_bytes", again.retained_bytes_reused},
+                       {"uploaded_bytes", again.retained_bytes_uploaded},
+                       {"reused_lists", again.retained_lists_reused}};
+
+    data.results.push_back(std::move(retained));
+
+    SubmitWithFlags(capture, flags);
+}
+
+/* Uploads of the dashboard, tessellated and as primitive instances. The
+ *  records are only made while the widgets run, so frames are live. */
+static void RunPrimitives(Components::EntityContainer& r, RData& data)
+{
+    const auto flags = CImGui::GetRenderFlags();
+    const auto base  = UncachedFlags(flags) & ~CImGui::RenderFlag_Primitives;
+
+    Result result = {"dashboard", "primitives"};
+
+    for(auto primitives : {false, true})
+    {
+        RecreateDevice(
+            primitives ? base | CImGui::RenderFlag_Primitives : base);
+
+        for(u32 i = 0; i < warmup_frames; i++)
+        {
+            CImGui::NewFrame(r);
+            SceneDashboard(i);
+            ImGui::Render();
+            CImGui::RenderDrawData<GFX>(ImGui::GetDrawData());
+        }
+
+        auto const& stats = CImGui::GetRenderStats<GFX>();
+
+        if(primitives)
+        {
+            result.values.push_back({"instanced_bytes", stats.upload_bytes});
+            result.values.push_back({"instances", stats.primitive_instances});
+            result.values.push_back(
+                {"instanced_draws", stats.draws_after + stats.primitive_draws});
+        } else
+        {
+            result.values.push_back(
+                {"tessellated_bytes", stats.upload_bytes});
+            result.values.push_back({"tessellated_draws", stats.draws_after});
+        }
+    }
+
+    RecreateDevice(flags);
+
+    data.results.push_back(std::move(result));
+}
+
+/* The dashboard with RenderFlag_DeferredSubmit, as time spent handing
+ *  the frame over in EndFrame() and submitting it. Both run on this
+ *  thread, so nothing overlaps and every frame is drawn. */
+static void RunDeferred(Components::EntityContainer& r, RData& data)
+{
+    const auto flags = CImGui::GetRenderFlags();
+
+    RecreateDevice(UncachedFlags(flags) | CImGui::RenderFlag_DeferredSubmit);
+
+    /* Marks the device objects ready for NewFrame() */
+    CImGui::SubmitPendingFrame();
+
+    Result publish = {"dashboard", "deferred_publish"};
+    Result submit  = {"dashboard", "deferred_submit"};
+
+    for(u32 i = 0; i < warmup_frames + bench_frames; i++)
+    {
+        CImGui::NewFrame(r);
+        SceneDashboard(i);
+
+        auto start = bench_clock::now();
+        CImGui::EndFrame();
+        const auto published = Elapsed(start);
+
+        start = bench_clock::now();
+        CImGui::SubmitPendingFrame();
+        const auto submitted = Elapsed(start);
+
+        if(i < warmup_frames)
+            continue;
+
+        publish.samples.push_back(published);
+        submit.samples.push_back(submitted);
+    }
+
+    RecreateDevice(flags);
+
+    data.results.push_back(std::move(publish));
+    data.results.push_back(std::move(submit));
+}
+
+/* Bitmap atlas as built by ImGui, and the same atlas converted to an SDF */
+static void RunAtlas(RData& data)
+{
+    Result bitmap = {"atlas", "bitmap"};
+    Result sdf    = {"atlas", "sdf"};
+
+    CImGui::detail::SdfScratch scratch;
+    Vector<u8>                 field;
+
+    for(u32 i = 0; i < 10; i++)
+    {
+        ImFontAtlas atlas;
+        atlas.AddFontDefault();
+
+        int            width, height;
+        unsigned char* pixels;
+
+        auto start = bench_clock::now();
+        atlas.GetTexDataAsAlpha8(&pixels, &width, &height);
+        const auto build = Elapsed(start);
+
+        field.resize(C_CAST<szptr>(width * height));
+
+        start = bench_clock::now();
+        CImGui::detail::GenerateSdf(
+            pixels,
+            C_CAST<u32>(width),
+            C_CAST<u32>(height),
+            CImGui::detail::sdf_spread,
+            field.data(),
+            scratch);
+        const auto convert = Elapsed(start);
+
+        bitmap.samples.push_back(build);
+        sdf.samples.push_back(build + convert);
+    }
+
+    data.results.push_back(std::move(bitmap));
+    data.results.push_back(std::move(sdf));
+}
+
+static void WriteResults(RData const& data)
+{
+    auto out = bench_output ? std::fopen(bench_output, "w") : stdout;
+
+    if(!out)
+    {
+        std::fprintf(stderr, "failed to open %s\n", bench_output);
+        return;
+    }
+
+    std::fprintf(
+        out,
+        "{\n  \"version\": \"%s\",\n  \"frames\": %u,\n  \"results\": [",
+        COFFEE_IMGUI_VERSION,
+        bench_frames);
+
+    for(szptr i = 0; i < data.results.size(); i++)
+    {
+        auto const& result = data.results[i];
+
+        std::fprintf(
+            out,
+            "%s\n    {\"scene\": \"%s\", \"stage\": \"%s\"",
+            i ? "," : "",
+            result.scene.c_str(),
+            result.stage.c_str());
+
+        if(result.samples.empty())
+        {
+            for(auto const& value : result.values)
+                std::fprintf(out, ", \"%s\": %.0f", value.first, value.second);
+
+            std::fprintf(out, "}");
+        } else
+        {
+            auto samples = result.samples;
+            std::sort(samples.begin(), samples.end());
+
+            f64 sum = 0.;
+            for(auto sample : samples)
+                sum += sample;
+
+            std::fprintf(
+                out,
+                ", \"min_us\": %.3f, \"median_us\": %.3f, \"mean_us\": %.3f, "
+                "\"max_us\": %.3f}",
+                samples.front() / 1e3,
+                samples[samples.size() / 2] / 1e3,
+                sum / samples.size() / 1e3,
+                samples.back() / 1e3);
+        }
+    }
+
+    std::fprintf(out, "\n  ]\n}\n");
+
+    if(out != stdout)
+        std::fclose(out);
+}
+
+void setup(
+    Components::EntityContainer& r, RData& data, Components::time_point const&)
+{
+    auto& windowing = *r.service<comp_app::Windowing>();
+
+    data.load_api = GFX::GetLoadAPI();
+
+    CImGui::imgui_error_code ec;
+
+    if(!data.load_api(PlatformData::IsDebug()) ||
+       !CImGui::CreateDeviceObjects(ec))
+    {
+        std::fprintf(stderr, "failed to create ImGui device objects\n");
+        windowing.close();
+    }
+}
+
+void loop(
+    Components::EntityContainer& r,
+    RData&                       data,
+    Components::time_point const&,
+    Components::duration const&)
+{
+    if(!data.results.empty())
+        return;
+
+    for(auto const& scene : bench_scenes)
+        RunScene(r, data, scene);
+
+    RunPrimitives(r, data);
+    RunDeferred(r, data);
+    RunAtlas(data);
+    WriteResults(data);
+
+    r.service<comp_app::Windowing>()->close();
+}
+
+void cleanup(
+    Components::EntityContainer&, RData& data, Components::time_point const&)
+{
+    CImGui::Shutdown();
+    CImGui::ReleaseProgramCache();
+
+    data.load_api = nullptr;
+    GFX::UnloadAPI();
+}
+
+int32 coffeeimgui_bench(int32 argc, cstring_w* argv)
+{
+    if(argc > 1)
+        bench_output = argv[1];
+    if(argc > 2)
+        bench_frames =
+            std::max(C_CAST<u32>(std::strtoul(argv[2], nullptr, 10)), 1u);
+
+    auto& container = comp_app::createContainer();
+    auto& loader    = comp_app::AppLoader::register_service(container);
+    comp_app::configureDefaults(loader);
+
+    comp_app::app_error ec;
+    comp_app::addDefaults(container, loader, ec);
+
+    comp_app::AppContainer<RData>::addTo(container, setup, loop, cleanup);
+
+    CImGui::UseBackend<GFX>();
+    CImGui::Init(container);
+
+    return comp_app::ExecLoop<comp_app::BundleData>::exec(container);
+}
+
+COFFEE_APPLICATION_MAIN(coffeeimgui_bench)
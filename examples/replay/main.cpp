@@ -0,0 +1,361 @@
+/* Replays a draw data capture made with CImGui::StartCapture():
+ *
+ *  ImGuiReplay <capture> [passes] [render flags]
+ *
+ * Every frame of the capture is submitted once per pass, one pass per
+ *  application frame, and the CPU time spent in the renderer is reported
+ *  per captured frame. Rebuilding the ImDrawData is not counted.
+ * With RenderFlag_QuantizedVertices in the render flags, every frame is
+ *  first rasterised by the SoftwareRenderer as captured and as read back
+ *  from quantised vertices. Quantisation must not change any vertex or
+ *  pixel, the replay fails otherwise.
+ * With RenderFlag_RetainedLists, the bytes of lists reused and uploaded in
+ *  the first pass are reported.
+ */
+
+#include <coffee/core/CApplication>
+
+#include <coffee/comp_app/app_wrap.h>
+#include <coffee/comp_app/bundle.h>
+#include <coffee/comp_app/subsystems.h>
+#include <coffee/core/input/eventhandlers.h>
+#include <coffee/core/platform_data.h>
+#include <coffee/graphics/apis/CGLeamRHI>
+
+#include <coffee/imgui/imgui_binding.h>
+#include <coffee/imgui/imgui_capture.h>
+#include <coffee/imgui/imgui_software.h>
+#include <coffee/imgui/imgui_textures.h>
+#include <imgui.h>
+
+#include "imgui_quantize.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace Coffee;
+
+using GFX = CImGui::ImGuiAPI;
+
+static CImGui::DrawCapture replay_capture;
+static u32                 replay_passes = 100;
+static bool                replay_failed = false;
+
+struct RData
+{
+    GFX::API_CONTEXT load_api;
+
+    /* Renderer time of every pass, per captured frame */
+    Vector<Vector<Chrono::microseconds>> samples;
+    u32                                  pass = 0;
+
+    /* RenderFlag_RetainedLists, over the first pass */
+    szptr retained_reused   = 0;
+    szptr retained_uploaded = 0;
+};
+
+static bool LoadCapture(cstring path)
+{
+    auto file = std::fopen(path, "rb");
+
+    if(!file)
+        return false;
+
+    Vector<u8> data;
+    u8         buffer[64 * 1024];
+    szptr      read;
+
+    while((read = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.insert(data.end(), buffer, buffer + read);
+
+    std::fclose(file);
+
+    return replay_capture.deserialize(data.data(), data.size());
+}
+
+static void Report(RData const& data)
+{
+    using Chrono::microseconds;
+
+    microseconds total{};
+
+    std::printf(
+        "%u frames, %u passes, CPU time in the renderer (us)\n",
+        replay_capture.frames(),
+        replay_passes);
+    std::printf("frame       min    median      mean       max\n");
+
+    for(szptr i = 0; i < data.samples.size(); i++)
+    {
+        auto samples = data.samples[i];
+
+        if(samples.empty())
+            continue;
+
+        std::sort(samples.begin(), samples.end());
+
+        microseconds sum{};
+        for(auto const& sample : samples)
+            sum += sample;
+
+        total += sum;
+
+        std::printf(
+            "%5u %9lld %9lld %9lld %9lld\n",
+            C_FCAST<u32>(i),
+            C_FCAST<long long>(samples.front().count()),
+            C_FCAST<long long>(samples[samples.size() / 2].count()),
+            C_FCAST<long long>(sum.count() / C_FCAST<i64>(samples.size())),
+            C_FCAST<long long>(samples.back().count()));
+    }
+
+    const auto submissions = replay_capture.frames() * replay_passes;
+
+    if(submissions)
+        std::printf(
+            "mean per frame: %lld us\n",
+            C_FCAST<long long>(total.count() / submissions));
+
+    if(CImGui::GetRenderFlags() & CImGui::RenderFlag_RetainedLists)
+        std::printf(
+            "retained lists, first pass: %llu bytes reused, %llu uploaded\n",
+            C_FCAST<unsigned long long>(data.retained_reused),
+            C_FCAST<unsigned long long>(data.retained_uploaded));
+}
+
+/* Replaces the vertices of `draw_data` with what the GPU reads from their
+ *  quantised form, false if they do not fit it. `changed` counts vertices
+ *  which do not read back as they were. */
+static bool RoundTripVertices(ImDrawData* draw_data, szptr& changed)
+{
+    using namespace CImGui::detail;
+
+    Vector<QuantVertex> quantized;
+
+    for(int n = 0; n < draw_data->CmdListsCount; n++)
+    {
+        auto&      vertices = draw_data->CmdLists[n]->VtxBuffer;
+        const auto count    = C_FCAST<szptr>(vertices.Size);
+
+        quantized.resize(count);
+
+        if(!QuantizeVertices(vertices.Data, count, quantized.data()))
+            return false;
+
+        for(szptr i = 0; i < count; i++)
+        {
+            const auto  vertex = DequantizeVertex(quantized[i]);
+            auto const& source = vertices.Data[i];
+
+            if(vertex.pos.x != source.pos.x || vertex.pos.y != source.pos.y ||
+               vertex.uv.x != source.uv.x || vertex.uv.y != source.uv.y ||
+               vertex.col != source.col)
+                changed++;
+
+            vertices.Data[i] = vertex;
+        }
+    }
+
+    return true;
+}
+
+/* False if a quantised frame differs from the captured one */
+static bool VerifyQuantization()
+{
+    auto& io = ImGui::GetIO();
+
+    int            width, height;
+    unsigned char* pixels;
+    io.Fonts->GetTexDataAsAlpha8(&pixels, &width, &height);
+
+    CImGui::SoftwareRenderer software;
+    software.addTexture(
+        io.Fonts->TexID,
+        {pixels, C_CAST<u32>(width), C_CAST<u32>(height), true});
+
+    Vector<u8> reference;
+    u32        quantized_frames = 0;
+    u32        failed           = 0;
+
+    std::printf("frame  quantized  changed vertices  differing pixels\n");
+
+    for(u32 i = 0; i < replay_capture.frames(); i++)
+    {
+        software.render(replay_capture.frame(i));
+        reference.assign(
+            software.pixels(),
+            software.pixels() + software.width() * software.height() * 4);
+
+        auto       draw_data = replay_capture.frame(i);
+        szptr      changed   = 0;
+        const bool fits      = RoundTripVertices(draw_data, changed);
+        szptr      differing = 0;
+
+        if(fits)
+        {
+            software.render(draw_data);
+
+            for(szptr p = 0; p < reference.size(); p += 4)
+                if(!std::equal(
+                       &reference[p], &reference[p] + 4, software.pixels() + p))
+                    differing++;
+
+            quantized_frames++;
+            if(changed || differing)
+                failed++;
+        }
+
+        std::printf(
+            "%5u %10s %17llu %17llu\n",
+            i,
+            fits ? "yes" : "no",
+            C_FCAST<unsigned long long>(changed),
+            C_FCAST<unsigned long long>(differing));
+    }
+
+    std::printf(
+        "%u of %u frames quantised, %u differing\n",
+        quantized_frames,
+        replay_capture.frames(),
+        failed);
+
+    return failed == 0;
+}
+
+void setup(
+    Components::EntityContainer& r, RData& data, Components::time_point const&)
+{
+    auto& windowing = *r.service<comp_app::Windowing>();
+
+    data.load_api = GFX::GetLoadAPI();
+
+    if(!data.load_api(PlatformData::IsDebug()))
+    {
+        windowing.close();
+        return;
+    }
+
+    if(!replay_capture.atlasMatches())
+        std::fprintf(
+            stderr, "font atlas differs from the captured one, "
+                    "glyphs will be sampled from the wrong places\n");
+
+    CImGui::imgui_error_code ec;
+
+    if(!CImGui::CreateDeviceObjects(ec))
+    {
+        std::fprintf(stderr, "failed to create ImGui device objects\n");
+        windowing.close();
+        return;
+    }
+
+    if(CImGui::GetRenderFlags() & CImGui::RenderFlag_QuantizedVertices &&
+       !VerifyQuantization())
+    {
+        std::fprintf(stderr, "quantised frames differ from the capture\n");
+        replay_failed = true;
+        windowing.close();
+        return;
+    }
+
+    data.samples.resize(replay_capture.frames());
+
+    for(auto& samples : data.samples)
+        samples.reserve(replay_passes);
+}
+
+void loop(
+    Components::EntityContainer& r,
+    RData&                       data,
+    Components::time_point const&,
+    Components::duration const&)
+{
+    using clock = Chrono::high_resolution_clock;
+
+    if(data.pass >= replay_passes)
+        return;
+
+    GFX::DefaultFramebuffer()->use(RHI::FramebufferT::All);
+    GFX::DefaultFramebuffer()->clear(0, {0.f, 0.f, 0.f, 1.f});
+
+    for(u32 i = 0; i < replay_capture.frames(); i++)
+    {
+        auto draw_data = replay_capture.frame(i);
+
+        auto start = clock::now();
+        CImGui::RenderDrawData<GFX>(draw_data);
+        data.samples[i].push_back(
+            Chrono::duration_cast<Chrono::microseconds>(clock::now() - start));
+
+        if(data.pass == 0)
+        {
+            auto const& stats = CImGui::GetRenderStats<GFX>();
+            data.retained_reused += stats.retained_bytes_reused;
+            data.retained_uploaded += stats.retained_bytes_uploaded;
+        }
+    }
+
+    if(++data.pass < replay_passes)
+        return;
+
+    Report(data);
+    r.service<comp_app::Windowing>()->close();
+}
+
+void cleanup(
+    Components::EntityContainer&, RData& data, Components::time_point const&)
+{
+    CImGui::Shutdown();
+    CImGui::ReleaseProgramCache();
+
+    data.load_api = nullptr;
+    GFX::UnloadAPI();
+}
+
+int32 coffeeimgui_replay(int32 argc, cstring_w* argv)
+{
+    if(argc < 2)
+    {
+        std::fprintf(
+            stderr, "usage: %s <capture> [passes] [render flags]\n", argv[0]);
+        return 1;
+    }
+
+    if(!LoadCapture(argv[1]))
+    {
+        std::fprintf(stderr, "failed to load capture %s\n", argv[1]);
+        return 1;
+    }
+
+    if(argc > 2)
+        replay_passes =
+            std::max(C_FCAST<u32>(std::strtoul(argv[2], nullptr, 10)), 1u);
+    if(argc > 3)
+        CImGui::SetRenderFlags(
+            C_FCAST<u32>(std::strtoul(argv[3], nullptr, 0)));
+
+    auto& container = comp_app::createContainer();
+    auto& loader    = comp_app::AppLoader::register_service(container);
+    comp_app::configureDefaults(loader);
+
+    using namespace EventHandlers;
+
+    comp_app::app_error ec;
+    comp_app::addDefaults(container, loader, ec);
+
+    auto& ibus = *container.service<comp_app::BasicEventBus<CIEvent>>();
+    ibus.addEventHandler(
+        10, ExitOn<OnQuit>(container.service_ref<comp_app::Windowing>()));
+
+    comp_app::AppContainer<RData>::addTo(container, setup, loop, cleanup);
+
+    CImGui::Init(container);
+
+    const auto result =
+        comp_app::ExecLoop<comp_app::BundleData>::exec(container);
+
+    return replay_failed ? 1 : result;
+}
+
+COFFEE_APPLICATION_MAIN(coffeeimgui_replay)
@@ -0,0 +1,296 @@
+#include "imgui_atlas_builder.h"
+#include "imgui_parallel.h"
+
+#include <coffee/core/CProfiling>
+#include <coffee/core/stl_types.h>
+
+#include <imgui_internal.h>
+
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include <stb_rect_pack.h>
+
+#define STBTT_STATIC
+#define STB_TRUETYPE_IMPLEMENTATION
+#include <stb_truetype.h>
+
+#include <algorithm>
+#include <cstring>
+
+#define IM_API "ImGui::"
+
+namespace Coffee {
+namespace CImGui {
+namespace detail {
+
+namespace {
+
+struct font_input
+{
+    stbtt_fontinfo           info;
+    Vector<stbtt_pack_range> ranges;
+    Vector<stbtt_packedchar> chars;
+    Vector<stbrp_rect>       rects;
+
+    /* First rect of each range */
+    Vector<szptr> range_rects;
+};
+
+struct render_task
+{
+    u32 input;
+    u32 range;
+};
+
+} // namespace
+
+/* Follows ImFontAtlasBuildWithStbTruetype() step by step, only the rect
+ *  gathering and rendering passes are distributed. */
+bool BuildAtlas(ImFontAtlas& atlas, u32 workers)
+{
+    DProfContext _(IM_API "Building font atlas");
+
+    if(workers == 0)
+        workers = DefaultWorkers();
+
+    if(atlas.ConfigData.empty())
+        atlas.AddFontDefault();
+
+    ImFontAtlasBuildRegisterDefaultCustomRects(&atlas);
+
+    atlas.TexID           = nullptr;
+    atlas.TexWidth        = atlas.TexHeight = 0;
+    atlas.TexUvScale      = ImVec2(0.f, 0.f);
+    atlas.TexUvWhitePixel = ImVec2(0.f, 0.f);
+    atlas.ClearTexData();
+
+    const auto input_count = C_FCAST<u32>(atlas.ConfigData.Size);
+
+    Vector<font_input> inputs(input_count);
+    int                total_glyphs = 0;
+
+    for(u32 i = 0; i < input_count; i++)
+    {
+        auto& cfg   = atlas.ConfigData[C_FCAST<int>(i)];
+        auto& input = inputs[i];
+
+        if(!cfg.GlyphRanges)
+            cfg.GlyphRanges = atlas.GetGlyphRangesDefault();
+
+        const auto data   = C_RCAST<unsigned char*>(cfg.FontData);
+        const auto offset = stbtt_GetFontOffsetForIndex(data, cfg.FontNo);
+        if(!stbtt_InitFont(&input.info, data, offset))
+            return false;
+
+        int glyphs = 0;
+        for(auto r = cfg.GlyphRanges; r[0] && r[1]; r += 2)
+        {
+            input.range_rects.push_back(C_FCAST<szptr>(glyphs));
+            glyphs += (r[1] - r[0]) + 1;
+        }
+
+        input.chars.resize(C_FCAST<szptr>(glyphs));
+        input.rects.resize(C_FCAST<szptr>(glyphs));
+        total_glyphs += glyphs;
+
+        for(auto r = cfg.GlyphRanges; r[0] && r[1]; r += 2)
+        {
+            stbtt_pack_range range;
+            std::memset(&range, 0, sizeof(range));
+
+            range.font_size                        = cfg.SizePixels;
+            range.first_unicode_codepoint_in_range = r[0];
+            range.num_chars                        = (r[1] - r[0]) + 1;
+            range.chardata_for_range =
+                &input.chars[input.range_rects[input.ranges.size()]];
+
+            input.ranges.push_back(range);
+        }
+    }
+
+    atlas.TexWidth = (atlas.TexDesiredWidth > 0)
+                         ? atlas.TexDesiredWidth
+                         : (total_glyphs > 4000)
+                               ? 4096
+                               : (total_glyphs > 2000)
+                                     ? 2048
+                                     : (total_glyphs > 1000) ? 1024 : 512;
+    atlas.TexHeight = 0;
+
+    const int          max_tex_height = 1024 * 32;
+    stbtt_pack_context spc;
+    stbtt_PackBegin(
+        &spc,
+        nullptr,
+        atlas.TexWidth,
+        max_tex_height,
+        0,
+        atlas.TexGlyphPadding,
+        nullptr);
+    stbtt_PackSetOversampling(&spc, 1, 1);
+
+    ImFontAtlasBuildPackCustomRects(&atlas, spc.pack_info);
+
+    /* Glyph boxes only depend on the font and oversampling */
+    ParallelFor(input_count, workers, [&](u32 i) {
+        auto const& cfg   = atlas.ConfigData[C_FCAST<int>(i)];
+        auto&       input = inputs[i];
+        auto        local = spc;
+
+        stbtt_PackSetOversampling(&local, cfg.OversampleH, cfg.OversampleV);
+        stbtt_PackFontRangesGatherRects(
+            &local,
+            &input.info,
+            input.ranges.data(),
+            C_FCAST<int>(input.ranges.size()),
+            input.rects.data());
+    });
+
+    /* Packing stays serial and in order, this fixes the layout */
+    for(auto& input : inputs)
+    {
+        stbrp_pack_rects(
+            C_RCAST<stbrp_context*>(spc.pack_info),
+            input.rects.data(),
+            C_FCAST<int>(input.rects.size()));
+
+        for(auto const& rect : input.rects)
+            if(rect.was_packed)
+                atlas.TexHeight = std::max(atlas.TexHeight, rect.y + rect.h);
+    }
+
+    atlas.TexHeight  = ImUpperPowerOfTwo(atlas.TexHeight);
+    atlas.TexUvScale = ImVec2(1.f / atlas.TexWidth, 1.f / atlas.TexHeight);
+
+    const auto pixel_count = C_FCAST<szptr>(atlas.TexWidth * atlas.TexHeight);
+
+    atlas.TexPixelsAlpha8 =
+        C_RCAST<unsigned char*>(ImGui::MemAlloc(pixel_count));
+    std::memset(atlas.TexPixelsAlpha8, 0, pixel_count);
+    spc.pixels = atlas.TexPixelsAlpha8;
+    spc.height = atlas.TexHeight;
+
+    /* Ranges render into disjoint rects, so they may run in any order */
+    Vector<render_task> tasks;
+    for(u32 i = 0; i < input_count; i++)
+        for(u32 r = 0; r < inputs[i].ranges.size(); r++)
+            tasks.push_back({i, r});
+
+    {
+        DProfContext _(IM_API "Rasterizing glyphs");
+
+        ParallelFor(C_FCAST<u32>(tasks.size()), workers, [&](u32 t) {
+            auto const& task  = tasks[t];
+            auto const& cfg   = atlas.ConfigData[C_FCAST<int>(task.input)];
+            auto&       input = inputs[task.input];
+            auto        local = spc;
+            auto        rects = &input.rects[input.range_rects[task.range]];
+            auto const& range = input.ranges[task.range];
+
+            stbtt_PackSetOversampling(
+                &local, cfg.OversampleH, cfg.OversampleV);
+            stbtt_PackFontRangesRenderIntoRects(
+                &local, &input.info, &input.ranges[task.range], 1, rects);
+
+            if(cfg.RasterizerMultiply != 1.f)
+            {
+                unsigned char multiply_table[256];
+                ImFontAtlasBuildMultiplyCalcLookupTable(
+                    multiply_table, cfg.RasterizerMultiply);
+
+                for(int c = 0; c < range.num_chars; c++)
+                    if(rects[c].was_packed)
+                        ImFontAtlasBuildMultiplyRectAlpha8(
+                            multiply_table,
+                            spc.pixels,
+                            rects[c].x,
+                            rects[c].y,
+                            rects[c].w,
+                            rects[c].h,
+                            spc.stride_in_bytes);
+            }
+        });
+    }
+
+    stbtt_PackEnd(&spc);
+
+    for(u32 i = 0; i < input_count; i++)
+    {
+        auto& cfg      = atlas.ConfigData[C_FCAST<int>(i)];
+        auto& input    = inputs[i];
+        auto  dst_font = cfg.DstFont;
+
+        const f32 font_scale =
+            stbtt_ScaleForPixelHeight(&input.info, cfg.SizePixels);
+        int unscaled_ascent, unscaled_descent, unscaled_line_gap;
+        stbtt_GetFontVMetrics(
+            &input.info,
+            &unscaled_ascent,
+            &unscaled_descent,
+            &unscaled_line_gap);
+
+        ImFontAtlasBuildSetupFont(
+            &atlas,
+            dst_font,
+            &cfg,
+            unscaled_ascent * font_scale,
+            unscaled_descent * font_scale);
+
+        const f32 off_x = cfg.GlyphOffset.x;
+        const f32 off_y = cfg.GlyphOffset.y +
+                          C_CAST<f32>(C_CAST<int>(dst_font->Ascent + 0.5f));
+
+        /* Merged glyphs are skipped when the destination has them, which
+         *  FindGlyph() only sees through the lookup table */
+        dst_font->FallbackGlyph = nullptr;
+        if(cfg.MergeMode)
+            dst_font->BuildLookupTable();
+
+        for(auto const& range : input.ranges)
+        {
+            for(int c = 0; c < range.num_chars; c++)
+            {
+                auto const& pc = range.chardata_for_range[c];
+                if(!pc.x0 && !pc.x1 && !pc.y0 && !pc.y1)
+                    continue;
+
+                const int codepoint =
+                    range.first_unicode_codepoint_in_range + c;
+                if(cfg.MergeMode &&
+                   dst_font->FindGlyph(C_CAST<unsigned short>(codepoint)))
+                    continue;
+
+                stbtt_aligned_quad q;
+                f32                dummy_x = 0.f, dummy_y = 0.f;
+                stbtt_GetPackedQuad(
+                    range.chardata_for_range,
+                    atlas.TexWidth,
+                    atlas.TexHeight,
+                    c,
+                    &dummy_x,
+                    &dummy_y,
+                    &q,
+                    0);
+                dst_font->AddGlyph(
+                    C_CAST<ImWchar>(codepoint),
+                    q.x0 + off_x,
+                    q.y0 + off_y,
+                    q.x1 + off_x,
+                    q.y1 + off_y,
+                    q.s0,
+                    q.t0,
+                    q.s1,
+                    q.t1,
+                    pc.xadvance);
+            }
+        }
+    }
+
+    ImFontAtlasBuildFinish(&atlas);
+
+    return true;
+}
+
+} // namespace detail
+} // namespace CImGui
+} // namespace Coffee
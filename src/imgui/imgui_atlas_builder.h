@@ -0,0 +1,21 @@
+#pragma once
+
+#include <coffee/core/libc_types.h>
+
+#include <imgui.h>
+
+namespace Coffee {
+namespace CImGui {
+namespace detail {
+
+/* Replacement for ImFontAtlas::Build() which rasterises glyph ranges on
+ *  `workers` threads (0 picks one per hardware thread).
+ * Rectangles are gathered in parallel, but packed serially in config
+ *  order, and every range renders into its own packed rectangles. The
+ *  result is byte-identical to a single-threaded build.
+ */
+bool BuildAtlas(ImFontAtlas& atlas, u32 workers = 0);
+
+} // namespace detail
+} // namespace CImGui
+} // namespace Coffee
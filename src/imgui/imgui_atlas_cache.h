@@ -0,0 +1,297 @@
+#pragma once
+
+#include <coffee/core/libc_types.h>
+#include <coffee/core/stl_types.h>
+
+#include "imgui_hash.h"
+
+#include <imgui.h>
+#include <imgui_internal.h>
+
+#include <cstring>
+
+namespace Coffee {
+namespace CImGui {
+namespace detail {
+
+/* Serialised form of a built ImFontAtlas:
+ *
+ *  atlas_header
+ *  custom_rect  x custom_rect_count
+ *  font_record  x font_count, each followed by its ImFontGlyphs
+ *  u8           x width * height, the Alpha8 atlas
+ *
+ * Glyphs are stored as-is, so the config hash covers the ImGui version and
+ *  the glyph layout. A blob is only valid for the atlas it was hashed from.
+ */
+struct AtlasCache
+{
+    static constexpr u32 magic   = 0x41544D49; /* "IMTA" */
+    static constexpr u32 version = 1;
+
+    struct atlas_header
+    {
+        u32 magic;
+        u32 version;
+        u64 config_hash;
+        u32 width;
+        u32 height;
+        u32 font_count;
+        u32 custom_rect_count;
+        f32 white_u, white_v;
+    };
+
+    struct custom_rect
+    {
+        u16 x, y;
+    };
+
+    struct font_record
+    {
+        f32 ascent;
+        f32 descent;
+        f32 display_offset_x, display_offset_y;
+        u32 metrics_total_surface;
+        u32 glyph_count;
+    };
+
+    /* Hashes everything ImFontAtlas::Build() reads. Adds the default font if
+     *  none are configured, as Build() would. */
+    static u64 ConfigHash(ImFontAtlas& atlas)
+    {
+        if(atlas.ConfigData.empty())
+            atlas.AddFontDefault();
+
+        ContentHash hash;
+
+        hash.value(version)
+            .bytes(IMGUI_VERSION, sizeof(IMGUI_VERSION))
+            .value(sizeof(ImFontGlyph))
+            .value(sizeof(ImDrawVert))
+            .value(atlas.TexDesiredWidth)
+            .value(atlas.TexGlyphPadding)
+            .value(atlas.CustomRects.Size);
+
+        for(auto const& cfg : atlas.ConfigData)
+        {
+            hash.bytes(cfg.FontData, C_FCAST<szptr>(cfg.FontDataSize))
+                .value(cfg.FontNo)
+                .value(cfg.SizePixels)
+                .value(cfg.OversampleH)
+                .value(cfg.OversampleV)
+                .value(cfg.PixelSnapH)
+                .value(cfg.GlyphExtraSpacing)
+                .value(cfg.GlyphOffset)
+                .value(cfg.MergeMode)
+                .value(cfg.RasterizerMultiply);
+
+            if(cfg.GlyphRanges)
+            {
+                auto end = cfg.GlyphRanges;
+                while(*end)
+                    end++;
+                hash.bytes(
+                    cfg.GlyphRanges,
+                    C_FCAST<szptr>(end - cfg.GlyphRanges) * sizeof(ImWchar));
+            }
+
+            /* Merged fonts are matched by position */
+            hash.value(font_index(atlas, cfg.DstFont));
+        }
+
+        return hash.digest();
+    }
+
+    /* User-registered custom rects are rendered by the user after Build(),
+     *  their content cannot be cached. */
+    static bool Cacheable(ImFontAtlas const& atlas)
+    {
+        return atlas.CustomRects.empty() && !atlas.Fonts.empty();
+    }
+
+    /* Serialises a built atlas */
+    static bool Serialize(ImFontAtlas& atlas, u64 config_hash, Vector<u8>& out)
+    {
+        if(!atlas.TexPixelsAlpha8)
+            return false;
+
+        atlas_header header = {magic,
+                               version,
+                               config_hash,
+                               C_FCAST<u32>(atlas.TexWidth),
+                               C_FCAST<u32>(atlas.TexHeight),
+                               C_FCAST<u32>(atlas.Fonts.Size),
+                               C_FCAST<u32>(atlas.CustomRects.Size),
+                               atlas.TexUvWhitePixel.x,
+                               atlas.TexUvWhitePixel.y};
+
+        out.clear();
+        write(out, &header, sizeof(header));
+
+        for(auto const& rect : atlas.CustomRects)
+        {
+            custom_rect r = {rect.X, rect.Y};
+            write(out, &r, sizeof(r));
+        }
+
+        for(auto const* font : atlas.Fonts)
+        {
+            font_record record = {font->Ascent,
+                                  font->Descent,
+                                  font->DisplayOffset.x,
+                                  font->DisplayOffset.y,
+                                  C_FCAST<u32>(font->MetricsTotalSurface),
+                                  C_FCAST<u32>(font->Glyphs.Size)};
+
+            write(out, &record, sizeof(record));
+            write(
+                out,
+                font->Glyphs.Data,
+                C_FCAST<szptr>(font->Glyphs.Size) * sizeof(ImFontGlyph));
+        }
+
+        write(out, atlas.TexPixelsAlpha8, header.width * header.height);
+
+        return true;
+    }
+
+    /* Restores a serialised atlas in place of ImFontAtlas::Build().
+     * The atlas must have the same fonts configured as when the blob was
+     *  created, which is checked through `config_hash`. Returns false
+     *  without modifying the atlas on any mismatch. */
+    static bool Restore(
+        ImFontAtlas& atlas, const u8* data, szptr size, u64 config_hash)
+    {
+        atlas_header header;
+
+        if(size < sizeof(header))
+            return false;
+
+        std::memcpy(&header, data, sizeof(header));
+
+        if(header.magic != magic || header.version != version ||
+           header.config_hash != config_hash ||
+           header.font_count != C_FCAST<u32>(atlas.Fonts.Size))
+            return false;
+
+        if(!validate(header, data, size))
+            return false;
+
+        auto ptr = data + sizeof(header);
+
+        atlas.ClearTexData();
+
+        /* Re-registers the mouse cursor rect, positions are restored */
+        ImFontAtlasBuildRegisterDefaultCustomRects(&atlas);
+
+        if(C_FCAST<u32>(atlas.CustomRects.Size) != header.custom_rect_count)
+        {
+            atlas.CustomRects.clear();
+            return false;
+        }
+
+        for(auto& rect : atlas.CustomRects)
+        {
+            custom_rect r;
+            std::memcpy(&r, ptr, sizeof(r));
+            ptr += sizeof(r);
+
+            rect.X = r.x;
+            rect.Y = r.y;
+        }
+
+        Vector<font_record> records;
+        Vector<const u8*>   glyphs;
+
+        for(u32 i = 0; i < header.font_count; i++)
+        {
+            font_record record;
+            std::memcpy(&record, ptr, sizeof(record));
+            ptr += sizeof(record);
+
+            records.push_back(record);
+            glyphs.push_back(ptr);
+            ptr += record.glyph_count * sizeof(ImFontGlyph);
+        }
+
+        for(auto& cfg : atlas.ConfigData)
+        {
+            auto const& record = records[font_index(atlas, cfg.DstFont)];
+
+            ImFontAtlasBuildSetupFont(
+                &atlas, cfg.DstFont, &cfg, record.ascent, record.descent);
+        }
+
+        for(int i = 0; i < atlas.Fonts.Size; i++)
+        {
+            auto        font   = atlas.Fonts[i];
+            auto const& record = records[C_FCAST<szptr>(i)];
+
+            font->DisplayOffset =
+                ImVec2(record.display_offset_x, record.display_offset_y);
+            font->MetricsTotalSurface =
+                C_FCAST<int>(record.metrics_total_surface);
+
+            font->Glyphs.resize(C_FCAST<int>(record.glyph_count));
+            std::memcpy(
+                font->Glyphs.Data,
+                glyphs[C_FCAST<szptr>(i)],
+                record.glyph_count * sizeof(ImFontGlyph));
+        }
+
+        const auto pixel_count = header.width * header.height;
+
+        atlas.TexWidth  = C_FCAST<int>(header.width);
+        atlas.TexHeight = C_FCAST<int>(header.height);
+        atlas.TexUvScale =
+            ImVec2(1.f / atlas.TexWidth, 1.f / atlas.TexHeight);
+        atlas.TexPixelsAlpha8 =
+            C_RCAST<unsigned char*>(ImGui::MemAlloc(pixel_count));
+        std::memcpy(atlas.TexPixelsAlpha8, ptr, pixel_count);
+
+        /* Re-renders the cursor rects and builds the lookup tables */
+        ImFontAtlasBuildFinish(&atlas);
+
+        atlas.TexUvWhitePixel = ImVec2(header.white_u, header.white_v);
+
+        return true;
+    }
+
+  private:
+    static szptr font_index(ImFontAtlas const& atlas, ImFont const* font)
+    {
+        for(int i = 0; i < atlas.Fonts.Size; i++)
+            if(atlas.Fonts[i] == font)
+                return C_FCAST<szptr>(i);
+        return 0;
+    }
+
+    static void write(Vector<u8>& out, const void* data, szptr size)
+    {
+        auto ptr = C_RCAST<const u8*>(data);
+        out.insert(out.end(), ptr, ptr + size);
+    }
+
+    static bool validate(atlas_header const& header, const u8* data, szptr size)
+    {
+        szptr offset = sizeof(header) +
+                       header.custom_rect_count * sizeof(custom_rect);
+
+        for(u32 i = 0; i < header.font_count; i++)
+        {
+            font_record record;
+
+            if(offset + sizeof(record) > size)
+                return false;
+
+            std::memcpy(&record, data + offset, sizeof(record));
+            offset += sizeof(record) + record.glyph_count * sizeof(ImFontGlyph);
+        }
+
+        return offset + header.width * header.height == size;
+    }
+};
+
+} // namespace detail
+} // namespace CImGui
+} // namespace Coffee
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <coffee/core/libc_types.h>
+#include <coffee/core/stl_types.h>
+#include <coffee/graphics/apis/CGLeamRHI>
+#include <coffee/graphics/apis/gleam/levels/all_levels.h>
+#include <peripherals/libc/memory_ops.h>
+
+#include <imgui.h>
+
+#include <cstdint>
+#include <string>
+
+namespace Coffee {
+namespace CImGui {
+namespace detail {
+
+/* Blend factors of the UI pass, on top of the enabled GFX::BLNDSTATE */
+enum class BlendMode
+{
+    /* ImGui's SRC_ALPHA, ONE_MINUS_SRC_ALPHA */
+    Straight,
+    /* Into an offscreen layer. Colour as Straight, alpha with ONE,
+     *  ONE_MINUS_SRC_ALPHA, which leaves the layer premultiplied with the
+     *  coverage of everything drawn into it */
+    Layer,
+    /* Compositing a layer, ONE, ONE_MINUS_SRC_ALPHA */
+    Premultiplied,
+};
+
+/* Per-API details of the binding, resolved at compile time.
+ * The generic version suits APIs without native handles, such as the
+ *  NullAPI and counting or recording wrappers. Specialise it for APIs
+ *  which expose handles or richer errors.
+ */
+template<typename GFX>
+struct BackendTraits
+{
+    using shader_error = typename GFX::ERROR;
+
+    /* Key of the ImGuiData global state, unique per API */
+    static cstring state_key()
+    {
+        static const char    tag = 0;
+        static const CString key =
+            "im_data@" + std::to_string(C_RCAST<uintptr_t>(&tag));
+        return key.c_str();
+    }
+
+    static CString error_message(shader_error const& ec)
+    {
+        return ec.message();
+    }
+
+    static ImTextureID texture_id(typename GFX::S_2D& surface)
+    {
+        return C_RCAST<ImTextureID>(&surface);
+    }
+
+    /* Whether the pipeline is still backed by the API */
+    static bool pipeline_valid(typename GFX::PIP&)
+    {
+        return true;
+    }
+
+    /* Called after GFX::SetBlendState(), which selects Straight */
+    static void set_blend_mode(BlendMode)
+    {
+    }
+
+    /* The framebuffer the host had bound, put back after drawing layers */
+    struct framebuffer_binding
+    {
+    };
+
+    static framebuffer_binding current_framebuffer()
+    {
+        return {};
+    }
+
+    static void restore_framebuffer(framebuffer_binding const&)
+    {
+        GFX::DefaultFramebuffer()->use(RHI::FramebufferT::All);
+    }
+};
+
+template<>
+struct BackendTraits<RHI::GLEAM::GLEAM_API>
+{
+    using shader_error = RHI::GLEAM::gleam_error;
+
+    static cstring state_key()
+    {
+        return "im_data";
+    }
+
+    static CString error_message(shader_error const& ec)
+    {
+        return ec.error_message.empty() ? ec.message() : ec.error_message;
+    }
+
+    static ImTextureID texture_id(RHI::GLEAM::GLEAM_API::S_2D& surface)
+    {
+        return libc::ptr::put_value(surface.glTexHandle());
+    }
+
+    static bool pipeline_valid(RHI::GLEAM::GLEAM_API::PIP& pipeline)
+    {
+        return pipeline.pipelineHandle() != 0;
+    }
+
+    /* BlendState has no separate alpha factors */
+    static void set_blend_mode(BlendMode mode)
+    {
+        switch(mode)
+        {
+        case BlendMode::Straight:
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            break;
+        case BlendMode::Layer:
+            glBlendFuncSeparate(
+                GL_SRC_ALPHA,
+                GL_ONE_MINUS_SRC_ALPHA,
+                GL_ONE,
+                GL_ONE_MINUS_SRC_ALPHA);
+            break;
+        case BlendMode::Premultiplied:
+            glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+            break;
+        }
+    }
+
+    struct framebuffer_binding
+    {
+        GLint draw;
+        GLint read;
+    };
+
+    static framebuffer_binding current_framebuffer()
+    {
+        framebuffer_binding out = {};
+
+#if defined(COFFEE_GLES20_MODE)
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &out.draw);
+        out.read = out.draw;
+#else
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &out.draw);
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &out.read);
+#endif
+
+        return out;
+    }
+
+    static void restore_framebuffer(framebuffer_binding const& binding)
+    {
+#if defined(COFFEE_GLES20_MODE)
+        glBindFramebuffer(GL_FRAMEBUFFER, C_CAST<GLuint>(binding.draw));
+#else
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, C_CAST<GLuint>(binding.draw));
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, C_CAST<GLuint>(binding.read));
+#endif
+    }
+};
+
+} // namespace detail
+} // namespace CImGui
+} // namespace Coffee
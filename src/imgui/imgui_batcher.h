@@ -0,0 +1,156 @@
+#pragma once
+
+#include <coffee/core/stl_types.h>
+#include <coffee/core/types/chunk.h>
+
+#include <imgui.h>
+
+namespace Coffee {
+namespace CImGui {
+namespace detail {
+
+/* Collects ImDrawCmds for a frame, merging neighbours that share texture
+ *  and clip rect and address contiguous elements of the same vertices.
+ * Consecutive merged commands with equal state (but different vertex
+ *  offsets, eg. across lists) are grouped into runs, which are submitted
+ *  with a single state change.
+ */
+struct DrawBatcher
+{
+    struct command
+    {
+        ImVec4      clip;
+        ImTextureID texture;
+        u32         vertex_offset;
+        u32         element_offset;
+        u32         elements;
+
+        /* Set for UserCallback commands, which break runs. The command is
+         *  copied, replayed frames outlive its list, whose pointer is only
+         *  kept until release_lists() */
+        ImDrawList const* callback_list;
+        ImDrawCallback    user_callback;
+        void*             user_data;
+    };
+
+    struct run
+    {
+        u32 first;
+        u32 count;
+    };
+
+    void clear()
+    {
+        commands.clear();
+        runs.clear();
+        input_commands = 0;
+        submitted_runs = 0;
+    }
+
+    void add(
+        ImDrawList const* list,
+        ImDrawCmd const&  cmd,
+        u32               vertex_offset,
+        u32               element_offset)
+    {
+        if(cmd.UserCallback)
+        {
+            commands.push_back({cmd.ClipRect,
+                                cmd.TextureId,
+                                vertex_offset,
+                                element_offset,
+                                cmd.ElemCount,
+                                list,
+                                cmd.UserCallback,
+                                cmd.UserCallbackData});
+            runs.push_back({C_FCAST<u32>(commands.size() - 1), 1});
+            return;
+        }
+
+        input_commands++;
+
+        if(cmd.ElemCount == 0)
+            return;
+
+        if(!commands.empty())
+        {
+            auto& prev = commands.back();
+
+            if(!prev.user_callback && same_state(prev, cmd))
+            {
+                if(prev.vertex_offset == vertex_offset &&
+                   prev.element_offset + prev.elements == element_offset)
+                {
+                    prev.elements += cmd.ElemCount;
+                    return;
+                }
+
+                commands.push_back({cmd.ClipRect,
+                                    cmd.TextureId,
+                                    vertex_offset,
+                                    element_offset,
+                                    cmd.ElemCount,
+                                    nullptr,
+                                    nullptr,
+                                    nullptr});
+                runs.back().count++;
+                return;
+            }
+        }
+
+        commands.push_back({cmd.ClipRect,
+                            cmd.TextureId,
+                            vertex_offset,
+                            element_offset,
+                            cmd.ElemCount,
+                            nullptr,
+                            nullptr,
+                            nullptr});
+        runs.push_back({C_FCAST<u32>(commands.size() - 1), 1});
+    }
+
+    /* Draw calls issued after merging, excluding callbacks */
+    u32 output_commands() const
+    {
+        u32 out = 0;
+        for(auto const& c : commands)
+            if(!c.user_callback)
+                out++;
+        return out;
+    }
+
+    /* The drawn lists are refilled by ImGui, or by the widget thread with
+     *  RenderFlag_DeferredSubmit. Replayed callbacks get a null list. */
+    void release_lists()
+    {
+        for(auto& c : commands)
+            c.callback_list = nullptr;
+    }
+
+    /* Kept until the next frame, so an unchanged frame can be replayed */
+    Vector<command> commands;
+    Vector<run>     runs;
+    u32             input_commands = 0;
+    u32             submitted_runs = 0;
+
+    /* Ignore clip rects when merging, for vertices which carry their own.
+     *  Kept across clear() */
+    bool merge_clip = false;
+
+  private:
+    bool same_state(command const& prev, ImDrawCmd const& cmd) const
+    {
+        if(prev.texture != cmd.TextureId)
+            return false;
+
+        if(merge_clip)
+            return true;
+
+        return prev.clip.x == cmd.ClipRect.x && prev.clip.y == cmd.ClipRect.y &&
+               prev.clip.z == cmd.ClipRect.z && prev.clip.w == cmd.ClipRect.w;
+    }
+};
+
+} // namespace detail
+} // namespace CImGui
+} // namespace Coffee
@@ -9,6 +9,7 @@
 // examples/README.txt and documentation at the top of imgui.cpp.
 // https://github.com/ocornut/imgui
 
+#include <coffee/core/CFiles>
 #include <coffee/core/CProfiling>
 #include <coffee/core/base.h>
 #include <coffee/core/base_state.h>
@@ -19,6 +20,10 @@
 #include <coffee/core/types/input/keymap.h>
 #include <coffee/graphics/apis/CGLeamRHI>
 #include <coffee/imgui/imgui_binding.h>
+#include <coffee/imgui/imgui_capture.h>
+#include <coffee/imgui/imgui_primitives.h>
+#include <coffee/imgui/imgui_software.h>
+#include <coffee/imgui/imgui_textures.h>
 #include <coffee/interfaces/cgraphics_util.h>
 #include <peripherals/libc/memory_ops.h>
 
@@ -26,19 +31,42 @@
 
 #include <coffee/strings/libc_types.h>
 
+#include <future>
+#include <limits>
+#include <type_traits>
+
 #include <coffee/core/CDebug>
 
+#include "imgui_atlas_builder.h"
+#include "imgui_atlas_cache.h"
+#include "imgui_backend.h"
+#include "imgui_batcher.h"
+#include "imgui_clip.h"
+#include "imgui_frame_queue.h"
+#include "imgui_glyph_cache.h"
+#include "imgui_hash.h"
+#include "imgui_layer_cache.h"
+#include "imgui_primitive_stream.h"
+#include "imgui_program_cache.h"
+#include "imgui_quantize.h"
+#include "imgui_retained_lists.h"
+#include "imgui_sdf.h"
+#include "imgui_shader_view.h"
+#include "imgui_state_shadow.h"
+#include "imgui_stream_buffer.h"
+#include "imgui_texture_registry.h"
+
 #define IM_API "ImGui::"
 
 using namespace Coffee;
 using namespace Display;
 using namespace Input;
 
-#if defined(COFFEE_IMGUI_USE_GLEAM)
-using GFX = RHI::GLEAM::GLEAM_API;
-#else
-using GFX = RHI::NullAPI;
-#endif
+/* The untemplated API drives this backend, see UseBackend() */
+using DefaultAPI = CImGui::ImGuiAPI;
+
+template<typename GFX>
+using Traits = CImGui::detail::BackendTraits<GFX>;
 
 static const Vector<Pair<ImGuiKey_, u16>> ImKeyMap = {
     {ImGuiKey_Tab, CK_HTab},
@@ -84,27 +112,224 @@ C_UNUSED(STATICINLINE u32 ImToCfKey(ImGuiKey k))
     return 0;
 }
 
+static u32                     im_render_flags = CImGui::RenderFlag_Default;
+static CImGui::StreamingConfig im_stream_config;
+
+/* Input and redraw requests, consumed by ImGuiSystem's idle mode */
+static u64                  im_input_generation = 0;
+static bool                 im_redraw_requested = false;
+static Components::duration im_redraw_within    = Components::duration::max();
+
+/* Per-backend state which outlives ImGuiData */
+template<typename GFX>
+struct BackendStatics
+{
+    /* User textures, these outlive the device objects */
+    static CImGui::detail::TextureRegistry<GFX> textures;
+    /* Linked pipelines */
+    static CImGui::detail::ProgramCache<GFX> programs;
+};
+
+template<typename GFX>
+CImGui::detail::TextureRegistry<GFX> BackendStatics<GFX>::textures;
+template<typename GFX>
+CImGui::detail::ProgramCache<GFX> BackendStatics<GFX>::programs;
+
+/* Replaces the GL path when set, see SetSoftwareRenderer() */
+static CImGui::SoftwareRenderer* im_software = nullptr;
+
+/* Target of StartCapture(), and the frames left to record */
+static CImGui::DrawCapture* im_capture        = nullptr;
+static u32                  im_capture_frames = 0;
+
+/* Set by NewFrame() when it ran ImGui::NewFrame(), EndFrame() finishes
+ *  that frame even if the device went away in between */
+static bool im_frame_started = false;
+
+/* RenderFlag_Primitives, records of the frame being built */
+static CImGui::detail::PrimitiveStream im_primitives;
+
+/* Records of the frame being rendered. Deferred frames carry their own, and
+ *  redraws only need the runs of the last frame drawn. */
+static CImGui::detail::PrimitiveStream const* im_frame_primitives =
+    &im_primitives;
+static CImGui::detail::PrimitiveStream im_drawn_primitives;
+
+/* RenderFlag_DeferredSubmit, frames from EndFrame() to SubmitPendingFrame() */
+static CImGui::detail::FrameQueue im_frames;
+
+/* Glyphs rasterised on first use, registered before Init() */
+static CImGui::detail::GlyphCache im_glyphs;
+
+/* RenderFlag_SdfFontAtlas, converted once from the atlas' Alpha8 data */
+static Vector<u8>           im_sdf_pixels;
+static const unsigned char* im_sdf_source = nullptr;
+
+/* ImGui needs a few frames to settle hover states and auto-sizing */
+static constexpr u32 im_idle_settle_frames = 3;
+
+static bool UseAlphaAtlas();
+static bool UseSdfAtlas();
+static bool UseShaderClip();
+static bool UsePrimitives();
+static bool UseQuantizedVertices();
+static bool UseRetainedLists();
+static bool UseDeferredSubmit();
+
+/* CPU side of the font texture. Only touches io.Fonts, and runs
+ *  concurrently with shader compilation in CreateDeviceObjects() */
+struct FontAtlasData
+{
+    unsigned char* pixels;
+    int            width, height;
+    u32            surface_height;
+    bool           alpha_only;
+    bool           distance_field;
+
+    CImGui::FontAtlasStats::Source source;
+    Chrono::microseconds           build_time;
+};
+
+static FontAtlasData PrepareFontAtlas(bool alpha_only);
+static u64           ProgramKey(bool shader_clip);
+static u64           PrimitiveProgramKey();
+
+template<typename GFX>
 struct ImGuiData : State::GlobalState
 {
     ImGuiData() :
-        attributes(), pipeline(MkShared<GFX::PIP>()),
+        attributes(),
+        pipeline(BackendStatics<GFX>::programs.acquire(
+            ProgramKey(UseShaderClip()))),
         vertices(RSCA::Streaming | RSCA::WriteOnly, 0),
         elements(RSCA::Streaming | RSCA::WriteOnly, 0), shader_view(pipeline),
-        fonts(PixFmt::RGBA8)
+        fonts(UseAlphaAtlas() ? PixFmt::R8 : PixFmt::RGBA8),
+        fonts_tex_mode(
+            UseSdfAtlas()
+                ? CImGui::detail::TexMode_Sdf
+                : UseAlphaAtlas() ? CImGui::detail::TexMode_Alpha
+                                  : CImGui::detail::TexMode_RGBA),
+        vertex_ring(vertices), element_ring(elements),
+        layers(pipeline, projection_matrix),
+        primitive_pipeline(
+            UsePrimitives() ? BackendStatics<GFX>::programs.acquire(
+                                  PrimitiveProgramKey())
+                            : nullptr),
+        primitive_buffer(RSCA::Streaming | RSCA::WriteOnly, 0),
+        primitive_ring(primitive_buffer), primitive_cached(false),
+        primitive_time(), primitive_base(0), quant_attributes(),
+        quantized(UseQuantizedVertices()), quantized_frame(false),
+        quantize_fallbacks(0), retained(UseRetainedLists()),
+        status(CImGui::DeviceStatus::Unloaded), attr_idx{-1, -1, -1, -1},
+        program_cached(false), program_time(), font_data(),
+        vertex_layout_valid(false), shader_clip(UseShaderClip()), frame(0)
     {
         fonts_sampler.attach(&fonts);
+        vertex_ring.configure(im_stream_config);
+        element_ring.configure(im_stream_config);
+        primitive_ring.configure(im_stream_config);
     }
     ~ImGuiData();
 
-    GFX::V_DESC     attributes;
-    ShPtr<GFX::PIP> pipeline;
-    GFX::BUF_A      vertices;
-    GFX::BUF_E      elements;
+    static ImGuiData<GFX>* Peek()
+    {
+        return C_DCAST<ImGuiData>(
+            State::PeekState(Traits<GFX>::state_key()).get());
+    }
+
+    typename GFX::V_DESC     attributes;
+    ShPtr<typename GFX::PIP> pipeline;
+    typename GFX::BUF_A      vertices;
+    typename GFX::BUF_E      elements;
 
     RHI::shader_param_view<GFX> shader_view;
 
-    GFX::SM_2D fonts_sampler;
-    GFX::S_2D  fonts;
+    typename GFX::SM_2D fonts_sampler;
+    typename GFX::S_2D  fonts;
+    i32                 fonts_tex_mode;
+
+    CImGui::FontAtlasStats atlas_stats = {};
+    Vector<u8>             glyph_staging;
+
+    /* Staging for RenderFlag_BatchUpload, kept between frames */
+    Vector<ImDrawVert>                 staging_vertices;
+    Vector<ImDrawIdx>                  staging_elements;
+    Vector<CImGui::detail::ClipVertex> staging_clip_vertices;
+
+    CImGui::detail::StreamRing<typename GFX::BUF_A> vertex_ring;
+    CImGui::detail::StreamRing<typename GFX::BUF_E> element_ring;
+
+    CImGui::detail::DrawBatcher  batcher;
+    Vector<typename GFX::D_DATA> multi_draw;
+
+    /* RenderFlag_LayerCache */
+    CImGui::detail::LayerCache<GFX>                          layers;
+    CImGui::detail::DrawBatcher                              layer_batcher;
+    Vector<typename CImGui::detail::LayerCache<GFX>::layer*> list_layers;
+    Vector<ImDrawVert>                                       composite_vertices;
+    Vector<ImDrawIdx>                                        composite_elements;
+
+    /* RenderFlag_Primitives, without a pipeline when it was not set at
+     *  creation. The records of a frame are uploaded in one piece. */
+    ShPtr<typename GFX::PIP>                        primitive_pipeline;
+    UqPtr<RHI::shader_param_view<GFX>>              primitive_view;
+    typename GFX::V_DESC                            primitive_attributes;
+    typename GFX::BUF_A                             primitive_buffer;
+    CImGui::detail::StreamRing<typename GFX::BUF_A> primitive_ring;
+    bool                                            primitive_cached;
+    Chrono::microseconds                            primitive_time;
+    u32                                             primitive_base;
+
+    /* RenderFlag_QuantizedVertices, the same buffers read as QuantVertex.
+     *  Frames which did not fit are uploaded as ImDrawVert. */
+    typename GFX::V_DESC                quant_attributes;
+    Vector<CImGui::detail::QuantVertex> staging_quant_vertices;
+    bool                                quantized;
+    bool                                quantized_frame;
+    u64                                 quantize_fallbacks;
+    CImGui::detail::QuantizeBackoff     quantize_backoff;
+
+    /* RenderFlag_RetainedLists, which owns the vertex and element buffers
+     *  instead of the streaming rings */
+    bool                          retained;
+    CImGui::detail::RetainedLists retained_lists;
+
+    /* RenderFlag_SkipUnchanged, the last frame is replayable when it is
+     *  held in the frame target, or its geometry is still resident in the
+     *  streaming rings */
+    struct
+    {
+        u64         hash;
+        bool        valid;
+        bool        resident;
+        u64         hits;
+        u64         misses;
+        ImTextureID target;
+        u32         quad_vertex;
+        u32         quad_element;
+    } frame_cache = {};
+
+    /* Staged creation, see StepDeviceObjects() */
+    CImGui::DeviceStatus       status;
+    std::future<FontAtlasData> font_atlas;
+    i32                        attr_idx[4];
+    bool                       program_cached;
+    Chrono::microseconds       program_time;
+
+    /* CPU copies, recreation after InvalidateDeviceObjects() only
+     *  re-uploads these */
+    FontAtlasData                  font_data;
+    Vector<u8>                     font_pixels;
+    Array<typename GFX::V_ATTR, 4> vertex_layout;
+    bool                           vertex_layout_valid;
+
+    /* RenderFlag_ShaderClip, the pipeline and vertex layout depend on it */
+    bool shader_clip;
+
+    CImGui::DeviceStats device_stats = {};
+
+    CImGui::RenderStats stats;
+    u64                 frame;
 
     Matf4 projection_matrix;
 
@@ -114,605 +339,2743 @@ struct ImGuiData : State::GlobalState
     u32 _pad;
 };
 
-ImGuiData::~ImGuiData()
+template<typename GFX>
+static void UploadDynamicGlyphs(ImGuiData<GFX>* im_data);
+
+template<typename GFX>
+ImGuiData<GFX>::~ImGuiData()
 {
-    GFX::ERROR ec;
+    /* The pipeline belongs to the program cache */
+    layers.clear();
+    BackendStatics<GFX>::textures.release();
     vertices.dealloc();
     elements.dealloc();
     attributes.dealloc();
-    pipeline->dealloc(ec);
+    primitive_view.reset();
+    primitive_attributes.dealloc();
+    primitive_buffer.dealloc();
+    quant_attributes.dealloc();
     fonts.dealloc();
     fonts_sampler.dealloc();
 }
 
-// This is the main rendering function that you have to implement and provide to
-// ImGui (via setting up 'RenderDrawListsFn' in the ImGuiIO structure) If text
-// or lines are blurry when integrating ImGui in your engine:
-// - in your Render function, try translating your projection matrix by
-// (0.5f,0.5f) or (0.375f,0.375f)
-static void ImGui_ImplSdlGL3_RenderDrawLists(ImDrawData* draw_data)
+template<typename GFX>
+static RHI::shader_param_view<GFX>& TextureView(
+    ImGuiData<GFX>* im_data, ImTextureID texture)
 {
-    const auto im_data = C_DCAST<ImGuiData>(State::PeekState("im_data").get());
+    if(auto layer = im_data->layers.find(texture))
+        return *layer->view;
 
-    // Avoid rendering when minimized, scale coordinates for retina displays
-    // (screen coordinates != framebuffer coordinates)
-    GFX::DBG::SCOPE a(IM_API "ImGui render");
-    DProfContext    _(IM_API "Rendering draw lists");
+    if(auto view = BackendStatics<GFX>::textures.view(
+           texture, im_data->pipeline, im_data->projection_matrix))
+        return *view;
 
-    ImGuiIO& io        = ImGui::GetIO();
-    int      fb_width  = (int)(io.DisplaySize.x * io.DisplayFramebufferScale.x);
-    int      fb_height = (int)(io.DisplaySize.y * io.DisplayFramebufferScale.y);
-    if(fb_width == 0 || fb_height == 0)
-        return;
-    draw_data->ScaleClipRects(io.DisplayFramebufferScale);
+    return im_data->shader_view;
+}
 
-    GFX::BLNDSTATE prev_blnd;
-    GFX::VIEWSTATE prev_view;
-    GFX::RASTSTATE prev_rast;
-    GFX::DEPTSTATE prev_dept;
+/* Submits a run of draws which share all pipeline state */
+template<typename GFX>
+static void MultiDraw(
+    ImGuiData<GFX>*                     im_data,
+    RHI::shader_param_view<GFX>&        view,
+    typename GFX::D_CALL const&         dc,
+    Vector<typename GFX::D_DATA> const& draws)
+{
+    auto const& attributes = im_data->quantized_frame
+                                 ? im_data->quant_attributes
+                                 : im_data->attributes;
 
-    GFX::GetBlendState(prev_blnd);
-    GFX::GetViewportState(prev_view);
-    GFX::GetRasterizerState(prev_rast);
-    GFX::GetDepthState(prev_dept);
+    for(auto const& dd : draws)
+        GFX::Draw(*im_data->pipeline, view.get_state(), attributes, dc, dd);
+}
 
-    GFX::BLNDSTATE blend;
-    blend.m_doBlend = true;
-    GFX::RASTSTATE raster;
-    raster.m_culling = C_CAST<u32>(RHI::Datatypes::Face::Front);
-    GFX::DEPTSTATE depth;
-    depth.m_test = false;
-    GFX::VIEWSTATE view_(1);
+/* Copies `source` to `out`, offset by the vertices of the lists before it.
+ *  The caller checks that the frame's vertices fit in ImDrawIdx. */
+template<typename Elements, typename Iterator>
+static Iterator RebaseElements(
+    Elements const& source, u32 base, Iterator out)
+{
+    for(auto idx : source)
+        *out++ = C_CAST<ImDrawIdx>(idx + base);
 
-    view_.m_view.clear();
-    view_.m_depth.clear();
+    return out;
+}
 
-    GFX::SetBlendState(blend);
-    GFX::SetRasterizerState(raster);
-    GFX::SetDepthState(depth);
+/* Draws a run of RenderFlag_Primitives instances, six vertices each */
+template<typename GFX>
+static void DrawPrimitives(
+    ImGuiData<GFX>*                             im_data,
+    CImGui::detail::PrimitiveStream::run const& run,
+    CImGui::RenderStats&                        stats)
+{
+    typename GFX::D_CALL dc(false, true);
+    typename GFX::D_DATA dd;
+
+    dd.m_verts = 6;
+    dd.m_insts = run.count;
+    dd.m_ioff  = im_data->primitive_base + run.first;
+
+    GFX::Draw(
+        *im_data->primitive_pipeline,
+        im_data->primitive_view->get_state(),
+        im_data->primitive_attributes,
+        dc,
+        dd);
+
+    stats.primitive_draws++;
+    stats.primitive_instances += run.count;
+}
 
+/* Column-major orthographic projection for ImGui's y-down coordinates.
+ *  The z column only meets z = 0, its w is the UV unit of the vertex
+ *  shader. */
+static void SetProjection(Matf4& target, f32 sx, f32 sy, f32 tx, f32 ty)
+{
     const float ortho_projection[4][4] = {
-        {2.0f / io.DisplaySize.x, 0.0f, 0.0f, 0.0f},
-        {0.0f, 2.0f / -io.DisplaySize.y, 0.0f, 0.0f},
-        {0.0f, 0.0f, -1.0f, 0.0f},
-        {-1.0f, 1.0f, 0.0f, 1.0f},
+        {sx, 0.0f, 0.0f, 0.0f},
+        {0.0f, sy, 0.0f, 0.0f},
+        {0.0f, 0.0f, -1.0f, 1.0f},
+        {tx, ty, 0.0f, 1.0f},
     };
 
-    auto target = Bytes::From(im_data->projection_matrix);
+    auto target_bytes = Bytes::From(target);
     auto source = Bytes::From(C_RCAST<const float*>(ortho_projection), 16);
 
-    MemCpy(source, target);
-
-    GFX::D_CALL dc(true, false);
-    GFX::D_DATA dd;
-    dd.m_eltype =
-        (sizeof(ImDrawIdx) == 2) ? RHI::TypeEnum::UShort : RHI::TypeEnum::UInt;
-
-    for(int n = 0; n < draw_data->CmdListsCount; n++)
-    {
-        GFX::DBG::SCOPE _(IM_API "Command list");
+    MemCpy(source, target_bytes);
+}
 
-        auto cmd_list = draw_data->CmdLists[n];
-        dd.m_eoff     = 0;
+/* Quantised UVs are in steps of 1 / quant_uv_steps, which the projection
+ *  scales back */
+template<typename GFX>
+static void ApplyUvUnit(ImGuiData<GFX>* im_data)
+{
+    if(!im_data->quantized_frame)
+        return;
 
-        im_data->vertices.commit(
-            cmd_list->VtxBuffer.Size * sizeof(ImDrawVert),
-            cmd_list->VtxBuffer.Data);
-        im_data->elements.commit(
-            cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx),
-            cmd_list->IdxBuffer.Data);
+    auto& projection = im_data->projection_matrix;
 
-        for(int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++)
-        {
-            GFX::DBG::SCOPE _(IM_API "Command buffer");
+    C_RCAST<f32*>(&projection)[11] = 1.f / CImGui::detail::quant_uv_steps;
+}
 
-            auto cmd   = &cmd_list->CmdBuffer[cmd_i];
-            dd.m_elems = cmd->ElemCount;
-            if(cmd->UserCallback)
-                cmd->UserCallback(cmd_list, cmd);
-            else
-            {
-                view_.m_scissor[0] = {
-                    C_CAST<i32>(cmd->ClipRect.x),
-                    C_CAST<i32>(fb_height - cmd->ClipRect.w),
-                    C_CAST<i32>(cmd->ClipRect.z - cmd->ClipRect.x),
-                    C_CAST<i32>(cmd->ClipRect.w - cmd->ClipRect.y)};
-
-                GFX::SetViewportState(view_);
-                /* TODO: Improve this by using batching structure,
-                 *  D_DATA arrays */
-                GFX::Draw(
-                    *im_data->pipeline,
-                    im_data->shader_view.get_state(),
-                    im_data->attributes,
-                    dc,
-                    dd);
-            }
-            dd.m_eoff += cmd->ElemCount;
-        }
-    }
+/* The part of the ImGui IO a frame is rendered with. Deferred frames carry
+ *  their own, the IO then belongs to the frame being built. */
+struct FrameDisplay
+{
+    ImVec2 size;
+    ImVec2 framebuffer_scale;
+};
 
-    view_.m_scissor[0] = {0, 0, fb_width, fb_height};
-    //    GFX::SetViewportState(view_);
+static FrameDisplay IoDisplay()
+{
+    auto const& io = ImGui::GetIO();
 
-    GFX::SetViewportState(prev_view);
-    GFX::SetBlendState(prev_blnd);
-    GFX::SetRasterizerState(prev_rast);
-    GFX::SetDepthState(prev_dept);
+    return {io.DisplaySize, io.DisplayFramebufferScale};
 }
 
-static const char* ImGui_ImplSdlGL3_GetClipboardText(void*)
+template<typename GFX>
+static void SetScreenProjection(
+    ImGuiData<GFX>* im_data, FrameDisplay const& display)
 {
-    return nullptr;
+    SetProjection(
+        im_data->projection_matrix,
+        2.0f / display.size.x,
+        2.0f / -display.size.y,
+        -1.0f,
+        1.0f);
+    ApplyUvUnit(im_data);
 }
 
-static void ImGui_ImplSdlGL3_SetClipboardText(void*, const char*)
+template<typename GFX>
+using StateShadow = CImGui::detail::StateShadow<GFX>;
+template<typename GFX>
+using Layer = typename CImGui::detail::LayerCache<GFX>::layer;
+
+/* The scissor box of an ImGui clip rect, with a bottom-left origin */
+static CImGui::detail::ScissorRect ScissorOf(ImVec4 const& clip, int fb_height)
 {
-    //    SDL_SetClipboardText(text);
+    return {C_CAST<i32>(clip.x),
+            C_CAST<i32>(fb_height - clip.w),
+            C_CAST<i32>(clip.z - clip.x),
+            C_CAST<i32>(clip.w - clip.y)};
 }
 
-void ImGui_ImplSdlGL3_CreateFontsTexture()
+/* Draws with `mode` blending, except for layer composites, which are
+ *  premultiplied */
+template<typename GFX>
+static void SubmitBatches(
+    ImGuiData<GFX>*              im_data,
+    CImGui::detail::DrawBatcher& batcher,
+    StateShadow<GFX>&            shadow,
+    typename GFX::VIEWSTATE&     view,
+    typename GFX::D_CALL const&  dc,
+    typename GFX::D_DATA const&  base,
+    int                          fb_width,
+    int                          fb_height,
+    CImGui::RenderStats&         stats,
+    CImGui::detail::BlendMode    mode = CImGui::detail::BlendMode::Straight)
 {
-    const auto im_data = C_DCAST<ImGuiData>(State::PeekState("im_data").get());
+    using CImGui::detail::BlendMode;
 
-    DProfContext    _(IM_API "Creating font atlas");
-    GFX::DBG::SCOPE a(IM_API "Create font atlas");
+    auto& draws = im_data->multi_draw;
 
-    // Build texture atlas
-    ImGuiIO&       io = ImGui::GetIO();
-    unsigned char* pixels;
-    int            width, height;
-    io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+    bool        bound   = false;
+    ImTextureID texture = nullptr;
 
-    auto pixelDataSize =
-        GetPixSize(BitFmt::UByte, PixCmp::RGBA, C_FCAST<u32>(width * height));
+    for(auto run_i : Range<u32>(batcher.runs.size() - batcher.submitted_runs))
+    {
+        typename GFX::DBG::SCOPE _(IM_API "Command run");
 
-    auto& s  = im_data->fonts;
-    auto& sm = im_data->fonts_sampler;
+        auto const& run  = batcher.runs[batcher.submitted_runs + run_i];
+        auto const& head = batcher.commands[run.first];
 
-    auto surface_size = size_2d<i32>{width, height}.convert<u32>();
+        auto primitives =
+            im_data->primitive_view
+                ? im_frame_primitives->find(head.user_callback, head.user_data)
+                : nullptr;
 
-    s.allocate(surface_size, PixCmp::RGBA);
-    s.upload(
-        {s.m_pixfmt, BitFmt::UByte, PixCmp::RGBA},
-        surface_size,
-        Bytes::From(pixels, pixelDataSize));
+        if(primitives)
+        {
+            shadow.apply(mode);
+            shadow.apply_scissor(view, ScissorOf(head.clip, fb_height));
+            DrawPrimitives(im_data, *primitives, stats);
+            continue;
+        }
 
-    sm.alloc();
-    sm.setFiltering(Filtering::Linear, Filtering::Linear);
+        if(head.user_callback)
+        {
+            ImDrawCmd cmd;
+            cmd.ElemCount        = head.elements;
+            cmd.ClipRect         = head.clip;
+            cmd.TextureId        = head.texture;
+            cmd.UserCallback     = head.user_callback;
+            cmd.UserCallbackData = head.user_data;
+
+            head.user_callback(head.callback_list, &cmd);
+            shadow.invalidate();
+            continue;
+        }
 
-    io.Fonts->TexID = libc::ptr::put_value(s.glTexHandle());
-}
+        shadow.apply(
+            im_data->layers.find(head.texture) ? BlendMode::Premultiplied
+                                               : mode);
 
-template<typename T>
-inline T const& C(c_cptr d)
-{
-    return *(C_FCAST<T const*>(d));
+        /* With clip rects in the vertices, the scissor box only has to
+         *  cover the framebuffer, and is set once */
+        if(batcher.merge_clip)
+            shadow.apply_scissor(view, {0, 0, fb_width, fb_height});
+        else
+            shadow.apply_scissor(view, ScissorOf(head.clip, fb_height));
+
+        draws.clear();
+        for(auto i : Range<u32>(run.count))
+        {
+            auto const& cmd = batcher.commands[run.first + i];
+            typename GFX::D_DATA dd  = base;
+
+            dd.m_voff  = cmd.vertex_offset;
+            dd.m_eoff  = cmd.element_offset;
+            dd.m_elems = cmd.elements;
+
+            draws.push_back(dd);
+        }
+
+        if(!bound || head.texture != texture)
+        {
+            stats.texture_binds++;
+            bound   = true;
+            texture = head.texture;
+        }
+
+        MultiDraw(im_data, TextureView(im_data, head.texture), dc, draws);
+        stats.draw_runs++;
+    }
+
+    batcher.submitted_runs = C_FCAST<u32>(batcher.runs.size());
 }
 
-void ImGui_InputHandle(CIEvent const& ev, c_ptr data)
+/* RenderFlag_SkipUnchanged, uploads the quad which composites the frame
+ *  target. It is not quantised, which resets the projection's UV unit. */
+template<typename GFX>
+static void UploadFrameQuad(
+    ImGuiData<GFX>*      im_data,
+    Layer<GFX> const&    target,
+    FrameDisplay const&  display,
+    int                  fb_width,
+    int                  fb_height,
+    CImGui::RenderStats& stats)
 {
-    auto io = &ImGui::GetIO();
+    auto& frame_cache = im_data->frame_cache;
+
+    /* The target is bottom-up, the UI covers its lower-left corner */
+    const f32   u     = C_CAST<f32>(fb_width) / target.width;
+    const f32   v     = C_CAST<f32>(fb_height) / target.height;
+    const ImU32 white = 0xFFFFFFFF;
+
+    const ImDrawVert quad[4] = {
+        {{0.f, 0.f}, {0.f, v}, white},
+        {{display.size.x, 0.f}, {u, v}, white},
+        {{display.size.x, display.size.y}, {u, 0.f}, white},
+        {{0.f, display.size.y}, {0.f, 0.f}, white},
+    };
+    const ImDrawIdx elements[6] = {0, 1, 2, 0, 2, 3};
 
-    switch(ev.type)
+    CImGui::detail::ClipVertex clip_quad[4];
+
+    c_cptr vertex_data = quad;
+    szptr  vertex_size = sizeof(ImDrawVert);
+
+    if(im_data->shader_clip)
     {
-    case CIEvent::TouchPan:
+        CImGui::detail::ConvertVertices(quad, 4, clip_quad);
+        vertex_data = clip_quad;
+        vertex_size = sizeof(CImGui::detail::ClipVertex);
+    }
+
+    frame_cache.quad_vertex = C_FCAST<u32>(
+        im_data->vertex_ring.upload(vertex_data, 4 * vertex_size, vertex_size) /
+        vertex_size);
+    frame_cache.quad_element = C_FCAST<u32>(
+        im_data->element_ring.upload(
+            elements, sizeof(elements), sizeof(ImDrawIdx)) /
+        sizeof(ImDrawIdx));
+    frame_cache.target = C_RCAST<ImTextureID>(&target);
+
+    stats.upload_calls += 2;
+    stats.upload_bytes += 4 * vertex_size + sizeof(elements);
+
+    if(im_data->quantized_frame)
     {
-        CIMTouchMotionEvent const& pan = C<CIMTouchMotionEvent>(data);
+        im_data->quantized_frame = false;
+        SetScreenProjection(im_data, display);
+    }
+}
 
-        io->MousePos = {
-            (pan.origin.x + pan.translation.x) / io->DisplayFramebufferScale.x,
-            (pan.origin.y + pan.translation.y) / io->DisplayFramebufferScale.y};
+/* Draws the frame target over the host's framebuffer */
+template<typename GFX>
+static void CompositeFrameTarget(
+    ImGuiData<GFX>*             im_data,
+    StateShadow<GFX>&           shadow,
+    typename GFX::VIEWSTATE&    view,
+    typename GFX::D_CALL const& dc,
+    typename GFX::D_DATA const& base,
+    int                         fb_width,
+    int                         fb_height,
+    CImGui::RenderStats&        stats)
+{
+    typename GFX::DBG::SCOPE _(IM_API "Compositing frame target");
 
-        auto btn = CIMouseButtonEvent::LeftButton;
+    auto const& frame_cache = im_data->frame_cache;
+    auto&       draws       = im_data->multi_draw;
 
-        io->MouseDown[btn - 1]       = true;
-        io->MouseClickedPos[btn - 1] = io->MousePos;
+    shadow.apply(CImGui::detail::BlendMode::Premultiplied);
+    shadow.apply_scissor(view, {0, 0, fb_width, fb_height});
 
-        break;
-    }
-    case CIEvent::TouchTap:
-    {
-        CITouchTapEvent const& tap = C<CITouchTapEvent>(data);
+    typename GFX::D_DATA dd = base;
+    dd.m_voff               = frame_cache.quad_vertex;
+    dd.m_eoff               = frame_cache.quad_element;
+    dd.m_elems              = 6;
 
-        io->MouseDown[CIMouseButtonEvent::LeftButton - 1]       = tap.pressed;
-        io->MouseClickedPos[CIMouseButtonEvent::LeftButton - 1] = {
-            tap.pos.x / io->DisplayFramebufferScale.x,
-            tap.pos.y / io->DisplayFramebufferScale.y};
+    draws.clear();
+    draws.push_back(dd);
 
-        break;
-    }
-    case CIEvent::MouseButton:
+    MultiDraw(im_data, TextureView(im_data, frame_cache.target), dc, draws);
+    stats.texture_binds++;
+    stats.draw_runs++;
+}
+
+/* Assigns a layer to every list that can be cached, and stages the quads
+ *  which composite them */
+template<typename GFX>
+static void PrepareLayers(
+    ImGuiData<GFX>*           im_data,
+    ImDrawData*          draw_data,
+    ImVec2 const&        scale,
+    int                  fb_width,
+    int                  fb_height,
+    CImGui::RenderStats& stats)
+{
+    DProfContext _(IM_API "Preparing layers");
+
+    auto& list_layers = im_data->list_layers;
+    auto& vertices    = im_data->composite_vertices;
+    auto& elements    = im_data->composite_elements;
+
+    list_layers.clear();
+    vertices.clear();
+    elements.clear();
+
+    for(int n = 0; n < draw_data->CmdListsCount; n++)
     {
-        auto ev = C<CIMouseButtonEvent>(data);
-        if(ev.btn < 5 && ev.btn > 0)
+        auto cmd_list = draw_data->CmdLists[n];
+
+        CImGui::detail::ContentHash hash;
+        if(!CImGui::detail::HashDrawList(cmd_list, hash, im_frame_primitives) ||
+           cmd_list->CmdBuffer.Size == 0)
         {
-            bool flag                 = ev.mod & CIMouseButtonEvent::Pressed;
-            io->MouseDown[ev.btn - 1] = flag;
-            io->MouseClickedPos[ev.btn - 1] = {ev.pos.x, ev.pos.y};
+            list_layers.push_back(nullptr);
+            continue;
         }
-        break;
-    }
-    case CIEvent::MouseMove:
-    {
-        auto ev      = C<CIMouseMoveEvent>(data);
-        io->MousePos = {
-            (ev.origin.x + ev.delta.x) / io->DisplayFramebufferScale.x,
-            (ev.origin.y + ev.delta.y) / io->DisplayFramebufferScale.y};
 
-        break;
-    }
-    case CIEvent::Scroll:
-    {
-        auto ev        = C<CIScrollEvent>(data);
-        io->MouseWheel = ev.delta.y;
-        break;
-    }
-    case CIEvent::Keyboard:
-    {
-        auto ev = C<CIKeyEvent>(data);
-        if(ev.key < 512)
+        ImVec4 bounds = cmd_list->CmdBuffer[0].ClipRect;
+        for(auto const& cmd : cmd_list->CmdBuffer)
         {
-            if(((ev.key >= CK_a && ev.key <= CK_z) ||
-                (ev.key >= CK_A && ev.key <= CK_Z) ||
-                (ev.key >= CK_0 && ev.key <= CK_9)) &&
-               (ev.mod & CIKeyEvent::RepeatedModifier ||
-                ev.mod & CIKeyEvent::PressedModifier))
-                io->AddInputCharacter(C_CAST<ImWchar>(ev.key));
-
-            io->KeysDown[ev.key] = ev.mod & CIKeyEvent::PressedModifier;
+            bounds.x = std::min(bounds.x, cmd.ClipRect.x);
+            bounds.y = std::min(bounds.y, cmd.ClipRect.y);
+            bounds.z = std::max(bounds.z, cmd.ClipRect.z);
+            bounds.w = std::max(bounds.w, cmd.ClipRect.w);
+        }
 
-            io->KeyAlt   = ev.mod & CIKeyEvent::LAltModifier;
-            io->KeyCtrl  = ev.mod & CIKeyEvent::LCtrlModifier;
-            io->KeyShift = ev.mod & CIKeyEvent::LShiftModifier;
-            io->KeySuper = ev.mod & CIKeyEvent::SuperModifier;
+        bounds.x = std::max(bounds.x, 0.f);
+        bounds.y = std::max(bounds.y, 0.f);
+        bounds.z = std::min(bounds.z, C_CAST<f32>(fb_width));
+        bounds.w = std::min(bounds.w, C_CAST<f32>(fb_height));
 
-            switch(ev.key)
-            {
-            case CK_LShift:
-            case CK_RShift:
-                io->KeyShift = true;
-                break;
-            case CK_LCtrl:
-            case CK_RCtrl:
-                io->KeyCtrl = true;
-                break;
-            case CK_AltGr:
-            case CK_LAlt:
-                io->KeyAlt = true;
-                break;
-            case CK_LSuper:
-            case CK_RSuper:
-                io->KeyShift = true;
-                break;
-            }
+        if(bounds.z <= bounds.x || bounds.w <= bounds.y)
+        {
+            list_layers.push_back(nullptr);
+            continue;
         }
-        break;
+
+        bool  dirty = false;
+        auto& layer = im_data->layers.acquire(
+            CImGui::detail::LayerCache<GFX>::key_of(cmd_list, n),
+            im_data->frame,
+            bounds,
+            hash.digest(),
+            dirty);
+
+        list_layers.push_back(&layer);
+
+        if(!dirty)
+            stats.layers_reused++;
+
+        /* The layer texture is bottom-up, with its top at origin_y */
+        const f32   x0    = layer.origin_x / scale.x;
+        const f32   y0    = layer.origin_y / scale.y;
+        const f32   x1    = (layer.origin_x + layer.width) / scale.x;
+        const f32   y1    = (layer.origin_y + layer.height) / scale.y;
+        const ImU32 white = 0xFFFFFFFF;
+        const auto  base  = C_FCAST<ImDrawIdx>(vertices.size());
+
+        vertices.push_back({{x0, y0}, {0.f, 1.f}, white});
+        vertices.push_back({{x1, y0}, {1.f, 1.f}, white});
+        vertices.push_back({{x1, y1}, {1.f, 0.f}, white});
+        vertices.push_back({{x0, y1}, {0.f, 0.f}, white});
+
+        for(ImDrawIdx i : {0, 1, 2, 0, 2, 3})
+            elements.push_back(C_FCAST<ImDrawIdx>(base + i));
     }
-    case CIEvent::TextInput:
+
+    stats.layers_evicted = im_data->layers.evict(im_data->frame);
+    stats.layer_bytes    = im_data->layers.memory_usage();
+}
+
+/* RenderFlag_RetainedLists, assigns every list its resident ranges and
+ *  uploads those of lists which changed */
+template<typename GFX>
+static void RetainLists(
+    ImGuiData<GFX>* im_data, ImDrawData* draw_data, CImGui::RenderStats& stats)
+{
+    DProfContext _(IM_API "Retaining draw lists");
+
+    using CImGui::detail::RetainedLists;
+    using CImGui::detail::WriteRange;
+
+    auto&      retained         = im_data->retained_lists;
+    const auto frames_in_flight = im_stream_config.frames_in_flight;
+
+    if(!retained.assign(draw_data, im_data->frame, frames_in_flight))
     {
-        auto ev = C<CIWriteEvent>(data);
-        io->AddInputCharactersUTF8(ev.text);
-        break;
+        /* Re-allocating orphans the resident lists, all are uploaded */
+        const auto vertex_capacity = RetainedLists::grow_capacity(
+            retained.vertices().capacity(),
+            C_FCAST<u32>(draw_data->TotalVtxCount));
+        const auto element_capacity = RetainedLists::grow_capacity(
+            retained.elements().capacity(),
+            C_FCAST<u32>(draw_data->TotalIdxCount));
+
+        retained.reset(vertex_capacity, element_capacity);
+        im_data->vertices.commit(vertex_capacity * sizeof(ImDrawVert), nullptr);
+        im_data->elements.commit(element_capacity * sizeof(ImDrawIdx), nullptr);
+
+        retained.assign(draw_data, im_data->frame, frames_in_flight);
     }
-    case CIEvent::TextEdit:
+
+    for(int n = 0; n < draw_data->CmdListsCount; n++)
     {
-        auto ev = C<CIWEditEvent>(data);
-        io->AddInputCharactersUTF8(ev.text);
-        break;
-    }
-    default:
-        break;
+        auto        cmd_list = draw_data->CmdLists[n];
+        auto const& range    = *retained.lists()[n];
+
+        const auto vtx_size = range.vertex_count * sizeof(ImDrawVert);
+        const auto idx_size = range.element_count * sizeof(ImDrawIdx);
+
+        if(!range.upload)
+        {
+            stats.retained_lists_reused++;
+            stats.retained_bytes_reused += vtx_size + idx_size;
+            continue;
+        }
+
+        WriteRange(
+            im_data->vertices,
+            range.vertex_offset * sizeof(ImDrawVert),
+            cmd_list->VtxBuffer.Data,
+            vtx_size);
+        WriteRange(
+            im_data->elements,
+            range.element_offset * sizeof(ImDrawIdx),
+            cmd_list->IdxBuffer.Data,
+            idx_size);
+
+        stats.retained_lists_uploaded++;
+        stats.retained_bytes_uploaded += vtx_size + idx_size;
+        stats.upload_calls += 2;
+        stats.upload_bytes += vtx_size + idx_size;
     }
+
+    stats.retained_lists_evicted = retained.evicted();
 }
 
-static void SetStyle()
+/* Converts the lists of `draw_data`, followed by the layer composite quads,
+ *  into staging_quant_vertices. False if any vertex is out of range. */
+template<typename GFX>
+static bool QuantizeFrame(
+    ImGuiData<GFX>* im_data, ImDrawData* draw_data, bool layered)
 {
-    DProfContext _(IM_API "Applying custom style");
-    ImGuiStyle&  style      = ImGui::GetStyle();
-    style.WindowRounding    = 3.f;
-    style.FrameRounding     = 3.f;
-    style.ScrollbarRounding = 0;
-    style.FramePadding      = {3.f, 3.f};
+    DProfContext _(IM_API "Quantizing vertices");
 
-    style.Colors[ImGuiCol_PlotHistogram]        = ImVec4(.3f, .3f, .9f, 1.f);
-    style.Colors[ImGuiCol_PlotLines]            = ImVec4(.3f, .3f, .9f, 1.f);
-    style.Colors[ImGuiCol_PlotHistogramHovered] = ImVec4(.2f, .2f, .9f, 1.f);
-    style.Colors[ImGuiCol_PlotLinesHovered]     = ImVec4(.2f, .2f, .9f, 1.f);
+    auto const& quad_vertices = im_data->composite_vertices;
+    auto&       out_vertices  = im_data->staging_quant_vertices;
 
-    style.Colors[ImGuiCol_ScrollbarGrabActive] = ImVec4(.2f, .2f, .9f, 1.f);
-    style.Colors[ImGuiCol_SliderGrabActive]    = ImVec4(.2f, .2f, .9f, 1.f);
+    out_vertices.resize(
+        C_FCAST<szptr>(draw_data->TotalVtxCount) +
+        (layered ? quad_vertices.size() : 0));
 
-    style.Colors[ImGuiCol_Button]        = ImVec4(.2f, .2f, .9f, 1.f);
-    style.Colors[ImGuiCol_ButtonActive]  = ImVec4(.3f, .3f, .9f, 1.f);
-    style.Colors[ImGuiCol_ButtonHovered] = ImVec4(.5f, .5f, .9f, 1.f);
+    auto out = out_vertices.data();
 
-    style.Colors[ImGuiCol_FrameBg]        = ImVec4(.2f, .2f, .5f, 1.f);
-    style.Colors[ImGuiCol_FrameBgActive]  = ImVec4(.3f, .3f, .5f, 1.f);
+    for(int n = 0; n < draw_data->CmdListsCount; n++)
+    {
+        auto       cmd_list = draw_data->CmdLists[n];
+        const auto count    = C_FCAST<szptr>(cmd_list->VtxBuffer.Size);
+
+        if(!CImGui::detail::QuantizeVertices(
+               cmd_list->VtxBuffer.Data, count, out))
+            return false;
+
+        out += count;
+    }
+
+    return !layered || CImGui::detail::QuantizeVertices(
+                           quad_vertices.data(), quad_vertices.size(), out);
+}
+
+/* Draws a list into its layer, leaving the layer's framebuffer bound */
+template<typename GFX>
+static void RenderLayer(
+    ImGuiData<GFX>*             im_data,
+    Layer<GFX>&                 layer,
+    ImDrawList const*           cmd_list,
+    u32                         vtx_offset,
+    u32                         idx_offset,
+    ImVec2 const&               scale,
+    StateShadow<GFX>&           shadow,
+    typename GFX::D_CALL const& dc,
+    typename GFX::D_DATA const& base,
+    CImGui::RenderStats&        stats)
+{
+    typename GFX::DBG::SCOPE _(IM_API "Rendering layer");
+
+    layer.framebuffer.use(RHI::FramebufferT::All);
+    layer.framebuffer.clear(0, {0.f, 0.f, 0.f, 0.f});
+
+    const auto w = C_CAST<f32>(layer.width);
+    const auto h = C_CAST<f32>(layer.height);
+
+    SetProjection(
+        im_data->projection_matrix,
+        2.f * scale.x / w,
+        -2.f * scale.y / h,
+        -2.f * layer.origin_x / w - 1.f,
+        2.f * layer.origin_y / h + 1.f);
+    ApplyUvUnit(im_data);
+
+    typename GFX::VIEWSTATE view(1);
+    view.m_depth.clear();
+    view.m_view[0] = {
+        0, 0, C_CAST<i32>(layer.width), C_CAST<i32>(layer.height)};
+
+    shadow.invalidate_scissor();
+
+    auto& batcher = im_data->layer_batcher;
+    batcher.clear();
+
+    for(auto const& cmd : cmd_list->CmdBuffer)
+    {
+        ImDrawCmd local = cmd;
+        local.ClipRect.x -= layer.origin_x;
+        local.ClipRect.z -= layer.origin_x;
+        local.ClipRect.y -= layer.origin_y;
+        local.ClipRect.w -= layer.origin_y;
+
+        batcher.add(cmd_list, local, vtx_offset, idx_offset);
+        idx_offset += cmd.ElemCount;
+    }
+
+    SubmitBatches(
+        im_data,
+        batcher,
+        shadow,
+        view,
+        dc,
+        base,
+        C_CAST<int>(layer.width),
+        C_CAST<int>(layer.height),
+        stats,
+        CImGui::detail::BlendMode::Layer);
+
+    layer.redraw = false;
+    stats.layers_rendered++;
+}
+
+/* Renders `draw_data`, or with a null `draw_data`, draws the previous frame
+ *  again from the frame target or the resident buffers */
+template<typename GFX>
+static void RenderFrame(ImDrawData* draw_data, FrameDisplay const& display)
+{
+    const auto im_data = ImGuiData<GFX>::Peek();
+
+    /* UnregisterTexture() may run on another thread, free here */
+    BackendStatics<GFX>::textures.collect();
+
+    if(!im_data || im_data->status != CImGui::DeviceStatus::Ready ||
+       (!draw_data && !im_data->frame_cache.resident &&
+        !im_data->frame_cache.target))
+        return;
+
+    // Avoid rendering when minimized, scale coordinates for retina displays
+    // (screen coordinates != framebuffer coordinates)
+    typename GFX::DBG::SCOPE a(IM_API "ImGui render");
+    DProfContext             _(IM_API "Rendering draw lists");
+
+    auto const& scale     = display.framebuffer_scale;
+    int         fb_width  = (int)(display.size.x * scale.x);
+    int         fb_height = (int)(display.size.y * scale.y);
+    if(fb_width == 0 || fb_height == 0)
+        return;
+    if(draw_data)
+        draw_data->ScaleClipRects(scale);
+
+    auto& stats = im_data->stats;
+    stats       = {};
+
+    typename GFX::BLNDSTATE blend;
+    blend.m_doBlend = true;
+    typename GFX::RASTSTATE raster;
+    raster.m_culling = C_CAST<u32>(RHI::Datatypes::Face::Front);
+    typename GFX::DEPTSTATE depth;
+    depth.m_test = false;
+
+    StateShadow<GFX> shadow(stats);
+    shadow.begin_frame(
+        !(im_render_flags & CImGui::RenderFlag_NoStateRestore),
+        blend,
+        raster,
+        depth);
+    typename GFX::VIEWSTATE view_(1);
+
+    const bool layered = !im_data->retained &&
+                         im_render_flags & CImGui::RenderFlag_LayerCache;
+
+    /* Until packing, the frame which may be replayed */
+    SetScreenProjection(im_data, display);
+
+    typename GFX::D_CALL dc(true, false);
+    typename GFX::D_DATA dd;
+    dd.m_eltype =
+        (sizeof(ImDrawIdx) == 2) ? RHI::TypeEnum::UShort : RHI::TypeEnum::UInt;
+
+    auto&      frame_cache = im_data->frame_cache;
+    const bool skip_unchanged =
+        im_render_flags & CImGui::RenderFlag_SkipUnchanged;
+    u64  frame_hash = 0;
+    bool cacheable  = false;
+
+    if(skip_unchanged && draw_data)
+    {
+        DProfContext _(IM_API "Hashing draw data");
+
+        CImGui::detail::ContentHash hash;
+        hash.value(fb_width).value(fb_height).value(display.size);
+
+        cacheable = true;
+        for(int n = 0; n < draw_data->CmdListsCount; n++)
+            cacheable =
+                CImGui::detail::HashDrawList(
+                    draw_data->CmdLists[n], hash, im_frame_primitives) &&
+                cacheable;
+
+        frame_hash = hash.digest();
+    }
+
+    const bool unchanged = skip_unchanged && cacheable && frame_cache.valid &&
+                           frame_cache.hash == frame_hash;
+
+    /* Retained lists are not uploaded to the rings, which the frame
+     *  target's quad goes through */
+    const bool to_target =
+        draw_data && skip_unchanged && cacheable && !im_data->retained;
+    const bool from_target =
+        (!draw_data || unchanged) && frame_cache.target != nullptr;
+
+    /* Layers and the frame target change the viewport, which is set back
+     *  for compositing */
+    if(layered || to_target || from_target)
+        view_.m_view[0] = {0, 0, fb_width, fb_height};
+    else
+        view_.m_view.clear();
+    view_.m_depth.clear();
+
+    if(!draw_data || unchanged)
+    {
+        DProfContext _(IM_API "Replaying previous frame");
+
+        if(unchanged)
+            frame_cache.hits++;
+
+        /* Nothing is uploaded, the target or the rings still hold the
+         *  last frame */
+        if(from_target)
+            CompositeFrameTarget(
+                im_data, shadow, view_, dc, dd, fb_width, fb_height, stats);
+        else
+        {
+            im_data->batcher.submitted_runs = 0;
+            SubmitBatches(
+                im_data,
+                im_data->batcher,
+                shadow,
+                view_,
+                dc,
+                dd,
+                fb_width,
+                fb_height,
+                stats);
+        }
+
+        stats.draws_before       = im_data->batcher.input_commands;
+        stats.draws_after        = im_data->batcher.output_commands();
+        stats.frame_cache_hits   = frame_cache.hits;
+        stats.frame_cache_misses = frame_cache.misses;
+        stats.quantize_fallbacks = im_data->quantize_fallbacks;
+        stats.vertex_stream      = im_data->vertex_ring.allocator().stats();
+        stats.element_stream     = im_data->element_ring.allocator().stats();
+
+        shadow.end_frame();
+        return;
+    }
+
+    if(skip_unchanged)
+        frame_cache.misses++;
+
+    im_data->frame++;
+
+    if(!im_glyphs.empty())
+    {
+        im_glyphs.resolve(
+            draw_data,
+            Traits<GFX>::texture_id(im_data->fonts),
+            im_data->frame);
+        UploadDynamicGlyphs(im_data);
+    }
+
+    im_data->vertex_ring.begin_frame(im_data->frame);
+    im_data->element_ring.begin_frame(im_data->frame);
+    im_data->primitive_ring.begin_frame(im_data->frame);
+
+    auto const& instances = im_frame_primitives->instances;
+
+    if(im_data->primitive_view && !instances.empty())
+    {
+        using Instance = CImGui::detail::PrimitiveInstance;
+
+        const auto size = instances.size() * sizeof(Instance);
+
+        im_data->primitive_base = C_FCAST<u32>(
+            im_data->primitive_ring.upload(
+                instances.data(), size, sizeof(Instance)) /
+            sizeof(Instance));
+
+        stats.upload_calls++;
+        stats.upload_bytes += size;
+    }
+
+    /* Layers are drawn out of order, so all lists must be resident. Clip
+     *  and quantised vertices are only produced while packing. */
+    const bool batch_upload =
+        !im_data->retained &&
+        (layered || im_data->shader_clip || im_data->quantized ||
+         im_render_flags & CImGui::RenderFlag_BatchUpload);
+
+    if(im_data->retained)
+        RetainLists(im_data, draw_data, stats);
+
+    if(layered)
+        PrepareLayers(
+            im_data,
+            draw_data,
+            scale,
+            fb_width,
+            fb_height,
+            stats);
+
+    u32  vtx_base        = 0;
+    u32  idx_base        = 0;
+    u32  quad_vtx        = 0;
+    u32  quad_idx        = 0;
+    bool shared_vertices = false;
+
+    if(batch_upload)
+    {
+        DProfContext _(IM_API "Packing draw lists");
+
+        auto& vertices = im_data->staging_vertices;
+        auto& elements = im_data->staging_elements;
+
+        auto const& quad_vertices = im_data->composite_vertices;
+        auto const& quad_elements = im_data->composite_elements;
+
+        const auto vertex_count = C_FCAST<szptr>(draw_data->TotalVtxCount) +
+                                  (layered ? quad_vertices.size() : 0);
+
+        c_cptr vertex_data = nullptr;
+        szptr  vertex_size = sizeof(ImDrawVert);
+
+        /* Out of range frames fall back to ImDrawVert as a whole, and are
+         *  tried less often while they keep doing so */
+        const bool try_quantize =
+            im_data->quantized && im_data->quantize_backoff.attempt();
+        const bool quantized =
+            try_quantize && QuantizeFrame(im_data, draw_data, layered);
+
+        if(try_quantize)
+            im_data->quantize_backoff.update(quantized);
+        if(try_quantize && !quantized)
+            im_data->quantize_fallbacks++;
+
+        if(im_data->shader_clip)
+        {
+            auto& clip_vertices = im_data->staging_clip_vertices;
+            clip_vertices.resize(vertex_count);
+
+            auto out = clip_vertices.data();
+
+            for(int n = 0; n < draw_data->CmdListsCount; n++)
+            {
+                auto       cmd_list = draw_data->CmdLists[n];
+                const auto count    = C_FCAST<szptr>(cmd_list->VtxBuffer.Size);
+
+                CImGui::detail::ConvertVertices(
+                    cmd_list->VtxBuffer.Data, count, out);
+
+                /* Layers are drawn with scissor state */
+                if(!layered)
+                    CImGui::detail::AssignClipRects(cmd_list, fb_height, out);
+
+                out += count;
+            }
+
+            if(layered)
+                CImGui::detail::ConvertVertices(
+                    quad_vertices.data(), quad_vertices.size(), out);
+
+            vertex_data = clip_vertices.data();
+            vertex_size = sizeof(CImGui::detail::ClipVertex);
+        } else if(quantized)
+        {
+            vertex_data = im_data->staging_quant_vertices.data();
+            vertex_size = sizeof(CImGui::detail::QuantVertex);
+
+            stats.quantized_bytes_saved =
+                vertex_count * (sizeof(ImDrawVert) - vertex_size);
+        } else
+        {
+            vertices.resize(vertex_count);
+
+            auto vtx_it = vertices.begin();
+
+            for(int n = 0; n < draw_data->CmdListsCount; n++)
+            {
+                auto cmd_list = draw_data->CmdLists[n];
+
+                vtx_it = std::copy(
+                    cmd_list->VtxBuffer.begin(),
+                    cmd_list->VtxBuffer.end(),
+                    vtx_it);
+            }
+
+            if(layered)
+                std::copy(quad_vertices.begin(), quad_vertices.end(), vtx_it);
+
+            vertex_data = vertices.data();
+        }
+
+        elements.resize(
+            C_FCAST<szptr>(draw_data->TotalIdxCount) +
+            (layered ? quad_elements.size() : 0));
+
+        /* Indices are rebased onto the vertices of the whole frame when
+         *  they fit, so that commands of different lists can merge */
+        shared_vertices =
+            vertex_count <=
+            C_FCAST<szptr>(std::numeric_limits<ImDrawIdx>::max()) + 1;
+
+        auto idx_it   = elements.begin();
+        u32  list_vtx = 0;
+
+        for(int n = 0; n < draw_data->CmdListsCount; n++)
+        {
+            auto cmd_list = draw_data->CmdLists[n];
+
+            if(shared_vertices)
+                idx_it = RebaseElements(cmd_list->IdxBuffer, list_vtx, idx_it);
+            else
+                idx_it = std::copy(
+                    cmd_list->IdxBuffer.begin(),
+                    cmd_list->IdxBuffer.end(),
+                    idx_it);
+
+            list_vtx += C_FCAST<u32>(cmd_list->VtxBuffer.Size);
+        }
+
+        if(layered && shared_vertices)
+            RebaseElements(quad_elements, list_vtx, idx_it);
+        else if(layered)
+            std::copy(quad_elements.begin(), quad_elements.end(), idx_it);
+
+        stats.shared_vertices = shared_vertices;
+
+        vtx_base = C_FCAST<u32>(
+            im_data->vertex_ring.upload(
+                vertex_data, vertex_count * vertex_size, vertex_size) /
+            vertex_size);
+        idx_base = C_FCAST<u32>(
+            im_data->element_ring.upload(
+                elements.data(),
+                elements.size() * sizeof(ImDrawIdx),
+                sizeof(ImDrawIdx)) /
+            sizeof(ImDrawIdx));
+
+        stats.upload_calls += 2;
+        stats.upload_bytes += vertex_count * vertex_size +
+                              elements.size() * sizeof(ImDrawIdx);
+
+        quad_vtx = shared_vertices
+                       ? vtx_base
+                       : vtx_base + C_FCAST<u32>(draw_data->TotalVtxCount);
+        quad_idx = idx_base + C_FCAST<u32>(draw_data->TotalIdxCount);
+
+        if(quantized != im_data->quantized_frame)
+        {
+            im_data->quantized_frame = quantized;
+            SetScreenProjection(im_data, display);
+        }
+    }
+
+    auto& batcher = im_data->batcher;
+    batcher.clear();
+    batcher.merge_clip = im_data->shader_clip && !layered;
+
+    const auto grow_count = im_data->vertex_ring.allocator().stats().grow_count +
+                            im_data->element_ring.allocator().stats().grow_count;
+
+    bool layers_drawn = false;
+
+    /* Layers switch framebuffers, the host may not draw to the default */
+    typename Traits<GFX>::framebuffer_binding host_framebuffer = {};
+
+    /* The UI is drawn premultiplied into the frame target, and the target
+     *  over the host's framebuffer */
+    Layer<GFX>* target      = nullptr;
+    auto        screen_mode = CImGui::detail::BlendMode::Straight;
+
+    if(to_target)
+    {
+        target = &im_data->layers.frame_target(
+            C_CAST<u32>(fb_width), C_CAST<u32>(fb_height));
+        screen_mode      = CImGui::detail::BlendMode::Layer;
+        host_framebuffer = Traits<GFX>::current_framebuffer();
+
+        target->framebuffer.use(RHI::FramebufferT::All);
+        target->framebuffer.clear(0, {0.f, 0.f, 0.f, 0.f});
+    }
+
+    frame_cache.target = nullptr;
+
+    for(int n = 0; n < draw_data->CmdListsCount; n++)
+    {
+        typename GFX::DBG::SCOPE _(IM_API "Command list");
+
+        auto cmd_list = draw_data->CmdLists[n];
+
+        u32 vtx_offset = 0;
+        u32 idx_offset = 0;
+
+        if(im_data->retained)
+        {
+            auto const& range = *im_data->retained_lists.lists()[n];
+
+            vtx_offset = range.vertex_offset;
+            idx_offset = range.element_offset;
+        } else if(batch_upload)
+        {
+            /* Indices in a list are relative to its own vertices, unless
+             *  they were rebased */
+            vtx_offset = vtx_base;
+            idx_offset = idx_base;
+
+            if(!shared_vertices)
+                vtx_base += C_FCAST<u32>(cmd_list->VtxBuffer.Size);
+            idx_base += C_FCAST<u32>(cmd_list->IdxBuffer.Size);
+        } else
+        {
+            const auto vtx_size =
+                C_FCAST<szptr>(cmd_list->VtxBuffer.Size) * sizeof(ImDrawVert);
+            const auto idx_size =
+                C_FCAST<szptr>(cmd_list->IdxBuffer.Size) * sizeof(ImDrawIdx);
+
+            vtx_offset = C_FCAST<u32>(
+                im_data->vertex_ring.upload(
+                    cmd_list->VtxBuffer.Data, vtx_size, sizeof(ImDrawVert)) /
+                sizeof(ImDrawVert));
+            idx_offset = C_FCAST<u32>(
+                im_data->element_ring.upload(
+                    cmd_list->IdxBuffer.Data, idx_size, sizeof(ImDrawIdx)) /
+                sizeof(ImDrawIdx));
+
+            stats.upload_calls += 2;
+            stats.upload_bytes += vtx_size + idx_size;
+        }
+
+        if(auto layer = layered ? im_data->list_layers[n] : nullptr)
+        {
+            if(layer->redraw)
+            {
+                if(!layers_drawn && !target)
+                    host_framebuffer = Traits<GFX>::current_framebuffer();
+
+                RenderLayer(
+                    im_data,
+                    *layer,
+                    cmd_list,
+                    vtx_offset,
+                    idx_offset,
+                    scale,
+                    shadow,
+                    dc,
+                    dd,
+                    stats);
+                layers_drawn = true;
+            }
+
+            ImDrawCmd composite;
+            composite.ElemCount = 6;
+            composite.ClipRect  = {0.f,
+                                  0.f,
+                                  C_CAST<f32>(fb_width),
+                                  C_CAST<f32>(fb_height)};
+            composite.TextureId = C_RCAST<ImTextureID>(layer);
+
+            batcher.add(cmd_list, composite, quad_vtx, quad_idx);
+            quad_idx += 6;
+            continue;
+        }
+
+        for(int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++)
+        {
+            auto const& cmd = cmd_list->CmdBuffer[cmd_i];
+
+            batcher.add(cmd_list, cmd, vtx_offset, idx_offset);
+            idx_offset += cmd.ElemCount;
+        }
+
+        /* Without batched uploads, the ring may be re-allocated by the next
+         *  list, so this list is drawn right away */
+        if(!batch_upload && !im_data->retained)
+            SubmitBatches(
+                im_data,
+                batcher,
+                shadow,
+                view_,
+                dc,
+                dd,
+                fb_width,
+                fb_height,
+                stats,
+                screen_mode);
+    }
+
+    if(layers_drawn)
+    {
+        if(target)
+            target->framebuffer.use(RHI::FramebufferT::All);
+        else
+            Traits<GFX>::restore_framebuffer(host_framebuffer);
+        SetScreenProjection(im_data, display);
+        shadow.invalidate_scissor();
+    }
+
+    SubmitBatches(
+        im_data,
+        batcher,
+        shadow,
+        view_,
+        dc,
+        dd,
+        fb_width,
+        fb_height,
+        stats,
+        screen_mode);
+
+    if(target)
+    {
+        Traits<GFX>::restore_framebuffer(host_framebuffer);
+        UploadFrameQuad(im_data, *target, display, fb_width, fb_height, stats);
+        CompositeFrameTarget(
+            im_data, shadow, view_, dc, dd, fb_width, fb_height, stats);
+    }
+
+    batcher.release_lists();
+
+    stats.draws_before = batcher.input_commands;
+    stats.draws_after  = batcher.output_commands();
+
+    im_data->vertex_ring.end_frame();
+    im_data->element_ring.end_frame();
+    im_data->primitive_ring.end_frame();
+    stats.vertex_stream  = im_data->vertex_ring.allocator().stats();
+    stats.element_stream = im_data->element_ring.allocator().stats();
+
+    /* Growing a ring mid-frame orphans the lists uploaded before it */
+    const bool resident =
+        batch_upload ||
+        grow_count == stats.vertex_stream.grow_count +
+                          stats.element_stream.grow_count;
+
+    frame_cache.hash     = frame_hash;
+    frame_cache.resident = resident;
+    frame_cache.valid = skip_unchanged && cacheable && (target || resident);
+
+    stats.frame_cache_hits   = frame_cache.hits;
+    stats.frame_cache_misses = frame_cache.misses;
+    stats.quantize_fallbacks = im_data->quantize_fallbacks;
+
+    shadow.end_frame();
+}
+
+// This is the main rendering function that you have to implement and provide to
+// ImGui (via setting up 'RenderDrawListsFn' in the ImGuiIO structure) If text
+// or lines are blurry when integrating ImGui in your engine:
+// - in your Render function, try translating your projection matrix by
+// (0.5f,0.5f) or (0.375f,0.375f)
+template<typename GFX>
+static void ImGui_ImplSdlGL3_RenderDrawLists(ImDrawData* draw_data)
+{
+    RenderFrame<GFX>(draw_data, IoDisplay());
+}
+
+static void ImGui_SoftwareRenderDrawLists(ImDrawData* draw_data)
+{
+    if(im_software)
+        im_software->render(draw_data);
+}
+
+static const char* ImGui_ImplSdlGL3_GetClipboardText(void*)
+{
+    return nullptr;
+}
+
+static void ImGui_ImplSdlGL3_SetClipboardText(void*, const char*)
+{
+    //    SDL_SetClipboardText(text);
+}
+
+/* GLES 2.0 has no single-channel textures */
+static bool UseAlphaAtlas()
+{
+#if defined(COFFEE_GLES20_MODE)
+    return false;
+#else
+    return im_render_flags & CImGui::RenderFlag_AlphaFontAtlas;
+#endif
+}
+
+#if defined(COFFEE_IMGUI_BAKED_ATLAS)
+namespace Coffee {
+namespace CImGui {
+namespace detail {
+extern const u8    baked_atlas[];
+extern const szptr baked_atlas_size;
+} // namespace detail
+} // namespace CImGui
+} // namespace Coffee
+#endif
+
+static constexpr cstring im_atlas_cache_file = "imgui_font_atlas.bin";
+
+/* Fills in the atlas from the baked or on-disk cache, or builds it and
+ *  writes the on-disk cache. A hash mismatch is treated as a cache miss. */
+static CImGui::FontAtlasStats::Source LoadFontAtlas(ImFontAtlas& atlas)
+{
+    using CImGui::detail::AtlasCache;
+    using Source = CImGui::FontAtlasStats::Source;
+
+    if(atlas.TexPixelsAlpha8)
+        return Source::Built;
+
+    if(!(im_render_flags & CImGui::RenderFlag_FontAtlasCache))
+    {
+        CImGui::detail::BuildAtlas(atlas);
+        return Source::Built;
+    }
+
+    const auto hash = AtlasCache::ConfigHash(atlas);
+
+    if(!AtlasCache::Cacheable(atlas))
+    {
+        CImGui::detail::BuildAtlas(atlas);
+        return Source::Built;
+    }
+
+#if defined(COFFEE_IMGUI_BAKED_ATLAS)
+    if(AtlasCache::Restore(
+           atlas,
+           CImGui::detail::baked_atlas,
+           CImGui::detail::baked_atlas_size,
+           hash))
+        return Source::Baked;
+#endif
+
+    CResources::Resource cache(MkUrl(im_atlas_cache_file, RSCA::CachedFile));
+
+    if(CResources::FileExists(cache) && CResources::FilePull(cache))
+    {
+        auto restored = AtlasCache::Restore(
+            atlas, C_RCAST<const u8*>(cache.data), cache.size, hash);
+        CResources::FileFree(cache);
+
+        if(restored)
+            return Source::DiskCache;
+
+        cDebug(IM_API "Font atlas cache is stale, rebuilding");
+    }
+
+    CImGui::detail::BuildAtlas(atlas);
+
+    Vector<u8> blob;
+
+    if(AtlasCache::Serialize(atlas, hash, blob))
+    {
+        cache.data = blob.data();
+        cache.size = blob.size();
+
+        if(!CResources::FileCommit(
+               cache, RSCA::WriteOnly | RSCA::Discard | RSCA::NewFile))
+            cWarning(IM_API "Failed to write font atlas cache");
+    }
+
+    return Source::Built;
+}
+
+/* Uploads glyphs rasterised since the last call */
+template<typename GFX>
+static void UploadDynamicGlyphs(ImGuiData<GFX>* im_data)
+{
+    auto&      s          = im_data->fonts;
+    const bool alpha_only = s.m_pixfmt == PixFmt::R8;
+    auto&      expanded   = im_data->glyph_staging;
+
+    im_glyphs.flush([&](CImGui::detail::GlyphCache::dirty_span const& span,
+                        const u8*                                     pixels) {
+        const auto size  = size_2d<u32>{span.width, span.height};
+        const auto count = span.width * span.height;
+
+        if(alpha_only)
+        {
+            s.upload(
+                {s.m_pixfmt, BitFmt::UByte, PixCmp::R},
+                size,
+                Bytes::From(pixels, count),
+                point_2d<u32>{span.x, span.y});
+            return;
+        }
+
+        /* Same expansion as ImFontAtlas::GetTexDataAsRGBA32() */
+        expanded.resize(count * 4);
+        for(u32 i = 0; i < count; i++)
+        {
+            expanded[i * 4 + 0] = 255;
+            expanded[i * 4 + 1] = 255;
+            expanded[i * 4 + 2] = 255;
+            expanded[i * 4 + 3] = pixels[i];
+        }
+
+        s.upload(
+            {s.m_pixfmt, BitFmt::UByte, PixCmp::RGBA},
+            size,
+            Bytes::From(expanded.data(), expanded.size()),
+            point_2d<u32>{span.x, span.y});
+    });
+}
+
+static bool UseSdfAtlas()
+{
+    return UseAlphaAtlas() &&
+           im_render_flags & CImGui::RenderFlag_SdfFontAtlas;
+}
+
+static bool UseShaderClip()
+{
+    return im_render_flags & CImGui::RenderFlag_ShaderClip;
+}
+
+static bool UsePrimitives()
+{
+    return im_render_flags & CImGui::RenderFlag_Primitives;
+}
+
+/* RenderFlag_ShaderClip has its own vertex format */
+static bool UseQuantizedVertices()
+{
+    return !UseShaderClip() &&
+           im_render_flags & CImGui::RenderFlag_QuantizedVertices;
+}
+
+/* Retained lists are stored as ImDrawVert */
+static bool UseRetainedLists()
+{
+    return !UseShaderClip() && !UseQuantizedVertices() &&
+           im_render_flags & CImGui::RenderFlag_RetainedLists;
+}
+
+/* The software renderer draws on the calling thread */
+static bool UseDeferredSubmit()
+{
+    return !im_software && im_render_flags & CImGui::RenderFlag_DeferredSubmit;
+}
+
+static unsigned char* ConvertToSdf(
+    ImFontAtlas& atlas, unsigned char* pixels, int width, int height)
+{
+    if(im_sdf_source == pixels && !im_sdf_pixels.empty())
+        return im_sdf_pixels.data();
+
+    DProfContext _(IM_API "Generating distance field");
+
+    im_sdf_pixels.resize(C_FCAST<szptr>(width * height));
+    CImGui::detail::GenerateSdf(
+        pixels,
+        C_FCAST<u32>(width),
+        C_FCAST<u32>(height),
+        CImGui::detail::sdf_spread,
+        im_sdf_pixels.data());
+
+    /* Solid shapes sample this texel, it must be fully inside */
+    const auto white_x = C_CAST<int>(atlas.TexUvWhitePixel.x * width);
+    const auto white_y = C_CAST<int>(atlas.TexUvWhitePixel.y * height);
+    im_sdf_pixels[C_FCAST<szptr>(white_y * width + white_x)] = 255;
+
+    im_sdf_source = pixels;
+
+    return im_sdf_pixels.data();
+}
+
+static FontAtlasData PrepareFontAtlas(bool alpha_only)
+{
+    DProfContext _(IM_API "Preparing font atlas");
+
+    using clock = Chrono::high_resolution_clock;
+
+    auto start = clock::now();
+
+    ImGuiIO&      io = ImGui::GetIO();
+    FontAtlasData out;
+
+    out.alpha_only     = alpha_only;
+    out.distance_field = UseSdfAtlas();
+
+    const bool distance_field = out.distance_field;
+
+    /* Keeps neighbouring glyphs out of each other's falloff */
+    if(distance_field && !io.Fonts->TexPixelsAlpha8)
+        io.Fonts->TexGlyphPadding = std::max(
+            io.Fonts->TexGlyphPadding,
+            C_CAST<int>(CImGui::detail::sdf_spread));
+
+    out.source = LoadFontAtlas(*io.Fonts);
+
+    if(alpha_only)
+        io.Fonts->GetTexDataAsAlpha8(&out.pixels, &out.width, &out.height);
+    else
+        io.Fonts->GetTexDataAsRGBA32(&out.pixels, &out.width, &out.height);
+
+    if(distance_field)
+        out.pixels = ConvertToSdf(*io.Fonts, out.pixels, out.width, out.height);
+
+    im_glyphs.set_sdf_spread(distance_field ? CImGui::detail::sdf_spread : 0);
+
+    out.surface_height = C_FCAST<u32>(out.height);
+    if(!im_glyphs.empty())
+        out.surface_height = im_glyphs.install(*io.Fonts);
+
+    out.build_time =
+        Chrono::duration_cast<Chrono::microseconds>(clock::now() - start);
+
+    return out;
+}
+
+/* The software renderer samples the Alpha8 atlas directly */
+static void PrepareSoftwareFonts()
+{
+    ImGuiIO& io       = ImGui::GetIO();
+    auto     sentinel = C_RCAST<ImTextureID>(io.Fonts);
+
+    if(io.Fonts->TexID == sentinel)
+        return;
+
+    DProfContext _(IM_API "Preparing software font atlas");
+
+    unsigned char* pixels;
+    int            width, height;
+
+    LoadFontAtlas(*io.Fonts);
+    io.Fonts->GetTexDataAsAlpha8(&pixels, &width, &height);
+
+    im_software->addTexture(
+        sentinel,
+        {pixels, C_CAST<u32>(width), C_CAST<u32>(height), true});
+    io.Fonts->TexID = sentinel;
+}
+
+template<typename GFX>
+static void ImGui_ImplSdlGL3_CreateFontsTexture(FontAtlasData const& atlas)
+{
+    const auto im_data = ImGuiData<GFX>::Peek();
+
+    DProfContext             _(IM_API "Creating font atlas");
+    typename GFX::DBG::SCOPE a(IM_API "Create font atlas");
+
+    using clock = Chrono::high_resolution_clock;
+
+    auto& atlas_stats = im_data->atlas_stats;
+    auto  start       = clock::now();
+
+    ImGuiIO&   io             = ImGui::GetIO();
+    const auto components     = atlas.alpha_only ? PixCmp::R : PixCmp::RGBA;
+    const auto distance_field = atlas.distance_field;
+
+    auto pixelDataSize = GetPixSize(
+        BitFmt::UByte, components, C_FCAST<u32>(atlas.width * atlas.height));
+
+    auto& s  = im_data->fonts;
+    auto& sm = im_data->fonts_sampler;
+
+    auto static_size  = size_2d<i32>{atlas.width, atlas.height}.convert<u32>();
+    auto surface_size = size_2d<u32>{static_size.w, atlas.surface_height};
+
+    s.allocate(surface_size, components);
+    s.upload(
+        {s.m_pixfmt, BitFmt::UByte, components},
+        static_size,
+        Bytes::From(atlas.pixels, pixelDataSize));
+
+    UploadDynamicGlyphs(im_data);
+
+    sm.alloc();
+    sm.setFiltering(Filtering::Linear, Filtering::Linear);
+
+    io.Fonts->TexID = Traits<GFX>::texture_id(s);
+
+    atlas_stats.upload_time =
+        Chrono::duration_cast<Chrono::microseconds>(clock::now() - start);
+    atlas_stats.width  = surface_size.w;
+    atlas_stats.height = surface_size.h;
+    atlas_stats.bytes  = GetPixSize(
+        BitFmt::UByte, components, surface_size.w * surface_size.h);
+    atlas_stats.alpha_only     = atlas.alpha_only;
+    atlas_stats.distance_field = distance_field;
+    atlas_stats.source         = atlas.source;
+    atlas_stats.build_time     = atlas.build_time;
+}
+
+template<typename T>
+inline T const& C(c_cptr d)
+{
+    return *(C_FCAST<T const*>(d));
+}
+
+void ImGui_InputHandle(CIEvent const& ev, c_ptr data)
+{
+    auto io = &ImGui::GetIO();
+
+    im_input_generation++;
+
+    switch(ev.type)
+    {
+    case CIEvent::TouchPan:
+    {
+        CIMTouchMotionEvent const& pan = C<CIMTouchMotionEvent>(data);
+
+        io->MousePos = {
+            (pan.origin.x + pan.translation.x) / io->DisplayFramebufferScale.x,
+            (pan.origin.y + pan.translation.y) / io->DisplayFramebufferScale.y};
+
+        auto btn = CIMouseButtonEvent::LeftButton;
+
+        io->MouseDown[btn - 1]       = true;
+        io->MouseClickedPos[btn - 1] = io->MousePos;
+
+        break;
+    }
+    case CIEvent::TouchTap:
+    {
+        CITouchTapEvent const& tap = C<CITouchTapEvent>(data);
+
+        io->MouseDown[CIMouseButtonEvent::LeftButton - 1]       = tap.pressed;
+        io->MouseClickedPos[CIMouseButtonEvent::LeftButton - 1] = {
+            tap.pos.x / io->DisplayFramebufferScale.x,
+            tap.pos.y / io->DisplayFramebufferScale.y};
+
+        break;
+    }
+    case CIEvent::MouseButton:
+    {
+        auto ev = C<CIMouseButtonEvent>(data);
+        if(ev.btn < 5 && ev.btn > 0)
+        {
+            bool flag                 = ev.mod & CIMouseButtonEvent::Pressed;
+            io->MouseDown[ev.btn - 1] = flag;
+            io->MouseClickedPos[ev.btn - 1] = {ev.pos.x, ev.pos.y};
+        }
+        break;
+    }
+    case CIEvent::MouseMove:
+    {
+        auto ev      = C<CIMouseMoveEvent>(data);
+        io->MousePos = {
+            (ev.origin.x + ev.delta.x) / io->DisplayFramebufferScale.x,
+            (ev.origin.y + ev.delta.y) / io->DisplayFramebufferScale.y};
+
+        break;
+    }
+    case CIEvent::Scroll:
+    {
+        auto ev        = C<CIScrollEvent>(data);
+        io->MouseWheel = ev.delta.y;
+        break;
+    }
+    case CIEvent::Keyboard:
+    {
+        auto ev = C<CIKeyEvent>(data);
+        if(ev.key < 512)
+        {
+            if(((ev.key >= CK_a && ev.key <= CK_z) ||
+                (ev.key >= CK_A && ev.key <= CK_Z) ||
+                (ev.key >= CK_0 && ev.key <= CK_9)) &&
+               (ev.mod & CIKeyEvent::RepeatedModifier ||
+                ev.mod & CIKeyEvent::PressedModifier))
+                io->AddInputCharacter(C_CAST<ImWchar>(ev.key));
+
+            io->KeysDown[ev.key] = ev.mod & CIKeyEvent::PressedModifier;
+
+            io->KeyAlt   = ev.mod & CIKeyEvent::LAltModifier;
+            io->KeyCtrl  = ev.mod & CIKeyEvent::LCtrlModifier;
+            io->KeyShift = ev.mod & CIKeyEvent::LShiftModifier;
+            io->KeySuper = ev.mod & CIKeyEvent::SuperModifier;
+
+            switch(ev.key)
+            {
+            case CK_LShift:
+            case CK_RShift:
+                io->KeyShift = true;
+                break;
+            case CK_LCtrl:
+            case CK_RCtrl:
+                io->KeyCtrl = true;
+                break;
+            case CK_AltGr:
+            case CK_LAlt:
+                io->KeyAlt = true;
+                break;
+            case CK_LSuper:
+            case CK_RSuper:
+                io->KeyShift = true;
+                break;
+            }
+        }
+        break;
+    }
+    case CIEvent::TextInput:
+    {
+        auto ev = C<CIWriteEvent>(data);
+        io->AddInputCharactersUTF8(ev.text);
+        break;
+    }
+    case CIEvent::TextEdit:
+    {
+        auto ev = C<CIWEditEvent>(data);
+        io->AddInputCharactersUTF8(ev.text);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+static void SetStyle()
+{
+    DProfContext _(IM_API "Applying custom style");
+    ImGuiStyle&  style      = ImGui::GetStyle();
+    style.WindowRounding    = 3.f;
+    style.FrameRounding     = 3.f;
+    style.ScrollbarRounding = 0;
+    style.FramePadding      = {3.f, 3.f};
+
+    style.Colors[ImGuiCol_PlotHistogram]        = ImVec4(.3f, .3f, .9f, 1.f);
+    style.Colors[ImGuiCol_PlotLines]            = ImVec4(.3f, .3f, .9f, 1.f);
+    style.Colors[ImGuiCol_PlotHistogramHovered] = ImVec4(.2f, .2f, .9f, 1.f);
+    style.Colors[ImGuiCol_PlotLinesHovered]     = ImVec4(.2f, .2f, .9f, 1.f);
+
+    style.Colors[ImGuiCol_ScrollbarGrabActive] = ImVec4(.2f, .2f, .9f, 1.f);
+    style.Colors[ImGuiCol_SliderGrabActive]    = ImVec4(.2f, .2f, .9f, 1.f);
+
+    style.Colors[ImGuiCol_Button]        = ImVec4(.2f, .2f, .9f, 1.f);
+    style.Colors[ImGuiCol_ButtonActive]  = ImVec4(.3f, .3f, .9f, 1.f);
+    style.Colors[ImGuiCol_ButtonHovered] = ImVec4(.5f, .5f, .9f, 1.f);
+
+    style.Colors[ImGuiCol_FrameBg]        = ImVec4(.2f, .2f, .5f, 1.f);
+    style.Colors[ImGuiCol_FrameBgActive]  = ImVec4(.3f, .3f, .5f, 1.f);
     style.Colors[ImGuiCol_FrameBgHovered] = ImVec4(.4f, .4f, .5f, 1.f);
 
-    return;
+    return;
+
+    style.Colors[ImGuiCol_Text]           = ImVec4(1.00f, 1.00f, 1.00f, 1.00f);
+    style.Colors[ImGuiCol_TextDisabled]   = ImVec4(1.00f, 1.00f, 1.00f, 0.30f);
+    style.Colors[ImGuiCol_WindowBg]       = ImVec4(0.00f, 0.00f, 0.00f, 0.98f);
+    style.Colors[ImGuiCol_ChildWindowBg]  = ImVec4(1.00f, 1.00f, 1.00f, 0.01f);
+    style.Colors[ImGuiCol_PopupBg]        = ImVec4(0.00f, 0.00f, 0.00f, 0.99f);
+    style.Colors[ImGuiCol_Border]         = ImVec4(1.00f, 1.00f, 1.00f, 0.20f);
+    style.Colors[ImGuiCol_BorderShadow]   = ImVec4(1.00f, 1.00f, 1.00f, 0.00f);
+    style.Colors[ImGuiCol_FrameBg]        = ImVec4(1.00f, 1.00f, 1.00f, 0.03f);
+    style.Colors[ImGuiCol_FrameBgHovered] = ImVec4(1.00f, 1.00f, 1.00f, 0.10f);
+    style.Colors[ImGuiCol_FrameBgActive]  = ImVec4(1.00f, 1.00f, 1.00f, 0.05f);
+    style.Colors[ImGuiCol_TitleBg]        = ImVec4(0.00f, 0.00f, 0.00f, 0.99f);
+    style.Colors[ImGuiCol_TitleBgCollapsed] =
+        ImVec4(0.00f, 0.00f, 0.00f, 1.00f);
+    style.Colors[ImGuiCol_TitleBgActive] = ImVec4(0.00f, 0.00f, 0.00f, 0.99f);
+    style.Colors[ImGuiCol_MenuBarBg]     = ImVec4(0.00f, 0.00f, 0.00f, 0.98f);
+    style.Colors[ImGuiCol_ScrollbarBg]   = ImVec4(1.00f, 1.00f, 1.00f, 0.00f);
+    style.Colors[ImGuiCol_ScrollbarGrab] = ImVec4(1.00f, 1.00f, 1.00f, 0.10f);
+    style.Colors[ImGuiCol_ScrollbarGrabHovered] =
+        ImVec4(1.00f, 1.00f, 1.00f, 0.20f);
+    style.Colors[ImGuiCol_ScrollbarGrabActive] =
+        ImVec4(1.00f, 1.00f, 1.00f, 0.05f);
+    style.Colors[ImGuiCol_ComboBg]    = ImVec4(1.00f, 1.00f, 1.00f, 1.00f);
+    style.Colors[ImGuiCol_CheckMark]  = ImVec4(1.00f, 1.00f, 1.00f, 0.30f);
+    style.Colors[ImGuiCol_SliderGrab] = ImVec4(0.00f, 0.00f, 0.00f, 1.00f);
+    style.Colors[ImGuiCol_SliderGrabActive] =
+        ImVec4(0.00f, 0.00f, 0.00f, 1.00f);
+    style.Colors[ImGuiCol_Button]        = ImVec4(1.00f, 1.00f, 1.00f, 0.10f);
+    style.Colors[ImGuiCol_ButtonHovered] = ImVec4(1.00f, 1.00f, 1.00f, 0.20f);
+    style.Colors[ImGuiCol_ButtonActive]  = ImVec4(1.00f, 1.00f, 1.00f, 0.00f);
+    style.Colors[ImGuiCol_Header]        = ImVec4(1.00f, 1.00f, 1.00f, 0.20f);
+    style.Colors[ImGuiCol_HeaderHovered] = ImVec4(1.00f, 1.00f, 1.00f, 0.25f);
+    style.Colors[ImGuiCol_HeaderActive]  = ImVec4(1.00f, 1.00f, 1.00f, 0.15f);
+    style.Colors[ImGuiCol_Column]        = ImVec4(1.00f, 1.00f, 1.00f, 0.00f);
+    style.Colors[ImGuiCol_ColumnHovered] = ImVec4(1.00f, 1.00f, 1.00f, 0.00f);
+    style.Colors[ImGuiCol_ColumnActive]  = ImVec4(1.00f, 1.00f, 1.00f, 0.00f);
+    style.Colors[ImGuiCol_ResizeGrip]    = ImVec4(1.00f, 1.00f, 1.00f, 0.05f);
+    style.Colors[ImGuiCol_ResizeGripHovered] =
+        ImVec4(1.00f, 1.00f, 1.00f, 0.10f);
+    style.Colors[ImGuiCol_ResizeGripActive] =
+        ImVec4(1.00f, 1.00f, 1.00f, 0.00f);
+    style.Colors[ImGuiCol_CloseButton] = ImVec4(1.00f, 1.00f, 1.00f, 0.20f);
+    style.Colors[ImGuiCol_CloseButtonHovered] =
+        ImVec4(1.00f, 1.00f, 1.00f, 0.30f);
+    style.Colors[ImGuiCol_CloseButtonActive] =
+        ImVec4(1.00f, 1.00f, 1.00f, 0.20f);
+    style.Colors[ImGuiCol_PlotLines] = ImVec4(1.00f, 1.00f, 1.00f, 1.00f);
+    style.Colors[ImGuiCol_PlotLinesHovered] =
+        ImVec4(1.00f, 1.00f, 1.00f, 0.00f);
+    style.Colors[ImGuiCol_PlotHistogram] = ImVec4(1.00f, 1.00f, 1.00f, 0.70f);
+    style.Colors[ImGuiCol_PlotHistogramHovered] =
+        ImVec4(1.00f, 1.00f, 1.00f, 0.80f);
+    style.Colors[ImGuiCol_TextSelectedBg] = ImVec4(0.00f, 0.00f, 0.00f, 1.00f);
+    style.Colors[ImGuiCol_ModalWindowDarkening] =
+        ImVec4(0.00f, 0.00f, 0.00f, 0.80f);
+
+    for(auto i : Range<>(ImGuiCol_COUNT))
+    {
+        auto alpha = style.Colors[i].w;
+
+        auto col = ImVec4(0.f, 0.f, 0.f, alpha);
+
+        if(style.Colors[i].x > 0.5f)
+            col = ImVec4(0.3f, 0.3f, 1.f, alpha);
+
+        style.Colors[i] = col;
+    }
+
+    style.Colors[ImGuiCol_ResizeGrip]        = ImVec4(0.2f, 0.2f, 1.f, 1.f);
+    style.Colors[ImGuiCol_ResizeGripActive]  = ImVec4(0.4f, 0.4f, 1.f, 1.f);
+    style.Colors[ImGuiCol_ResizeGripHovered] = ImVec4(0.3f, 0.3f, 1.f, 1.f);
+
+    style.Colors[ImGuiCol_PlotHistogram]        = ImVec4(.9f, .9f, .9f, 1.f);
+    style.Colors[ImGuiCol_PlotLines]            = ImVec4(.9f, .9f, .9f, 1.f);
+    style.Colors[ImGuiCol_PlotHistogramHovered] = ImVec4(1.f, 1.f, 1.f, 1.f);
+    style.Colors[ImGuiCol_PlotLinesHovered]     = ImVec4(1.f, 1.f, 1.f, 1.f);
+
+    style.Colors[ImGuiCol_ComboBg] = ImVec4(.0f, .0f, .0f, 1.00f);
+
+    style.Colors[ImGuiCol_Border] = ImVec4(.9f, .9f, .9f, 1.f);
+}
+
+static constexpr cstring im_shader_version =
+#if defined(COFFEE_GLEAM_DESKTOP)
+    "#version 330\n";
+#else
+    "#version 300 es\n";
+#endif
+
+/* Selects the RenderFlag_ShaderClip variant of both stages */
+static constexpr cstring im_shader_clip = "#define IM_SHADER_CLIP\n";
+
+static constexpr cstring im_vertex_shader =
+    "uniform mat4 ProjMtx;\n"
+    "in vec2 Position;\n"
+    "in vec2 UV;\n"
+    "in vec4 Color;\n"
+    "out vec2 Frag_UV;\n"
+    "out vec4 Frag_Color;\n"
+    "#if defined(IM_SHADER_CLIP)\n"
+    "in vec4 ClipRect;\n"
+    "flat out vec4 Frag_Clip;\n"
+    "#endif\n"
+    "void main()\n"
+    "{\n"
+    "	Frag_UV = UV * ProjMtx[2].w;\n"
+    "	Frag_Color = Color;\n"
+    "#if defined(IM_SHADER_CLIP)\n"
+    "	Frag_Clip = ClipRect;\n"
+    "#endif\n"
+    "	gl_Position = ProjMtx * vec4(Position.xy,0,1);\n"
+    "}\n";
+
+static constexpr cstring im_fragment_shader =
+    "uniform sampler2D Texture;\n"
+    "uniform int TexMode;\n"
+    "in vec2 Frag_UV;\n"
+    "in vec4 Frag_Color;\n"
+#if !defined(COFFEE_GLES20_MODE)
+    "out vec4 OutColor;\n"
+#endif
+    "#if defined(IM_SHADER_CLIP)\n"
+    "flat in vec4 Frag_Clip;\n"
+    "#endif\n"
+    "void main()\n"
+    "{\n"
+    "	vec4 tex = texture( Texture, Frag_UV.st);\n"
+    /* Single-channel font atlas, coverage in red */
+    "	if(TexMode == 1)\n"
+    "		tex = vec4(1.0, 1.0, 1.0, tex.r);\n"
+    /* Distance field atlas, antialiased over one screen pixel */
+    "	if(TexMode == 3)\n"
+    "	{\n"
+    "		float w = max(fwidth(tex.r), 0.0001);\n"
+    "		tex = vec4(1.0, 1.0, 1.0,\n"
+    "			smoothstep(0.5 - w, 0.5 + w, tex.r));\n"
+    "	}\n"
+    /* Same pixels as the scissor box, see imgui_clip.h. After fwidth(),
+     *  which is undefined in non-uniform control flow */
+    "#if defined(IM_SHADER_CLIP)\n"
+    "	if(any(lessThan(gl_FragCoord.xy, Frag_Clip.xy)) ||\n"
+    "	   any(greaterThanEqual(gl_FragCoord.xy, Frag_Clip.zw)))\n"
+    "		discard;\n"
+    "#endif\n"
+    "	OutColor = Frag_Color * tex;\n"
+    "}\n";
+
+/* RenderFlag_Primitives, a quad per instance from gl_VertexID. It is
+ *  grown by a unit for the antialiased edge. */
+static constexpr cstring im_primitive_vertex_shader =
+    "uniform mat4 ProjMtx;\n"
+    "in vec4 Rect;\n"
+    "in vec2 Shape;\n"
+    "in vec4 Color;\n"
+    "out vec2 Frag_Pos;\n"
+    "flat out vec2 Frag_Half;\n"
+    "flat out vec2 Frag_Shape;\n"
+    "out vec4 Frag_Color;\n"
+    "void main()\n"
+    "{\n"
+    "	int v = gl_VertexID % 6;\n"
+    "	vec2 corner = vec2(\n"
+    "		(v == 1 || v == 2 || v == 4) ? 1.0 : 0.0,\n"
+    "		(v == 2 || v == 4 || v == 5) ? 1.0 : 0.0);\n"
+    "	vec2 pos = mix(Rect.xy - 1.0, Rect.zw + 1.0, corner);\n"
+    "	Frag_Pos = pos - (Rect.xy + Rect.zw) * 0.5;\n"
+    "	Frag_Half = (Rect.zw - Rect.xy) * 0.5;\n"
+    "	Frag_Shape = Shape;\n"
+    "	Frag_Color = Color;\n"
+    "	gl_Position = ProjMtx * vec4(pos.xy,0,1);\n"
+    "}\n";
+
+static constexpr cstring im_primitive_fragment_shader =
+    "in vec2 Frag_Pos;\n"
+    "flat in vec2 Frag_Half;\n"
+    "flat in vec2 Frag_Shape;\n"
+    "in vec4 Frag_Color;\n"
+#if !defined(COFFEE_GLES20_MODE)
+    "out vec4 OutColor;\n"
+#endif
+    "void main()\n"
+    "{\n"
+    /* Distance to the rounded rect, negative inside */
+    "	float r = min(Frag_Shape.x, min(Frag_Half.x, Frag_Half.y));\n"
+    "	vec2 q = abs(Frag_Pos) - Frag_Half + r;\n"
+    "	float d = length(max(q, 0.0)) + min(max(q.x, q.y), 0.0) - r;\n"
+    /* Outlines keep a band of their thickness inside the edge */
+    "	if(Frag_Shape.y > 0.0)\n"
+    "		d = abs(d + Frag_Shape.y * 0.5) - Frag_Shape.y * 0.5;\n"
+    "	float w = max(fwidth(d), 0.0001);\n"
+    "	OutColor = vec4(Frag_Color.rgb,\n"
+    "		Frag_Color.a * clamp(0.5 - d / w, 0.0, 1.0));\n"
+    "}\n";
+
+static CString ShaderSource(cstring stage, bool shader_clip)
+{
+    CString source = im_shader_version;
+
+    if(shader_clip)
+        source += im_shader_clip;
+
+    return source + stage;
+}
+
+static u64 ProgramKey(bool shader_clip)
+{
+    using Cache = CImGui::detail::ProgramCache<DefaultAPI>;
+
+    static const u64 keys[2] = {
+        Cache::Key({im_shader_version, im_vertex_shader, im_fragment_shader}),
+        Cache::Key({im_shader_version,
+                    im_shader_clip,
+                    im_vertex_shader,
+                    im_fragment_shader}),
+    };
+
+    return keys[shader_clip];
+}
+
+static u64 PrimitiveProgramKey()
+{
+    using Cache = CImGui::detail::ProgramCache<DefaultAPI>;
+
+    static const u64 key = Cache::Key({im_shader_version,
+                                       im_primitive_vertex_shader,
+                                       im_primitive_fragment_shader});
+
+    return key;
+}
+
+namespace Coffee {
+namespace CImGui {
+
+template<typename GFX>
+static void SetStatus(ImGuiData<GFX>* im_data, CImGui::DeviceStatus status)
+{
+    im_data->status = status;
+    cDebug(IM_API "Device objects: {0}", CImGui::DeviceStatusName(status));
+}
+
+/* Adds the lifetime of the scope to `time` */
+struct ProgramTimer
+{
+    using clock = Chrono::high_resolution_clock;
+
+    ProgramTimer(Chrono::microseconds& time) :
+        m_time(time), m_start(clock::now())
+    {
+    }
+
+    ~ProgramTimer()
+    {
+        m_time += Chrono::duration_cast<Chrono::microseconds>(
+            clock::now() - m_start);
+    }
+
+  private:
+    Chrono::microseconds& m_time;
+    clock::time_point     m_start;
+};
+
+/* Keeps the atlas pixels, which io.Fonts may drop after upload */
+template<typename GFX>
+static void RetainFontAtlas(ImGuiData<GFX>* im_data, FontAtlasData const& atlas)
+{
+    const auto count = C_FCAST<szptr>(atlas.width * atlas.height) *
+                       (atlas.alpha_only ? 1 : 4);
+
+    im_data->font_pixels.assign(atlas.pixels, atlas.pixels + count);
+    im_data->font_data        = atlas;
+    im_data->font_data.pixels = im_data->font_pixels.data();
+}
+
+/* The font atlas worker uses io.Fonts until it finishes, its result is
+ *  taken over before anything else touches the atlas */
+template<typename GFX>
+static void AwaitFontAtlas()
+{
+    const auto im_data = ImGuiData<GFX>::Peek();
+
+    if(im_data && im_data->font_atlas.valid())
+        RetainFontAtlas(im_data, im_data->font_atlas.get());
+}
+
+/* Compiles both stages of `pip` and attaches them */
+template<typename GFX>
+static bool CompileProgram(
+    typename GFX::PIP& pip,
+    CString const&     vert_source,
+    CString const&     frag_source,
+    imgui_error_code&  ec)
+{
+    typename Traits<GFX>::shader_error gec;
+
+    typename GFX::SHD vert;
+    typename GFX::SHD frag;
+
+    auto vd = Bytes::CreateString(vert_source.c_str());
+    if(!vert.compile(RHI::ShaderStage::Vertex, vd, gec))
+    {
+        ec = ImError::ShaderCompilation;
+        ec = Traits<GFX>::error_message(gec);
+        return false;
+    }
+
+    auto fd = Bytes::CreateString(frag_source.c_str());
+    if(!frag.compile(RHI::ShaderStage::Fragment, fd, gec))
+    {
+        ec = ImError::ShaderCompilation;
+        ec = Traits<GFX>::error_message(gec);
+        return false;
+    }
+
+    auto& vert_owned = pip.storeShader(std::move(vert));
+    auto& frag_owned = pip.storeShader(std::move(frag));
+
+    if(!pip.attach(vert_owned, RHI::ShaderStage::Vertex, gec))
+    {
+        ec = ImError::ShaderAttach;
+        ec = Traits<GFX>::error_message(gec);
+        return false;
+    }
+
+    if(!pip.attach(frag_owned, RHI::ShaderStage::Fragment, gec))
+    {
+        ec = ImError::ShaderAttach;
+        ec = Traits<GFX>::error_message(gec);
+        return false;
+    }
+
+    return true;
+}
+
+/* Per-instance attributes of RenderFlag_Primitives */
+template<typename GFX>
+static void PrimitiveLayout(ImGuiData<GFX>* im_data)
+{
+    using Instance = CImGui::detail::PrimitiveInstance;
+
+    typename GFX::V_ATTR rect;
+    typename GFX::V_ATTR shape;
+    typename GFX::V_ATTR col;
+
+    for(auto const& attr : im_data->primitive_view->params())
+    {
+        if(attr.m_name == "Rect")
+            rect.m_idx = C_FCAST<u32>(attr.m_idx);
+        if(attr.m_name == "Shape")
+            shape.m_idx = C_FCAST<u32>(attr.m_idx);
+        if(attr.m_name == "Color")
+            col.m_idx = C_FCAST<u32>(attr.m_idx);
+    }
+
+    rect.m_size  = 4;
+    shape.m_size = 2;
+    col.m_size   = 4;
+
+    rect.m_stride = shape.m_stride = col.m_stride = sizeof(Instance);
+
+    /* Rounding and thickness are read as one vec2 */
+    rect.m_off   = offsetof(Instance, rect);
+    shape.m_off  = offsetof(Instance, rounding);
+    col.m_off    = offsetof(Instance, col);
+    col.m_type   = RHI::TypeEnum::UByte;
+    col.m_flags  = GFX::AttributePacked | GFX::AttributeNormalization;
+    rect.m_flags = shape.m_flags = GFX::AttributeInstanced;
+    col.m_flags |= GFX::AttributeInstanced;
+
+    auto& a = im_data->primitive_attributes;
+
+    a.addAttribute(rect);
+    a.addAttribute(shape);
+    a.addAttribute(col);
+    a.bindBuffer(0, im_data->primitive_buffer);
+}
+
+/* RenderFlag_QuantizedVertices, the vertex layout read as QuantVertex */
+template<typename GFX>
+static void QuantizedLayout(ImGuiData<GFX>* im_data)
+{
+    using QuantVertex = CImGui::detail::QuantVertex;
+
+    auto pos = im_data->vertex_layout[0];
+    auto tex = im_data->vertex_layout[1];
+    auto col = im_data->vertex_layout[2];
+
+    pos.m_stride = tex.m_stride = col.m_stride = sizeof(QuantVertex);
+
+    pos.m_off = offsetof(QuantVertex, pos);
+    tex.m_off = offsetof(QuantVertex, uv);
+    col.m_off = offsetof(QuantVertex, col);
+
+    /* UVs are read as integers and scaled back by the projection, see
+     *  ApplyUvUnit() */
+    tex.m_type  = RHI::TypeEnum::UShort;
+    tex.m_flags = 0;
+
+    auto& a = im_data->quant_attributes;
+
+    a.addAttribute(pos);
+    a.addAttribute(tex);
+    a.addAttribute(col);
+    a.bindBuffer(0, im_data->vertices);
+    a.setIndexBuffer(&im_data->elements);
+}
+
+/* Runs one stage of device object creation. GPU work is split so that no
+ *  single frame compiles, links and uploads. With `blocking`, the font
+ *  atlas worker is waited for instead of polled. */
+template<typename GFX>
+static void RunDeviceStage(
+    ImGuiData<GFX>* im_data, bool blocking, imgui_error_code& ec)
+{
+    using Status = CImGui::DeviceStatus;
+
+    switch(im_data->status)
+    {
+    case Status::Unloaded:
+    case Status::Allocating:
+    {
+        DProfContext _(IM_API "Allocating vertex objects");
+        im_data->attributes.alloc();
+        im_data->vertices.alloc();
+        im_data->elements.alloc();
+
+        /* Rasterising the atlas does not need the GPU. The main thread
+         *  does not use io.Fonts until the atlas is ready. */
+        if(im_data->font_pixels.empty() && !im_data->font_atlas.valid())
+            im_data->font_atlas = std::async(
+                std::launch::async,
+                PrepareFontAtlas,
+                im_data->fonts.m_pixfmt == PixFmt::R8);
+
+        /* Another ImGuiData may have linked the pipelines already */
+        im_data->program_cached =
+            BackendStatics<GFX>::programs.lookup(
+                ProgramKey(im_data->shader_clip));
+        im_data->program_time   = {};
+
+        bool cached = im_data->program_cached;
+
+        if(im_data->quantized)
+            im_data->quant_attributes.alloc();
+
+        if(im_data->primitive_pipeline)
+        {
+            im_data->primitive_attributes.alloc();
+            im_data->primitive_buffer.alloc();
+
+            im_data->primitive_cached =
+                BackendStatics<GFX>::programs.lookup(PrimitiveProgramKey());
+            im_data->primitive_time = {};
+
+            cached = cached && im_data->primitive_cached;
+        }
+
+        SetStatus(
+            im_data,
+            cached ? Status::LinkingShaders : Status::CompilingShaders);
+        break;
+    }
+    case Status::CompilingShaders:
+    {
+        DProfContext _(IM_API "Compiling shaders");
+
+        if(!im_data->program_cached)
+        {
+            ProgramTimer timer(im_data->program_time);
+
+            if(!CompileProgram<GFX>(
+                   *im_data->pipeline,
+                   ShaderSource(im_vertex_shader, im_data->shader_clip),
+                   ShaderSource(im_fragment_shader, im_data->shader_clip),
+                   ec))
+                return SetStatus(im_data, Status::Failed);
+        }
+
+        if(im_data->primitive_pipeline && !im_data->primitive_cached)
+        {
+            ProgramTimer timer(im_data->primitive_time);
+
+            if(!CompileProgram<GFX>(
+                   *im_data->primitive_pipeline,
+                   ShaderSource(im_primitive_vertex_shader, false),
+                   ShaderSource(im_primitive_fragment_shader, false),
+                   ec))
+                return SetStatus(im_data, Status::Failed);
+        }
+
+        SetStatus(im_data, Status::LinkingShaders);
+        break;
+    }
+    case Status::LinkingShaders:
+    {
+        DProfContext                       _(IM_API "Linking shaders");
+        typename Traits<GFX>::shader_error gec;
+
+        if(!im_data->program_cached)
+        {
+            ProgramTimer timer(im_data->program_time);
+
+            if(!im_data->pipeline->assemble(gec))
+            {
+                ec = ImError::ShaderAttach;
+                ec = Traits<GFX>::error_message(gec);
+                return SetStatus(im_data, Status::Failed);
+            }
+        }
+
+        if(!im_data->program_cached)
+            BackendStatics<GFX>::programs.store(
+                ProgramKey(im_data->shader_clip), im_data->program_time);
+
+        if(im_data->primitive_pipeline && !im_data->primitive_cached)
+        {
+            ProgramTimer timer(im_data->primitive_time);
+
+            if(!im_data->primitive_pipeline->assemble(gec))
+            {
+                ec = ImError::ShaderAttach;
+                ec = Traits<GFX>::error_message(gec);
+                return SetStatus(im_data, Status::Failed);
+            }
+        }
+
+        if(im_data->primitive_pipeline && !im_data->primitive_cached)
+            BackendStatics<GFX>::programs.store(
+                PrimitiveProgramKey(), im_data->primitive_time);
+
+        Profiler::DeepPushContext(IM_API "Getting shader properties");
+        CImGui::detail::BuildShaderView(
+            im_data->shader_view,
+            im_data->fonts_sampler,
+            im_data->projection_matrix,
+            im_data->fonts_tex_mode);
+
+        if(im_data->primitive_pipeline)
+        {
+            im_data->primitive_view = MkUq<RHI::shader_param_view<GFX>>(
+                im_data->primitive_pipeline);
+            CImGui::detail::BuildShaderView(
+                *im_data->primitive_view,
+                im_data->fonts_sampler,
+                im_data->projection_matrix,
+                im_data->fonts_tex_mode);
+        }
+        Profiler::DeepPopContext();
+
+        for(auto const& attr : im_data->shader_view.params())
+        {
+            if(im_data->vertex_layout_valid)
+                break;
+
+            if(attr.m_name == "Position")
+                im_data->attr_idx[0] = attr.m_idx;
+            if(attr.m_name == "UV")
+                im_data->attr_idx[1] = attr.m_idx;
+            if(attr.m_name == "Color")
+                im_data->attr_idx[2] = attr.m_idx;
+            if(attr.m_name == "ClipRect")
+                im_data->attr_idx[3] = attr.m_idx;
+        }
+
+        SetStatus(im_data, Status::VertexLayout);
+        break;
+    }
+    case Status::VertexLayout:
+    {
+        DProfContext _(IM_API "Creating vertex array object");
+
+        auto& a      = im_data->attributes;
+        auto& layout = im_data->vertex_layout;
+
+        const u32 attribute_count = im_data->shader_clip ? 4 : 3;
 
-    style.Colors[ImGuiCol_Text]           = ImVec4(1.00f, 1.00f, 1.00f, 1.00f);
-    style.Colors[ImGuiCol_TextDisabled]   = ImVec4(1.00f, 1.00f, 1.00f, 0.30f);
-    style.Colors[ImGuiCol_WindowBg]       = ImVec4(0.00f, 0.00f, 0.00f, 0.98f);
-    style.Colors[ImGuiCol_ChildWindowBg]  = ImVec4(1.00f, 1.00f, 1.00f, 0.01f);
-    style.Colors[ImGuiCol_PopupBg]        = ImVec4(0.00f, 0.00f, 0.00f, 0.99f);
-    style.Colors[ImGuiCol_Border]         = ImVec4(1.00f, 1.00f, 1.00f, 0.20f);
-    style.Colors[ImGuiCol_BorderShadow]   = ImVec4(1.00f, 1.00f, 1.00f, 0.00f);
-    style.Colors[ImGuiCol_FrameBg]        = ImVec4(1.00f, 1.00f, 1.00f, 0.03f);
-    style.Colors[ImGuiCol_FrameBgHovered] = ImVec4(1.00f, 1.00f, 1.00f, 0.10f);
-    style.Colors[ImGuiCol_FrameBgActive]  = ImVec4(1.00f, 1.00f, 1.00f, 0.05f);
-    style.Colors[ImGuiCol_TitleBg]        = ImVec4(0.00f, 0.00f, 0.00f, 0.99f);
-    style.Colors[ImGuiCol_TitleBgCollapsed] =
-        ImVec4(0.00f, 0.00f, 0.00f, 1.00f);
-    style.Colors[ImGuiCol_TitleBgActive] = ImVec4(0.00f, 0.00f, 0.00f, 0.99f);
-    style.Colors[ImGuiCol_MenuBarBg]     = ImVec4(0.00f, 0.00f, 0.00f, 0.98f);
-    style.Colors[ImGuiCol_ScrollbarBg]   = ImVec4(1.00f, 1.00f, 1.00f, 0.00f);
-    style.Colors[ImGuiCol_ScrollbarGrab] = ImVec4(1.00f, 1.00f, 1.00f, 0.10f);
-    style.Colors[ImGuiCol_ScrollbarGrabHovered] =
-        ImVec4(1.00f, 1.00f, 1.00f, 0.20f);
-    style.Colors[ImGuiCol_ScrollbarGrabActive] =
-        ImVec4(1.00f, 1.00f, 1.00f, 0.05f);
-    style.Colors[ImGuiCol_ComboBg]    = ImVec4(1.00f, 1.00f, 1.00f, 1.00f);
-    style.Colors[ImGuiCol_CheckMark]  = ImVec4(1.00f, 1.00f, 1.00f, 0.30f);
-    style.Colors[ImGuiCol_SliderGrab] = ImVec4(0.00f, 0.00f, 0.00f, 1.00f);
-    style.Colors[ImGuiCol_SliderGrabActive] =
-        ImVec4(0.00f, 0.00f, 0.00f, 1.00f);
-    style.Colors[ImGuiCol_Button]        = ImVec4(1.00f, 1.00f, 1.00f, 0.10f);
-    style.Colors[ImGuiCol_ButtonHovered] = ImVec4(1.00f, 1.00f, 1.00f, 0.20f);
-    style.Colors[ImGuiCol_ButtonActive]  = ImVec4(1.00f, 1.00f, 1.00f, 0.00f);
-    style.Colors[ImGuiCol_Header]        = ImVec4(1.00f, 1.00f, 1.00f, 0.20f);
-    style.Colors[ImGuiCol_HeaderHovered] = ImVec4(1.00f, 1.00f, 1.00f, 0.25f);
-    style.Colors[ImGuiCol_HeaderActive]  = ImVec4(1.00f, 1.00f, 1.00f, 0.15f);
-    style.Colors[ImGuiCol_Column]        = ImVec4(1.00f, 1.00f, 1.00f, 0.00f);
-    style.Colors[ImGuiCol_ColumnHovered] = ImVec4(1.00f, 1.00f, 1.00f, 0.00f);
-    style.Colors[ImGuiCol_ColumnActive]  = ImVec4(1.00f, 1.00f, 1.00f, 0.00f);
-    style.Colors[ImGuiCol_ResizeGrip]    = ImVec4(1.00f, 1.00f, 1.00f, 0.05f);
-    style.Colors[ImGuiCol_ResizeGripHovered] =
-        ImVec4(1.00f, 1.00f, 1.00f, 0.10f);
-    style.Colors[ImGuiCol_ResizeGripActive] =
-        ImVec4(1.00f, 1.00f, 1.00f, 0.00f);
-    style.Colors[ImGuiCol_CloseButton] = ImVec4(1.00f, 1.00f, 1.00f, 0.20f);
-    style.Colors[ImGuiCol_CloseButtonHovered] =
-        ImVec4(1.00f, 1.00f, 1.00f, 0.30f);
-    style.Colors[ImGuiCol_CloseButtonActive] =
-        ImVec4(1.00f, 1.00f, 1.00f, 0.20f);
-    style.Colors[ImGuiCol_PlotLines] = ImVec4(1.00f, 1.00f, 1.00f, 1.00f);
-    style.Colors[ImGuiCol_PlotLinesHovered] =
-        ImVec4(1.00f, 1.00f, 1.00f, 0.00f);
-    style.Colors[ImGuiCol_PlotHistogram] = ImVec4(1.00f, 1.00f, 1.00f, 0.70f);
-    style.Colors[ImGuiCol_PlotHistogramHovered] =
-        ImVec4(1.00f, 1.00f, 1.00f, 0.80f);
-    style.Colors[ImGuiCol_TextSelectedBg] = ImVec4(0.00f, 0.00f, 0.00f, 1.00f);
-    style.Colors[ImGuiCol_ModalWindowDarkening] =
-        ImVec4(0.00f, 0.00f, 0.00f, 0.80f);
+        if(!im_data->vertex_layout_valid)
+        {
+            using ClipVertex = CImGui::detail::ClipVertex;
 
-    for(auto i : Range<>(ImGuiCol_COUNT))
+            auto& pos  = layout[0];
+            auto& tex  = layout[1];
+            auto& col  = layout[2];
+            auto& clip = layout[3];
+
+            pos.m_idx  = C_FCAST<u32>(im_data->attr_idx[0]);
+            tex.m_idx  = C_FCAST<u32>(im_data->attr_idx[1]);
+            col.m_idx  = C_FCAST<u32>(im_data->attr_idx[2]);
+            clip.m_idx = C_FCAST<u32>(im_data->attr_idx[3]);
+
+            pos.m_size = tex.m_size = 2;
+            col.m_size = clip.m_size = 4;
+
+            pos.m_stride = tex.m_stride = col.m_stride = sizeof(ImDrawVert);
+
+            pos.m_off   = offsetof(ImDrawVert, pos);
+            tex.m_off   = offsetof(ImDrawVert, uv);
+            col.m_off   = offsetof(ImDrawVert, col);
+            col.m_type  = RHI::TypeEnum::UByte;
+            col.m_flags = GFX::AttributePacked | GFX::AttributeNormalization;
+
+            if(im_data->shader_clip)
+            {
+                pos.m_stride = tex.m_stride = col.m_stride = clip.m_stride =
+                    sizeof(ClipVertex);
+
+                pos.m_off   = offsetof(ClipVertex, pos);
+                tex.m_off   = offsetof(ClipVertex, uv);
+                col.m_off   = offsetof(ClipVertex, col);
+                clip.m_off  = offsetof(ClipVertex, clip);
+                /* Pixel coordinates, converted to float as they are */
+                clip.m_type = RHI::TypeEnum::UShort;
+            }
+
+            im_data->vertex_layout_valid = true;
+        }
+
+        for(auto i : Range<u32>(attribute_count))
+            a.addAttribute(layout[i]);
+
+        a.bindBuffer(0, im_data->vertices);
+        a.setIndexBuffer(&im_data->elements);
+
+        if(im_data->quantized)
+            QuantizedLayout(im_data);
+
+        if(im_data->primitive_view)
+            PrimitiveLayout(im_data);
+
+        SetStatus(im_data, Status::UploadingFonts);
+        break;
+    }
+    case Status::UploadingFonts:
     {
-        auto alpha = style.Colors[i].w;
+        auto& font_atlas = im_data->font_atlas;
 
-        auto col = ImVec4(0.f, 0.f, 0.f, alpha);
+        if(im_data->font_pixels.empty())
+        {
+            if(!blocking && font_atlas.wait_for(Chrono::seconds(0)) !=
+                                std::future_status::ready)
+                break;
 
-        if(style.Colors[i].x > 0.5f)
-            col = ImVec4(0.3f, 0.3f, 1.f, alpha);
+            RetainFontAtlas(im_data, font_atlas.get());
+        }
 
-        style.Colors[i] = col;
+        DProfContext _(IM_API "Uploading font atlas");
+        ImGui_ImplSdlGL3_CreateFontsTexture<GFX>(im_data->font_data);
+
+        SetStatus(im_data, Status::Ready);
+        break;
+    }
+    case Status::Ready:
+    case Status::Failed:
+        break;
     }
+}
 
-    style.Colors[ImGuiCol_ResizeGrip]        = ImVec4(0.2f, 0.2f, 1.f, 1.f);
-    style.Colors[ImGuiCol_ResizeGripActive]  = ImVec4(0.4f, 0.4f, 1.f, 1.f);
-    style.Colors[ImGuiCol_ResizeGripHovered] = ImVec4(0.3f, 0.3f, 1.f, 1.f);
+template<typename GFX>
+static void StepDeviceObjects(
+    ImGuiData<GFX>* im_data, bool blocking, imgui_error_code& ec)
+{
+    using clock = Chrono::high_resolution_clock;
 
-    style.Colors[ImGuiCol_PlotHistogram]        = ImVec4(.9f, .9f, .9f, 1.f);
-    style.Colors[ImGuiCol_PlotLines]            = ImVec4(.9f, .9f, .9f, 1.f);
-    style.Colors[ImGuiCol_PlotHistogramHovered] = ImVec4(1.f, 1.f, 1.f, 1.f);
-    style.Colors[ImGuiCol_PlotLinesHovered]     = ImVec4(1.f, 1.f, 1.f, 1.f);
+    auto& stats = im_data->device_stats;
+    auto  start = clock::now();
 
-    style.Colors[ImGuiCol_ComboBg] = ImVec4(.0f, .0f, .0f, 1.00f);
+    RunDeviceStage(im_data, blocking, ec);
 
-    style.Colors[ImGuiCol_Border] = ImVec4(.9f, .9f, .9f, 1.f);
+    auto time = Chrono::duration_cast<Chrono::microseconds>(
+        clock::now() - start);
+
+    if(stats.resets)
+        stats.recreate_time += time;
+    else
+        stats.create_time += time;
 }
 
-namespace Coffee {
-namespace CImGui {
+template<typename GFX>
+static ImGuiData<GFX>* AcquireDeviceData(imgui_error_code& ec)
+{
+    auto im_data = ImGuiData<GFX>::Peek();
+
+    if(im_data)
+        return im_data;
+
+    State::SwapState(Traits<GFX>::state_key(), MkShared<ImGuiData<GFX>>());
+    im_data = ImGuiData<GFX>::Peek();
+
+    if(!im_data)
+    {
+        ec = ImError::GlobalStateFailure;
+        return nullptr;
+    }
+
+    im_data->time = 0.f;
 
+    return im_data;
+}
+
+/* Advances device creation by one stage until it is ready, and starts over
+ *  when the context lost the pipeline. Null while not ready. */
+template<typename GFX>
+static ImGuiData<GFX>* PrepareDevice(imgui_error_code& ec)
+{
+    auto im_data = AcquireDeviceData<GFX>(ec);
+
+    if(!im_data)
+        return nullptr;
+
+    if(im_data->status == DeviceStatus::Ready &&
+       !Traits<GFX>::pipeline_valid(*im_data->pipeline))
+    {
+        BackendStatics<GFX>::programs.invalidate();
+        SetStatus(im_data, DeviceStatus::Allocating);
+    }
+
+    if(im_data->status != DeviceStatus::Ready)
+    {
+        DProfContext             _(IM_API "Creating device data");
+        typename GFX::DBG::SCOPE a(IM_API "Creating device data");
+
+        StepDeviceObjects(im_data, false, ec);
+        return nullptr;
+    }
+
+    return im_data;
+}
+
+template<typename GFX>
 bool CreateDeviceObjects(imgui_error_code& ec)
 {
     DProfContext _(IM_API "Creating device data");
 
-    constexpr cstring vertex_shader =
-#if defined(COFFEE_GLEAM_DESKTOP)
-        "#version 330\n"
-#else
-        "#version 300 es\n"
-#endif
-        "uniform mat4 ProjMtx;\n"
-        "in vec2 Position;\n"
-        "in vec2 UV;\n"
-        "in vec4 Color;\n"
-        "out vec2 Frag_UV;\n"
-        "out vec4 Frag_Color;\n"
-        "void main()\n"
-        "{\n"
-        "	Frag_UV = UV;\n"
-        "	Frag_Color = Color;\n"
-        "	gl_Position = ProjMtx * vec4(Position.xy,0,1);\n"
-        "}\n";
-
-    constexpr cstring fragment_shader =
-#if defined(COFFEE_GLEAM_DESKTOP)
-        "#version 330\n"
-#else
-        "#version 300 es\n"
-#endif
-        "uniform sampler2D Texture;\n"
-        "in vec2 Frag_UV;\n"
-        "in vec4 Frag_Color;\n"
-#if !defined(COFFEE_GLES20_MODE)
-        "out vec4 OutColor;\n"
-#endif
-        "void main()\n"
-        "{\n"
-        "	OutColor = Frag_Color * texture( Texture, Frag_UV.st);\n"
-        "}\n";
+    using Status = CImGui::DeviceStatus;
 
-    auto im_data = C_DCAST<ImGuiData>(State::PeekState("im_data").get());
+    auto im_data = AcquireDeviceData<GFX>(ec);
 
-    if(im_data)
+    if(!im_data)
+        return false;
+
+    if(im_data->status == Status::Ready)
     {
         ec = ImError::AlreadyLoaded;
         return true;
     }
 
-    GFX::DBG::SCOPE a(IM_API "Creating device data");
+    typename GFX::DBG::SCOPE a(IM_API "Creating device data");
+
+    /* Explicit calls retry after a failure */
+    if(im_data->status == Status::Failed)
+        SetStatus(im_data, Status::Allocating);
+
+    while(im_data->status != Status::Ready &&
+          im_data->status != Status::Failed)
+        StepDeviceObjects(im_data, true, ec);
+
+    return im_data->status == Status::Ready;
+}
+
+template<typename GFX>
+void InvalidateDeviceObjects(imgui_error_code& ec)
+{
+    const auto im_data = ImGuiData<GFX>::Peek();
+
+    if(im_data)
+    {
+        DProfContext             _(IM_API "Invalidating device objects");
+        typename GFX::DBG::SCOPE a(IM_API "Invalidating device objects");
+
+        using clock = Chrono::high_resolution_clock;
+
+        auto start = clock::now();
+
+        im_data->vertices.dealloc();
+        im_data->elements.dealloc();
+        im_data->attributes.dealloc();
+        im_data->vertex_ring.release();
+        im_data->element_ring.release();
+        im_data->primitive_view.reset();
+        im_data->primitive_attributes.dealloc();
+        im_data->primitive_buffer.dealloc();
+        im_data->primitive_ring.release();
+        im_data->quant_attributes.dealloc();
+        im_data->retained_lists.reset(0, 0);
+        im_data->layers.clear();
+        BackendStatics<GFX>::textures.release();
+        BackendStatics<GFX>::programs.invalidate();
+        im_data->fonts.dealloc();
+        im_data->fonts_sampler.dealloc();
+        im_data->frame_cache.valid    = false;
+        im_data->frame_cache.resident = false;
+        im_data->frame_cache.target   = nullptr;
+
+        /* Glyph region pixels are kept, they only need uploading */
+        im_glyphs.invalidate_upload();
+        ImGui::GetIO().Fonts->TexID = nullptr;
+
+        auto& stats = im_data->device_stats;
+
+        stats.resets++;
+        stats.invalidate_time = Chrono::duration_cast<Chrono::microseconds>(
+            clock::now() - start);
+        stats.recreate_time = {};
+
+        if(im_data->status != DeviceStatus::Failed)
+            SetStatus(im_data, DeviceStatus::Allocating);
+    } else
+        ec = ImError::AlreadyUnloaded;
+}
+
+template<typename GFX>
+void DestroyDeviceObjects()
+{
+    State::SwapState(Traits<GFX>::state_key(), {});
+}
+
+template<typename GFX>
+bool NewFrame(Components::EntityContainer& container)
+{
+    DProfContext _(IM_API "Preparing frame data");
+
+    imgui_error_code ec;
+    ImGuiData<GFX>*  im_data = nullptr;
+
+    if(im_software)
+    {
+        im_data = AcquireDeviceData<GFX>(ec);
 
-    State::SwapState("im_data", MkShared<ImGuiData>());
-    im_data = C_DCAST<ImGuiData>(State::PeekState("im_data").get());
+        if(im_data)
+        {
+            AwaitFontAtlas<GFX>();
+            PrepareSoftwareFonts();
+        }
+    } else if(UseDeferredSubmit())
+    {
+        /* SubmitPendingFrame() creates the device objects */
+        if(im_frames.device_ready())
+            im_data = ImGuiData<GFX>::Peek();
+    } else
+        im_data = PrepareDevice<GFX>(ec);
 
     if(!im_data)
     {
-        ec = ImError::GlobalStateFailure;
+        C_ERROR_CHECK(ec);
         return false;
     }
 
-    im_data->time = 0.f;
+    ImGuiIO& io = ImGui::GetIO();
+
+    // Setup display size (every frame to accommodate for window resizing)
+    auto s = container.service<comp_app::Windowing>()->size();
+
+    scalar uiScaling = PlatformData::DeviceDPI();
+
+    io.DisplaySize             = ImVec2(s.w / uiScaling, s.h / uiScaling);
+    io.DisplayFramebufferScale = ImVec2(uiScaling, uiScaling);
+
+    // Setup time step
+    f32 time     = C_CAST<f32>(0);
+    io.DeltaTime = im_data->time > 0.0f ? C_CAST<f32>(time - im_data->time)
+                                        : C_CAST<f32>(1.0f / 60.0f);
+    im_data->time = time;
+
+    // Setup inputs
+#if !defined(COFFEE_ANDROID) && !defined(COFFEE_APPLE_MOBILE)
+    auto pos    = container.service<comp_app::MouseInput>()->position();
+    io.MousePos = ImVec2(pos.x / uiScaling, pos.y / uiScaling);
+#else
+    io.MouseDown[CIMouseButtonEvent::LeftButton - 1] = false;
+#endif
+
+    io.MouseWheel   = im_data->scroll;
+    im_data->scroll = 0.0f;
+
+    /* Markers of the last frame are gone with its draw lists */
+    im_primitives.clear();
+
+    // Start the frame
+    DProfContext __(IM_API "Running ImGui::NewFrame()");
+    ImGui::NewFrame();
+    im_frame_started = true;
+    return true;
+}
+
+template<typename GFX>
+DeviceStatus GetDeviceStatus()
+{
+    const auto im_data = ImGuiData<GFX>::Peek();
+
+    return im_data ? im_data->status : DeviceStatus::Unloaded;
+}
+
+template<typename GFX>
+void RenderDrawData(ImDrawData* draw_data)
+{
+    RenderFrame<GFX>(draw_data, IoDisplay());
+}
+
+/* RenderFlag_DeferredSubmit, on the thread which owns the context */
+template<typename GFX>
+static bool SubmitPending(Components::duration const& timeout)
+{
+    DProfContext _(IM_API "Submitting deferred frame");
+
+    imgui_error_code ec;
+    auto             im_data = PrepareDevice<GFX>(ec);
+    C_ERROR_CHECK(ec);
+
+    im_frames.set_device_ready(im_data != nullptr);
+
+    if(!im_data)
+        return false;
+
+    auto snapshot = im_frames.begin_draw(timeout);
 
-    i32 attr_idx[3] = {-1, -1, -1};
+    if(!snapshot)
+        return false;
+
+    const FrameDisplay display = {
+        snapshot->display_size, snapshot->framebuffer_scale};
 
-    do
+    if(snapshot->redraw)
     {
-        DProfContext _(IM_API "Allocating vertex objects");
-        im_data->attributes.alloc();
-        im_data->vertices.alloc();
-        im_data->elements.alloc();
-    } while(false);
+        im_frame_primitives = &im_drawn_primitives;
+        RenderFrame<GFX>(nullptr, display);
+    } else
+    {
+        im_frame_primitives = &snapshot->primitives;
+        RenderFrame<GFX>(&snapshot->draw_data, display);
+
+        /* Redraws only look up runs, the records are resident */
+        im_drawn_primitives.runs = snapshot->primitives.runs;
+    }
+
+    im_frame_primitives = &im_primitives;
+    im_frames.end_draw();
+
+    im_data->stats.frames_published = im_frames.published();
+    im_data->stats.frames_replaced  = im_frames.replaced();
+
+    return true;
+}
+
+template<typename GFX>
+static void RestoreFontsTexture()
+{
+    const auto im_data = ImGuiData<GFX>::Peek();
+
+    if(im_data && im_data->status == DeviceStatus::Ready)
+        ImGui::GetIO().Fonts->TexID = Traits<GFX>::texture_id(im_data->fonts);
+}
+
+template<typename GFX>
+static void ConfigureStreaming(StreamingConfig const& config)
+{
+    const auto im_data = ImGuiData<GFX>::Peek();
+
+    if(im_data)
+    {
+        im_data->vertex_ring.configure(config);
+        im_data->element_ring.configure(config);
+        im_data->primitive_ring.configure(config);
+    }
+}
+
+template<typename GFX>
+RenderStats const& GetRenderStats()
+{
+    static const RenderStats empty_stats = {};
+
+    const auto im_data = ImGuiData<GFX>::Peek();
+
+    return im_data ? im_data->stats : empty_stats;
+}
+
+template<typename GFX>
+DeviceStats const& GetDeviceStats()
+{
+    static const DeviceStats empty_stats = {};
 
-    do
-    {
-        DProfContext            _(IM_API "Compiling shaders");
-        RHI::GLEAM::gleam_error gec;
+    const auto im_data = ImGuiData<GFX>::Peek();
 
-        GFX::SHD vert;
-        GFX::SHD frag;
-        auto&    pip = im_data->pipeline;
+    if(!im_data)
+        return empty_stats;
 
-        auto vd = Bytes::CreateString(vertex_shader);
-        if(!vert.compile(RHI::ShaderStage::Vertex, vd, gec))
-        {
-            ec = ImError::ShaderCompilation;
-            ec = gec.error_message;
-            return false;
-        }
+    im_data->device_stats.program_cache =
+        BackendStatics<GFX>::programs.stats();
 
-        auto fd = Bytes::CreateString(fragment_shader);
-        if(!frag.compile(RHI::ShaderStage::Fragment, fd, gec))
-        {
-            ec = ImError::ShaderCompilation;
-            ec = gec.error_message;
-            return false;
-        }
+    return im_data->device_stats;
+}
 
-        auto& vert_owned = pip->storeShader(std::move(vert));
-        auto& frag_owned = pip->storeShader(std::move(frag));
+template<typename GFX>
+FontAtlasStats const& GetFontAtlasStats()
+{
+    static const FontAtlasStats empty_stats = {};
 
-        if(!pip->attach(vert_owned, RHI::ShaderStage::Vertex, gec))
-        {
-            ec = ImError::ShaderAttach;
-            ec = gec.message();
-            return false;
-        }
+    const auto im_data = ImGuiData<GFX>::Peek();
 
-        if(!pip->attach(frag_owned, RHI::ShaderStage::Fragment, gec))
-        {
-            ec = ImError::ShaderAttach;
-            ec = gec.message();
-            return false;
-        }
+    if(!im_data)
+        return empty_stats;
 
-        if(!pip->assemble(gec))
-        {
-            ec = ImError::ShaderAttach;
-            ec = gec.message();
-            return false;
-        }
+    im_data->atlas_stats.glyph_cache = im_glyphs.stats();
 
-        Profiler::DeepPushContext(IM_API "Getting shader properties");
-        im_data->shader_view.get_pipeline_params();
-        Profiler::DeepPopContext();
+    return im_data->atlas_stats;
+}
 
-        for(auto const& unif : im_data->shader_view.constants())
-        {
-            if(unif.m_name == "Texture")
-                im_data->shader_view.set_sampler(
-                    unif, im_data->fonts_sampler.handle());
-            if(unif.m_name == "ProjMtx")
-                im_data->shader_view.set_constant(
-                    unif, Bytes::Create(im_data->projection_matrix));
-        }
+template<typename GFX>
+ImTextureID RegisterTexture(typename GFX::S_2D& surface, Filtering filter)
+{
+    return BackendStatics<GFX>::textures.add(surface, filter);
+}
 
-        im_data->shader_view.build_state();
+template<typename GFX>
+void UnregisterTexture(ImTextureID texture)
+{
+    BackendStatics<GFX>::textures.remove(texture);
+}
 
-        for(auto const& attr : im_data->shader_view.params())
-        {
-            if(attr.m_name == "Position")
-                attr_idx[0] = attr.m_idx;
-            if(attr.m_name == "UV")
-                attr_idx[1] = attr.m_idx;
-            if(attr.m_name == "Color")
-                attr_idx[2] = attr.m_idx;
-        }
-    } while(false);
+template<typename GFX>
+void ReleaseProgramCache()
+{
+    BackendStatics<GFX>::programs.clear();
+}
 
-    do
-    {
-        DProfContext _(IM_API "Creating vertex array object");
+template<typename GFX>
+static ImTextureID RegisterImGuiAPITexture(
+    ImGuiAPI::S_2D& surface, Filtering filter, std::true_type)
+{
+    return RegisterTexture<GFX>(surface, filter);
+}
 
-        GFX::V_ATTR pos;
-        GFX::V_ATTR tex;
-        GFX::V_ATTR col;
-        auto&       a = im_data->attributes;
+template<typename GFX>
+static ImTextureID RegisterImGuiAPITexture(
+    ImGuiAPI::S_2D&, Filtering, std::false_type)
+{
+    return nullptr;
+}
 
-        pos.m_idx = C_FCAST<u32>(attr_idx[0]);
-        tex.m_idx = C_FCAST<u32>(attr_idx[1]);
-        col.m_idx = C_FCAST<u32>(attr_idx[2]);
+/* The untemplated RegisterTexture() takes ImGuiAPI surfaces, which a
+ *  backend with another surface type cannot sample */
+template<typename GFX>
+static ImTextureID RegisterImGuiAPITexture(
+    ImGuiAPI::S_2D& surface, Filtering filter)
+{
+    return RegisterImGuiAPITexture<GFX>(
+        surface,
+        filter,
+        std::is_same<typename GFX::S_2D, ImGuiAPI::S_2D>());
+}
 
-        pos.m_size = tex.m_size = 2;
-        col.m_size              = 4;
+/* Entry points of the backend driven by the untemplated API. Switching
+ *  backends costs one indirection per call, the renderer itself is
+ *  resolved at compile time. */
+struct BackendEntry
+{
+    template<typename GFX>
+    static BackendEntry Of()
+    {
+        return {
+            NewFrame<GFX>,
+            CreateDeviceObjects<GFX>,
+            InvalidateDeviceObjects<GFX>,
+            DestroyDeviceObjects<GFX>,
+            GetDeviceStatus<GFX>,
+            ImGui_ImplSdlGL3_RenderDrawLists<GFX>,
+            SubmitPending<GFX>,
+            RestoreFontsTexture<GFX>,
+            AwaitFontAtlas<GFX>,
+            ConfigureStreaming<GFX>,
+            GetRenderStats<GFX>,
+            GetDeviceStats<GFX>,
+            GetFontAtlasStats<GFX>,
+            RegisterImGuiAPITexture<GFX>,
+            UnregisterTexture<GFX>,
+            ReleaseProgramCache<GFX>,
+        };
+    }
 
-        pos.m_stride = tex.m_stride = col.m_stride = sizeof(ImDrawVert);
-        pos.m_off                                  = offsetof(ImDrawVert, pos);
-        tex.m_off                                  = offsetof(ImDrawVert, uv);
-        col.m_off                                  = offsetof(ImDrawVert, col);
-        col.m_type                                 = RHI::TypeEnum::UByte;
-        col.m_flags = GFX::AttributePacked | GFX::AttributeNormalization;
+    bool (*new_frame)(Components::EntityContainer&);
+    bool (*create)(imgui_error_code&);
+    void (*invalidate)(imgui_error_code&);
+    void (*destroy)();
+    DeviceStatus (*status)();
+    void (*render)(ImDrawData*);
+    bool (*submit_pending)(Components::duration const&);
+    void (*restore_fonts)();
+    void (*await_fonts)();
+    void (*configure_streaming)(StreamingConfig const&);
+
+    RenderStats const& (*render_stats)();
+    DeviceStats const& (*device_stats)();
+    FontAtlasStats const& (*atlas_stats)();
+
+    ImTextureID (*register_texture)(ImGuiAPI::S_2D&, Filtering);
+    void (*unregister_texture)(ImTextureID);
+    void (*release_programs)();
+};
 
-        a.addAttribute(pos);
-        a.addAttribute(tex);
-        a.addAttribute(col);
+static BackendEntry im_backend = BackendEntry::Of<DefaultAPI>();
 
-        a.bindBuffer(0, im_data->vertices);
-        a.setIndexBuffer(&im_data->elements);
-    } while(false);
+template<typename GFX>
+void UseBackend()
+{
+    im_backend = BackendEntry::Of<GFX>();
 
-    ImGui_ImplSdlGL3_CreateFontsTexture();
+    if(!im_software)
+    {
+        ImGui::GetIO().RenderDrawListsFn = im_backend.render;
+        im_backend.restore_fonts();
+    }
+}
 
-    return true;
+bool CreateDeviceObjects(imgui_error_code& ec)
+{
+    return im_backend.create(ec);
 }
 
 void InvalidateDeviceObjects(imgui_error_code& ec)
 {
-    const auto im_data = C_DCAST<ImGuiData>(State::PeekState("im_data").get());
-
-    if(im_data)
-    {
-        DProfContext    _(IM_API "Invalidating device objects");
-        GFX::DBG::SCOPE a(IM_API "Invalidating device objects");
-        im_data->vertices.dealloc();
-        im_data->elements.dealloc();
-        im_data->attributes.dealloc();
-    } else
-        ec = ImError::AlreadyUnloaded;
+    im_backend.invalidate(ec);
 }
 
 bool Init(Components::EntityContainer& container)
@@ -732,10 +3095,12 @@ bool Init(Components::EntityContainer& container)
     }
 
     io.RenderDrawListsFn =
-        ImGui_ImplSdlGL3_RenderDrawLists; // Alternatively you can set this to
-                                          // NULL and call ImGui::GetDrawData()
-                                          // after ImGui::Render() to get the
-                                          // same ImDrawData pointer.
+        im_backend.render; // Alternatively you can set this to
+                           // NULL and call ImGui::GetDrawData()
+                           // after ImGui::Render() to get the
+                           // same ImDrawData pointer.
+    if(im_software)
+        io.RenderDrawListsFn = ImGui_SoftwareRenderDrawLists;
     io.SetClipboardTextFn = ImGui_ImplSdlGL3_SetClipboardText;
     io.GetClipboardTextFn = ImGui_ImplSdlGL3_GetClipboardText;
     io.ClipboardUserData  = nullptr;
@@ -749,66 +3114,291 @@ void Shutdown()
 {
     DProfContext _(IM_API "Shutting down");
 
-    State::SwapState("im_data", {});
+    im_frames.set_device_ready(false);
+    im_frame_started = false;
+    im_backend.destroy();
+    ImGui::Shutdown();
 
-    imgui_error_code ec;
+    /* Placeholder glyphs went away with the atlas */
+    im_glyphs.clear();
+    im_sdf_pixels.clear();
+    im_sdf_source = nullptr;
+}
 
-    InvalidateDeviceObjects(ec);
-    ImGui::Shutdown();
+void ReleaseProgramCache()
+{
+    im_backend.release_programs();
 }
 
-void NewFrame(Components::EntityContainer& container)
+bool NewFrame(Components::EntityContainer& container)
 {
-    auto im_data = C_DCAST<ImGuiData>(State::PeekState("im_data").get());
-    DProfContext _(IM_API "Preparing frame data");
+    return im_backend.new_frame(container);
+}
 
-    imgui_error_code ec;
+/* RenderFlag_DeferredSubmit, hands the frame to SubmitPendingFrame() */
+static void PublishFrame(ImDrawData* draw_data)
+{
+    DProfContext _(IM_API "Publishing frame");
+
+    auto const& io = ImGui::GetIO();
+
+    im_frames.back().take(
+        draw_data, im_primitives, io.DisplaySize, io.DisplayFramebufferScale);
+    im_frames.publish();
+}
 
-    if(!im_data || !im_data->pipeline->pipelineHandle())
+static void PublishRedraw()
+{
+    auto const& io = ImGui::GetIO();
+
+    im_frames.back().take_redraw(io.DisplaySize, io.DisplayFramebufferScale);
+    im_frames.publish();
+}
+
+void EndFrame()
+{
+    if(!im_frame_started)
+        return;
+
+    im_frame_started = false;
+
+    DProfContext _(IM_API "Rendering UI");
+
+    const bool deferred = UseDeferredSubmit();
+
+    if(!im_capture && !deferred)
     {
-        CreateDeviceObjects(ec);
-        im_data = C_DCAST<ImGuiData>(State::PeekState("im_data").get());
+        ImGui::Render();
+        return;
     }
 
-    C_ERROR_CHECK(ec);
+    /* Recorded before the renderer scales the clip rects in place */
+    ImGuiIO& io     = ImGui::GetIO();
+    auto     render = io.RenderDrawListsFn;
+
+    io.RenderDrawListsFn = nullptr;
+    ImGui::Render();
+    io.RenderDrawListsFn = render;
+
+    if(auto draw_data = ImGui::GetDrawData())
+    {
+        if(im_capture)
+            im_capture->record(draw_data, &im_primitives);
+
+        if(deferred)
+            PublishFrame(draw_data);
+        else if(render)
+            render(draw_data);
+    }
+
+    if(im_capture && im_capture_frames && --im_capture_frames == 0)
+        im_capture = nullptr;
+}
+
+void StartCapture(DrawCapture* capture, u32 frames)
+{
+    im_capture        = capture;
+    im_capture_frames = frames;
+}
+
+void StopCapture()
+{
+    im_capture        = nullptr;
+    im_capture_frames = 0;
+}
+
+namespace detail {
+
+PrimitiveStream& FramePrimitives()
+{
+    return im_primitives;
+}
+
+} // namespace detail
+
+/* Whether shapes become instance records, which neither fully transparent
+ *  shapes nor the software renderer need */
+static bool RecordPrimitive(ImU32 col)
+{
+    return UsePrimitives() && !im_software &&
+           ((col >> IM_COL32_A_SHIFT) & 0xFF) != 0;
+}
+
+void AddRect(
+    ImDrawList*   list,
+    ImVec2 const& a,
+    ImVec2 const& b,
+    ImU32         col,
+    f32           rounding,
+    f32           thickness)
+{
+    if(!RecordPrimitive(col))
+        return list->AddRect(a, b, col, rounding, ~0, thickness);
+
+    if(thickness > 0.f)
+        im_primitives.add(
+            list, {{a.x, a.y, b.x, b.y}, rounding, thickness, col});
+}
+
+void AddRectFilled(
+    ImDrawList*   list,
+    ImVec2 const& a,
+    ImVec2 const& b,
+    ImU32         col,
+    f32           rounding)
+{
+    if(!RecordPrimitive(col))
+        return list->AddRectFilled(a, b, col, rounding);
+
+    im_primitives.add(list, {{a.x, a.y, b.x, b.y}, rounding, 0.f, col});
+}
+
+void AddCircle(
+    ImDrawList*   list,
+    ImVec2 const& centre,
+    f32           radius,
+    ImU32         col,
+    f32           thickness)
+{
+    if(!RecordPrimitive(col))
+        return list->AddCircle(centre, radius, col, 12, thickness);
+
+    if(thickness > 0.f)
+        im_primitives.add(
+            list,
+            {{centre.x - radius,
+              centre.y - radius,
+              centre.x + radius,
+              centre.y + radius},
+             radius,
+             thickness,
+             col});
+}
+
+void AddCircleFilled(
+    ImDrawList* list, ImVec2 const& centre, f32 radius, ImU32 col)
+{
+    if(!RecordPrimitive(col))
+        return list->AddCircleFilled(centre, radius, col);
+
+    im_primitives.add(
+        list,
+        {{centre.x - radius,
+          centre.y - radius,
+          centre.x + radius,
+          centre.y + radius},
+         radius,
+         0.f,
+         col});
+}
+
+bool FrameReady()
+{
+    if(UseDeferredSubmit())
+        return im_frames.device_ready();
+
+    return im_software || GetDeviceStatus() == DeviceStatus::Ready;
+}
+
+bool SubmitPendingFrame(Components::duration const& timeout)
+{
+    return im_backend.submit_pending(timeout);
+}
 
+void SetSoftwareRenderer(SoftwareRenderer* renderer)
+{
     ImGuiIO& io = ImGui::GetIO();
 
-    // Setup display size (every frame to accommodate for window resizing)
-    auto s = container.service<comp_app::Windowing>()->size();
+    im_backend.await_fonts();
 
-    scalar uiScaling = PlatformData::DeviceDPI();
+    im_software = renderer;
 
-    io.DisplaySize             = ImVec2(s.w / uiScaling, s.h / uiScaling);
-    io.DisplayFramebufferScale = ImVec2(uiScaling, uiScaling);
+    /* Fonts are registered again on the next NewFrame() */
+    io.Fonts->TexID = nullptr;
 
-    // Setup time step
-    f32 time     = C_CAST<f32>(0);
-    io.DeltaTime = im_data->time > 0.0f ? C_CAST<f32>(time - im_data->time)
-                                        : C_CAST<f32>(1.0f / 60.0f);
-    im_data->time = time;
+    if(renderer)
+        io.RenderDrawListsFn = ImGui_SoftwareRenderDrawLists;
+    else
+    {
+        io.RenderDrawListsFn = im_backend.render;
+        im_backend.restore_fonts();
+    }
+}
 
-    // Setup inputs
-#if !defined(COFFEE_ANDROID) && !defined(COFFEE_APPLE_MOBILE)
-    auto pos    = container.service<comp_app::MouseInput>()->position();
-    io.MousePos = ImVec2(pos.x / uiScaling, pos.y / uiScaling);
-#else
-    io.MouseDown[CIMouseButtonEvent::LeftButton - 1] = false;
-#endif
+DeviceStatus GetDeviceStatus()
+{
+    return im_backend.status();
+}
 
-    io.MouseWheel   = im_data->scroll;
-    im_data->scroll = 0.0f;
+cstring DeviceStatusName(DeviceStatus status)
+{
+    switch(status)
+    {
+    case DeviceStatus::Unloaded:
+        return "Unloaded";
+    case DeviceStatus::Allocating:
+        return "Allocating";
+    case DeviceStatus::CompilingShaders:
+        return "CompilingShaders";
+    case DeviceStatus::LinkingShaders:
+        return "LinkingShaders";
+    case DeviceStatus::VertexLayout:
+        return "VertexLayout";
+    case DeviceStatus::UploadingFonts:
+        return "UploadingFonts";
+    case DeviceStatus::Ready:
+        return "Ready";
+    case DeviceStatus::Failed:
+        return "Failed";
+    }
 
-    // Start the frame
-    DProfContext __(IM_API "Running ImGui::NewFrame()");
-    ImGui::NewFrame();
+    return "Unknown";
 }
 
-void EndFrame()
+void SetStreamingConfig(StreamingConfig const& config)
 {
-    DProfContext _(IM_API "Rendering UI");
+    im_stream_config = config;
 
-    ImGui::Render();
+    im_backend.configure_streaming(config);
+}
+
+void SetRenderFlags(u32 flags)
+{
+    im_render_flags = flags;
+}
+
+u32 GetRenderFlags()
+{
+    return im_render_flags;
+}
+
+FontAtlasStats const& GetFontAtlasStats()
+{
+    return im_backend.atlas_stats();
+}
+
+void AddDynamicGlyphs(
+    Bytes const&   font_data,
+    f32            size_pixels,
+    const ImWchar* ranges,
+    ImFont*        target)
+{
+    im_glyphs.add_source(font_data, size_pixels, ranges, target);
+}
+
+void SetDynamicGlyphConfig(DynamicGlyphConfig const& config)
+{
+    im_glyphs.configure(config);
+}
+
+DeviceStats const& GetDeviceStats()
+{
+    return im_backend.device_stats();
+}
+
+RenderStats const& GetRenderStats()
+{
+    return im_backend.render_stats();
 }
 
 const char* imgui_error_category::name() const noexcept
@@ -842,11 +3432,37 @@ std::string imgui_error_category::message(int code) const
     C_ERROR_CODE_OUT_OF_BOUNDS();
 }
 
+ImTextureID RegisterTexture(ImGuiAPI::S_2D& surface, Filtering filter)
+{
+    return im_backend.register_texture(surface, filter);
+}
+
+void UnregisterTexture(ImTextureID texture)
+{
+    im_backend.unregister_texture(texture);
+}
+
+void RequestRedraw()
+{
+    im_redraw_requested = true;
+}
+
+void RequestRedraw(Components::duration const& within)
+{
+    im_redraw_within = std::min(im_redraw_within, within);
+}
+
 void ImGuiSystem::load(entity_container& e, comp_app::app_error& ec)
 {
     Init(e);
     priority          = 512;
     m_textInputActive = false;
+    m_idleMode        = false;
+    m_frameActive     = false;
+    m_settleFrames    = im_idle_settle_frames;
+    m_inputGeneration = im_input_generation;
+    m_redrawDeadline  = time_point::max();
+    m_displaySize     = {};
 }
 
 void ImGuiSystem::unload(entity_container& e, comp_app::app_error& ec)
@@ -854,9 +3470,66 @@ void ImGuiSystem::unload(entity_container& e, comp_app::app_error& ec)
     Shutdown();
 }
 
+bool ImGuiSystem::frameRequired(Proxy& p, Components::time_point const& t)
+{
+    bool changed = false;
+
+    if(m_inputGeneration != im_input_generation)
+    {
+        m_inputGeneration = im_input_generation;
+        changed           = true;
+    }
+
+    auto size = get_container(p).service<comp_app::Windowing>()->size();
+
+    ImVec2 display_size = {C_CAST<f32>(size.w), C_CAST<f32>(size.h)};
+
+    if(display_size.x != m_displaySize.x || display_size.y != m_displaySize.y)
+    {
+        m_displaySize = display_size;
+        changed       = true;
+    }
+
+    if(im_redraw_requested)
+    {
+        im_redraw_requested = false;
+        changed             = true;
+    }
+
+    if(im_redraw_within != duration::max())
+    {
+        m_redrawDeadline = std::min(m_redrawDeadline, t + im_redraw_within);
+        im_redraw_within = duration::max();
+    }
+
+    if(t >= m_redrawDeadline)
+    {
+        m_redrawDeadline = time_point::max();
+        changed          = true;
+    }
+
+    if(changed)
+        m_settleFrames = im_idle_settle_frames;
+
+    if(!m_settleFrames)
+        return false;
+
+    m_settleFrames--;
+    return true;
+}
+
 void ImGuiSystem::start_restricted(Proxy& p, Components::time_point const& t)
 {
-    NewFrame(get_container(p));
+    m_frameActive = !m_idleMode || frameRequired(p, t);
+
+    if(!m_frameActive)
+        return;
+
+    /* Device objects are still being created, there is no ImGui frame */
+    m_frameActive = NewFrame(get_container(p));
+
+    if(!m_frameActive)
+        return;
 
     auto  keyboard = p.service<comp_app::KeyboardInput>();
     auto& io       = ImGui::GetIO();
@@ -884,7 +3557,28 @@ void ImGuiSystem::start_restricted(Proxy& p, Components::time_point const& t)
 
 void ImGuiSystem::end_restricted(Proxy&, Components::time_point const&)
 {
-    EndFrame();
+    if(m_frameActive)
+    {
+        EndFrame();
+
+        /* Keep the text cursor blinking while idle */
+        if(m_idleMode && ImGui::GetIO().WantTextInput)
+            RequestRedraw(Chrono::milliseconds(500));
+        return;
+    }
+
+    const bool deferred = UseDeferredSubmit();
+
+    if(deferred ? !im_frames.device_ready()
+                : GetDeviceStatus() != DeviceStatus::Ready)
+        return;
+
+    DProfContext _(IM_API "Redrawing idle UI");
+
+    if(deferred)
+        PublishRedraw();
+    else
+        im_backend.render(nullptr);
 }
 
 ImGuiSystem& ImGuiSystem::addWidget(ImGuiWidget&& widget)
@@ -893,6 +3587,28 @@ ImGuiSystem& ImGuiSystem::addWidget(ImGuiWidget&& widget)
     return *this;
 }
 
+ImGuiSystem& ImGuiSystem::setRenderFlags(u32 flags)
+{
+    SetRenderFlags(flags);
+    return *this;
+}
+
+ImGuiSystem& ImGuiSystem::setIdleMode(bool enabled)
+{
+    m_idleMode     = enabled;
+    m_settleFrames = im_idle_settle_frames;
+    return *this;
+}
+
+ImGuiSystem& ImGuiSystem::setSkipUnchanged(bool enabled)
+{
+    if(enabled)
+        SetRenderFlags(GetRenderFlags() | RenderFlag_SkipUnchanged);
+    else
+        SetRenderFlags(GetRenderFlags() & ~RenderFlag_SkipUnchanged);
+    return *this;
+}
+
 ImGuiWidget Widgets::StatsMenu()
 {
     return [ m_values = Vector<scalar>(), m_index = szptr(0) ](
@@ -926,5 +3642,25 @@ ImGuiWidget Widgets::StatsMenu()
     };
 }
 
+#define IM_INSTANTIATE(API)                                                  \
+    template void UseBackend<API>();                                         \
+    template bool NewFrame<API>(Components::EntityContainer&);               \
+    template bool CreateDeviceObjects<API>(imgui_error_code&);               \
+    template void InvalidateDeviceObjects<API>(imgui_error_code&);           \
+    template void DestroyDeviceObjects<API>();                               \
+    template void RenderDrawData<API>(ImDrawData*);                          \
+    template DeviceStatus GetDeviceStatus<API>();                            \
+    template RenderStats const& GetRenderStats<API>();                       \
+    template DeviceStats const& GetDeviceStats<API>();                       \
+    template FontAtlasStats const& GetFontAtlasStats<API>();                 \
+    template ImTextureID RegisterTexture<API>(API::S_2D&, Filtering);        \
+    template void UnregisterTexture<API>(ImTextureID);                       \
+    template void ReleaseProgramCache<API>();
+
+IM_INSTANTIATE(RHI::GLEAM::GLEAM_API)
+IM_INSTANTIATE(RHI::NullAPI)
+
+#undef IM_INSTANTIATE
+
 } // namespace CImGui
 } // namespace Coffee
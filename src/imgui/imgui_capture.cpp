@@ -0,0 +1,484 @@
+#include <coffee/imgui/imgui_capture.h>
+
+#include <coffee/core/CProfiling>
+
+#include "imgui_atlas_cache.h"
+#include "imgui_primitive_stream.h"
+
+#include <cstring>
+
+#define IM_API "ImGui::"
+
+namespace Coffee {
+namespace CImGui {
+
+namespace {
+
+/* Layout of a serialised capture:
+ *
+ *  capture_header
+ *  per frame:
+ *   frame_header
+ *   per list:
+ *    list_header
+ *    char              x name_size, the name of the owning window
+ *    cmd_record        x cmd_count
+ *    PrimitiveInstance x instance_count, of the marker commands in order
+ *    ImDrawVert        x vtx_count
+ *    ImDrawIdx         x idx_count
+ *
+ * Vertices and indices are stored as-is, captures are only loaded by
+ *  builds with the same ImDrawVert and ImDrawIdx.
+ */
+constexpr u32 capture_magic   = 0x43444D49; /* "IMDC" */
+constexpr u32 capture_version = 2;
+
+using detail::PrimitiveInstance;
+
+struct capture_header
+{
+    u32 magic;
+    u32 version;
+    u32 vertex_size;
+    u32 index_size;
+    u64 atlas_hash;
+    u32 frame_count;
+    u32 _pad;
+};
+
+struct frame_header
+{
+    f32 display_w, display_h;
+    f32 scale_x, scale_y;
+    u32 list_count;
+    u32 _pad;
+    /* Bytes following the header */
+    u64 size;
+};
+
+struct list_header
+{
+    u32 vtx_count;
+    u32 idx_count;
+    u32 cmd_count;
+    u32 name_size;
+    u32 instance_count;
+    u32 _pad;
+};
+
+enum texture_kind : u32
+{
+    Texture_None,
+    Texture_FontAtlas,
+    Texture_User,
+};
+
+struct cmd_record
+{
+    u32 elem_count;
+    u32 kind;
+    u64 texture;
+    f32 clip[4];
+    /* Instances of a primitive marker, 0 for other commands */
+    u32 instances;
+    u32 _pad;
+};
+
+void write(Vector<u8>& out, const void* data, szptr size)
+{
+    auto ptr = C_RCAST<const u8*>(data);
+    out.insert(out.end(), ptr, ptr + size);
+}
+
+szptr list_payload(list_header const& list)
+{
+    return list.name_size + list.cmd_count * sizeof(cmd_record) +
+           list.instance_count * sizeof(PrimitiveInstance) +
+           list.vtx_count * sizeof(ImDrawVert) +
+           list.idx_count * sizeof(ImDrawIdx);
+}
+
+/* Checks that the commands of a list draw exactly its indices and
+ *  instances, and that the indices stay within its vertices */
+bool validate_list(list_header const& list, const u8* data)
+{
+    data += list.name_size;
+
+    u64 elements  = 0;
+    u64 instances = 0;
+
+    for(u32 i = 0; i < list.cmd_count; i++)
+    {
+        cmd_record record;
+        std::memcpy(&record, data, sizeof(record));
+        data += sizeof(record);
+
+        /* Markers draw no elements */
+        if(record.instances && record.elem_count)
+            return false;
+
+        elements += record.elem_count;
+        instances += record.instances;
+    }
+
+    if(elements != list.idx_count || instances != list.instance_count)
+        return false;
+
+    data += list.instance_count * sizeof(PrimitiveInstance);
+    data += list.vtx_count * sizeof(ImDrawVert);
+
+    for(u32 i = 0; i < list.idx_count; i++)
+    {
+        ImDrawIdx idx;
+        std::memcpy(&idx, data, sizeof(idx));
+        data += sizeof(idx);
+
+        if(idx >= list.vtx_count)
+            return false;
+    }
+
+    return true;
+}
+
+/* Checks that every list of the frame fits in its payload, and is valid */
+bool validate_frame(frame_header const& frame, const u8* data)
+{
+    szptr offset = 0;
+
+    for(u32 i = 0; i < frame.list_count; i++)
+    {
+        list_header list;
+
+        if(offset + sizeof(list) > frame.size)
+            return false;
+
+        std::memcpy(&list, data + offset, sizeof(list));
+        offset += sizeof(list);
+
+        if(list_payload(list) > frame.size - offset ||
+           !validate_list(list, data + offset))
+            return false;
+
+        offset += list_payload(list);
+    }
+
+    return offset == frame.size;
+}
+
+} // namespace
+
+struct DrawCapture::state
+{
+    u64 atlas_hash = 0;
+
+    /* frame_header and payload of every frame */
+    Vector<u8>    data;
+    Vector<szptr> offsets;
+
+    /* The last rebuilt frame */
+    Vector<PrimitiveInstance> instances;
+    Vector<UqPtr<ImDrawList>> lists;
+    Vector<ImDrawList*>       list_ptrs;
+    Vector<CString>           names;
+    ImDrawData                draw_data;
+};
+
+DrawCapture::DrawCapture() : m_state(MkUq<state>())
+{
+}
+
+DrawCapture::~DrawCapture()
+{
+}
+
+void DrawCapture::record(
+    ImDrawData const* draw_data, detail::PrimitiveStream const* primitives)
+{
+    DProfContext _(IM_API "Capturing draw data");
+
+    auto& s  = *m_state;
+    auto& io = ImGui::GetIO();
+
+    if(s.offsets.empty())
+        s.atlas_hash = detail::AtlasCache::ConfigHash(*io.Fonts);
+
+    const auto start = s.data.size();
+
+    frame_header frame = {io.DisplaySize.x,
+                          io.DisplaySize.y,
+                          io.DisplayFramebufferScale.x,
+                          io.DisplayFramebufferScale.y,
+                          C_FCAST<u32>(draw_data->CmdListsCount),
+                          0,
+                          0};
+    write(s.data, &frame, sizeof(frame));
+
+    for(int n = 0; n < draw_data->CmdListsCount; n++)
+    {
+        auto const* list = draw_data->CmdLists[n];
+        const auto  name = list->_OwnerName;
+
+        auto run_of = [primitives](ImDrawCmd const& cmd) {
+            return primitives ? primitives->find(cmd) : nullptr;
+        };
+
+        u32 cmd_count      = 0;
+        u32 instance_count = 0;
+        for(auto const& cmd : list->CmdBuffer)
+        {
+            auto run = run_of(cmd);
+
+            if(run)
+                instance_count += run->count;
+            if(run || !cmd.UserCallback)
+                cmd_count++;
+        }
+
+        list_header header = {C_FCAST<u32>(list->VtxBuffer.Size),
+                              C_FCAST<u32>(list->IdxBuffer.Size),
+                              cmd_count,
+                              name ? C_FCAST<u32>(std::strlen(name)) : 0,
+                              instance_count,
+                              0};
+        write(s.data, &header, sizeof(header));
+        write(s.data, name, header.name_size);
+
+        for(auto const& cmd : list->CmdBuffer)
+        {
+            auto run = run_of(cmd);
+
+            if(cmd.UserCallback && !run)
+                continue;
+
+            cmd_record record = {cmd.ElemCount,
+                                 Texture_User,
+                                 C_RCAST<u64>(cmd.TextureId),
+                                 {cmd.ClipRect.x,
+                                  cmd.ClipRect.y,
+                                  cmd.ClipRect.z,
+                                  cmd.ClipRect.w},
+                                 run ? run->count : 0,
+                                 0};
+
+            if(!cmd.TextureId)
+                record.kind = Texture_None;
+            else if(cmd.TextureId == io.Fonts->TexID)
+            {
+                record.kind    = Texture_FontAtlas;
+                record.texture = 0;
+            }
+
+            write(s.data, &record, sizeof(record));
+        }
+
+        for(auto const& cmd : list->CmdBuffer)
+            if(auto run = run_of(cmd))
+                write(
+                    s.data,
+                    primitives->instances.data() + run->first,
+                    run->count * sizeof(PrimitiveInstance));
+
+        write(
+            s.data,
+            list->VtxBuffer.Data,
+            header.vtx_count * sizeof(ImDrawVert));
+        write(
+            s.data, list->IdxBuffer.Data, header.idx_count * sizeof(ImDrawIdx));
+    }
+
+    frame.size = s.data.size() - start - sizeof(frame);
+    std::memcpy(&s.data[start], &frame, sizeof(frame));
+
+    s.offsets.push_back(start);
+}
+
+void DrawCapture::clear()
+{
+    m_state->data.clear();
+    m_state->offsets.clear();
+    m_state->atlas_hash = 0;
+}
+
+void DrawCapture::serialize(Vector<u8>& out) const
+{
+    capture_header header = {capture_magic,
+                             capture_version,
+                             sizeof(ImDrawVert),
+                             sizeof(ImDrawIdx),
+                             m_state->atlas_hash,
+                             C_FCAST<u32>(m_state->offsets.size()),
+                             0};
+
+    out.clear();
+    out.reserve(sizeof(header) + m_state->data.size());
+    write(out, &header, sizeof(header));
+    write(out, m_state->data.data(), m_state->data.size());
+}
+
+bool DrawCapture::deserialize(const u8* data, szptr size)
+{
+    capture_header header;
+
+    if(size < sizeof(header))
+        return false;
+
+    std::memcpy(&header, data, sizeof(header));
+
+    if(header.magic != capture_magic || header.version != capture_version ||
+       header.vertex_size != sizeof(ImDrawVert) ||
+       header.index_size != sizeof(ImDrawIdx))
+        return false;
+
+    Vector<szptr> offsets;
+    szptr         offset = 0;
+
+    data += sizeof(header);
+    size -= sizeof(header);
+
+    for(u32 i = 0; i < header.frame_count; i++)
+    {
+        frame_header frame;
+
+        if(offset + sizeof(frame) > size)
+            return false;
+
+        std::memcpy(&frame, data + offset, sizeof(frame));
+
+        if(frame.size > size - offset - sizeof(frame) ||
+           !validate_frame(frame, data + offset + sizeof(frame)))
+            return false;
+
+        offsets.push_back(offset);
+        offset += sizeof(frame) + frame.size;
+    }
+
+    if(offset != size)
+        return false;
+
+    m_state->atlas_hash = header.atlas_hash;
+    m_state->offsets    = std::move(offsets);
+    m_state->data.assign(data, data + size);
+
+    return true;
+}
+
+u32 DrawCapture::frames() const
+{
+    return C_FCAST<u32>(m_state->offsets.size());
+}
+
+bool DrawCapture::atlasMatches() const
+{
+    return detail::AtlasCache::ConfigHash(*ImGui::GetIO().Fonts) ==
+           m_state->atlas_hash;
+}
+
+ImDrawData* DrawCapture::frame(u32 index)
+{
+    auto& s = *m_state;
+
+    if(index >= s.offsets.size())
+        return nullptr;
+
+    auto& io  = ImGui::GetIO();
+    auto  ptr = s.data.data() + s.offsets[index];
+
+    frame_header frame;
+    std::memcpy(&frame, ptr, sizeof(frame));
+    ptr += sizeof(frame);
+
+    io.DisplaySize             = ImVec2(frame.display_w, frame.display_h);
+    io.DisplayFramebufferScale = ImVec2(frame.scale_x, frame.scale_y);
+
+    while(s.lists.size() < frame.list_count)
+        s.lists.push_back(MkUq<ImDrawList>());
+
+    s.names.resize(frame.list_count);
+    s.list_ptrs.clear();
+
+    auto& primitives = detail::FramePrimitives();
+    primitives.clear();
+
+    int total_vertices = 0;
+    int total_elements = 0;
+
+    for(u32 i = 0; i < frame.list_count; i++)
+    {
+        auto& list = *s.lists[i];
+
+        list_header header;
+        std::memcpy(&header, ptr, sizeof(header));
+        ptr += sizeof(header);
+
+        s.names[i].assign(C_RCAST<const char*>(ptr), header.name_size);
+        ptr += header.name_size;
+
+        list.Clear();
+        list._OwnerName = header.name_size ? s.names[i].c_str() : nullptr;
+
+        list.CmdBuffer.resize(C_FCAST<int>(header.cmd_count));
+
+        /* Instance records follow the commands */
+        auto instances = ptr + header.cmd_count * sizeof(cmd_record);
+
+        for(auto& cmd : list.CmdBuffer)
+        {
+            cmd_record record;
+            std::memcpy(&record, ptr, sizeof(record));
+            ptr += sizeof(record);
+
+            cmd           = ImDrawCmd();
+            cmd.ElemCount = record.elem_count;
+            cmd.ClipRect  = ImVec4(
+                record.clip[0], record.clip[1], record.clip[2], record.clip[3]);
+
+            if(record.kind == Texture_FontAtlas)
+                cmd.TextureId = io.Fonts->TexID;
+            else if(record.kind == Texture_User)
+                cmd.TextureId = C_RCAST<ImTextureID>(
+                    C_FCAST<uintptr_t>(record.texture));
+
+            if(!record.instances)
+                continue;
+
+            s.instances.resize(record.instances);
+            std::memcpy(
+                s.instances.data(),
+                instances,
+                record.instances * sizeof(PrimitiveInstance));
+            instances += record.instances * sizeof(PrimitiveInstance);
+
+            cmd.UserCallback     = detail::PrimitiveMarker;
+            cmd.UserCallbackData = primitives.add_run(
+                s.instances.data(), record.instances);
+        }
+
+        ptr = instances;
+
+        list.VtxBuffer.resize(C_FCAST<int>(header.vtx_count));
+        std::memcpy(
+            list.VtxBuffer.Data, ptr, header.vtx_count * sizeof(ImDrawVert));
+        ptr += header.vtx_count * sizeof(ImDrawVert);
+
+        list.IdxBuffer.resize(C_FCAST<int>(header.idx_count));
+        std::memcpy(
+            list.IdxBuffer.Data, ptr, header.idx_count * sizeof(ImDrawIdx));
+        ptr += header.idx_count * sizeof(ImDrawIdx);
+
+        total_vertices += list.VtxBuffer.Size;
+        total_elements += list.IdxBuffer.Size;
+
+        s.list_ptrs.push_back(&list);
+    }
+
+    s.draw_data.Valid         = true;
+    s.draw_data.CmdLists      = s.list_ptrs.data();
+    s.draw_data.CmdListsCount = C_FCAST<int>(s.list_ptrs.size());
+    s.draw_data.TotalVtxCount = total_vertices;
+    s.draw_data.TotalIdxCount = total_elements;
+
+    return &s.draw_data;
+}
+
+} // namespace CImGui
+} // namespace Coffee
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <coffee/core/libc_types.h>
+
+#include <imgui.h>
+
+#include <algorithm>
+
+namespace Coffee {
+namespace CImGui {
+namespace detail {
+
+/* Vertex of RenderFlag_ShaderClip, an ImDrawVert with the clip rect of the
+ *  command which draws it */
+struct ClipVertex
+{
+    ImVec2 pos;
+    ImVec2 uv;
+    ImU32  col;
+
+    /* x0, y0, x1, y1, see PackClipRect() */
+    u16 clip[4];
+};
+
+/* Every pixel passes, for vertices drawn with scissor state */
+static constexpr u16 clip_unbounded[4] = {0, 0, 0xFFFF, 0xFFFF};
+
+/* The scissor box the GL path sets for `clip`, as the half-open pixel
+ *  range [x0, x1) x [y0, y1) with a bottom-left origin. Clamping to u16
+ *  keeps empty boxes empty, pixels are never negative. */
+inline void PackClipRect(ImVec4 const& clip, int fb_height, u16* out)
+{
+    const i32 x = C_CAST<i32>(clip.x);
+    const i32 y = C_CAST<i32>(fb_height - clip.w);
+    const i32 w = C_CAST<i32>(clip.z - clip.x);
+    const i32 h = C_CAST<i32>(clip.w - clip.y);
+
+    const i32 box[4] = {x, y, x + w, y + h};
+
+    for(u32 i = 0; i < 4; i++)
+        out[i] = C_CAST<u16>(std::min(std::max(box[i], 0), 0xFFFF));
+}
+
+/* Reference for the fragment shader's test, at gl_FragCoord, ie. pixel
+ *  centres (px + 0.5, py + 0.5) */
+inline bool ClipTest(const u16* clip, f32 frag_x, f32 frag_y)
+{
+    return frag_x >= clip[0] && frag_y >= clip[1] && frag_x < clip[2] &&
+           frag_y < clip[3];
+}
+
+/* Converts `count` vertices, which are left unclipped */
+inline void ConvertVertices(const ImDrawVert* in, szptr count, ClipVertex* out)
+{
+    for(szptr i = 0; i < count; i++)
+    {
+        out[i].pos = in[i].pos;
+        out[i].uv  = in[i].uv;
+        out[i].col = in[i].col;
+        std::copy(clip_unbounded, clip_unbounded + 4, out[i].clip);
+    }
+}
+
+/* Gives every vertex of `list`, converted into `out`, the clip rect of the
+ *  command whose elements reference it. ImGui does not share vertices
+ *  between commands. */
+inline void AssignClipRects(
+    ImDrawList const* list, int fb_height, ClipVertex* out)
+{
+    const ImDrawIdx* idx = list->IdxBuffer.Data;
+
+    for(auto const& cmd : list->CmdBuffer)
+    {
+        if(!cmd.UserCallback)
+        {
+            u16 clip[4];
+            PackClipRect(cmd.ClipRect, fb_height, clip);
+
+            for(u32 i = 0; i < cmd.ElemCount; i++)
+                std::copy(clip, clip + 4, out[idx[i]].clip);
+        }
+
+        idx += cmd.ElemCount;
+    }
+}
+
+} // namespace detail
+} // namespace CImGui
+} // namespace Coffee
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <coffee/core/stl_types.h>
+
+#include <imgui.h>
+
+#include "imgui_primitive_stream.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <utility>
+
+namespace Coffee {
+namespace CImGui {
+namespace detail {
+
+/* ImDrawData of a finished frame, with lists that own their buffers.
+ * take() swaps the buffers with those of the window draw lists instead of
+ *  copying them. The windows get the buffers of an older snapshot, which
+ *  ImGui clears and refills, so in steady state nothing is allocated. */
+struct FrameSnapshot
+{
+    FrameSnapshot() : display_size(), framebuffer_scale(), redraw(false)
+    {
+        draw_data.Valid = false;
+    }
+
+    /* Leaves `source` and `source_primitives` empty */
+    void take(
+        ImDrawData*      source,
+        PrimitiveStream& source_primitives,
+        ImVec2 const&    size,
+        ImVec2 const&    scale)
+    {
+        const auto count = C_FCAST<szptr>(source->CmdListsCount);
+
+        while(lists.size() < count)
+            lists.push_back(MkUq<ImDrawList>());
+
+        list_ptrs.clear();
+
+        for(szptr n = 0; n < count; n++)
+        {
+            auto  src = source->CmdLists[n];
+            auto& dst = *lists[n];
+
+            dst.CmdBuffer.swap(src->CmdBuffer);
+            dst.IdxBuffer.swap(src->IdxBuffer);
+            dst.VtxBuffer.swap(src->VtxBuffer);
+            dst._OwnerName = src->_OwnerName;
+
+            list_ptrs.push_back(&dst);
+        }
+
+        draw_data.Valid         = true;
+        draw_data.CmdLists      = list_ptrs.data();
+        draw_data.CmdListsCount = source->CmdListsCount;
+        draw_data.TotalVtxCount = source->TotalVtxCount;
+        draw_data.TotalIdxCount = source->TotalIdxCount;
+
+        primitives.instances.swap(source_primitives.instances);
+        primitives.runs.swap(source_primitives.runs);
+        source_primitives.clear();
+
+        display_size      = size;
+        framebuffer_scale = scale;
+        redraw            = false;
+    }
+
+    /* Asks for the previous frame to be drawn again */
+    void take_redraw(ImVec2 const& size, ImVec2 const& scale)
+    {
+        draw_data.Valid   = false;
+        display_size      = size;
+        framebuffer_scale = scale;
+        redraw            = true;
+    }
+
+    Vector<UqPtr<ImDrawList>> lists;
+    Vector<ImDrawList*>       list_ptrs;
+    ImDrawData                draw_data;
+    PrimitiveStream           primitives;
+
+    /* The ImGui IO belongs to the thread building the next frame */
+    ImVec2 display_size;
+    ImVec2 framebuffer_scale;
+
+    bool redraw;
+};
+
+/* Hands snapshots from the thread running the widgets to the thread which
+ *  submits them, with two buffers. The back snapshot is filled without a
+ *  lock, publish() swaps it to the front. A front snapshot which was not
+ *  taken yet is replaced, publish() only waits while it is being drawn.
+ */
+struct FrameQueue
+{
+    FrameQueue() :
+        m_back(&m_snapshots[0]), m_front(&m_snapshots[1]), m_pending(false),
+        m_drawing(false), m_device_ready(false), m_published(0),
+        m_replaced(0)
+    {
+    }
+
+    /* Only touched by the building thread until publish() */
+    FrameSnapshot& back()
+    {
+        return *m_back;
+    }
+
+    void publish()
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+
+        /* A frame which was not drawn yet already redraws */
+        if(m_back->redraw && m_pending)
+            return;
+
+        m_changed.wait(lock, [this]() { return !m_drawing; });
+
+        if(m_pending)
+            m_replaced++;
+
+        std::swap(m_back, m_front);
+        m_pending = true;
+        m_published++;
+
+        m_changed.notify_all();
+    }
+
+    /* Returns the published snapshot, null if none arrived within
+     *  `timeout`. It stays valid until end_draw() is called. */
+    template<typename Rep, typename Period>
+    FrameSnapshot* begin_draw(std::chrono::duration<Rep, Period> timeout)
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+
+        if(!m_changed.wait_for(lock, timeout, [this]() { return m_pending; }))
+            return nullptr;
+
+        m_pending = false;
+        m_drawing = true;
+
+        return m_front;
+    }
+
+    void end_draw()
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        m_drawing = false;
+        m_changed.notify_all();
+    }
+
+    /* Device objects are stepped by the submitting thread */
+    void set_device_ready(bool ready)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_device_ready = ready;
+    }
+
+    bool device_ready()
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_device_ready;
+    }
+
+    /* Snapshots published, and those replaced before being drawn */
+    u64 published()
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_published;
+    }
+
+    u64 replaced()
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_replaced;
+    }
+
+  private:
+    FrameSnapshot  m_snapshots[2];
+    FrameSnapshot* m_back;
+    FrameSnapshot* m_front;
+
+    std::mutex              m_lock;
+    std::condition_variable m_changed;
+
+    bool m_pending;
+    bool m_drawing;
+    bool m_device_ready;
+    u64  m_published;
+    u64  m_replaced;
+};
+
+} // namespace detail
+} // namespace CImGui
+} // namespace Coffee
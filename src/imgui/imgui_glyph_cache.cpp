@@ -0,0 +1,453 @@
+#include "imgui_glyph_cache.h"
+
+#include <coffee/core/CProfiling>
+
+#define STBTT_STATIC
+#define STB_TRUETYPE_IMPLEMENTATION
+#include <stb_truetype.h>
+
+#include <algorithm>
+#include <cstring>
+
+#define IM_API "ImGui::"
+
+namespace Coffee {
+namespace CImGui {
+namespace detail {
+
+/* Rows at the top of the region, kept transparent for dropped glyphs */
+static constexpr u32 reserved_rows = 2;
+
+static constexpr u32 no_shelf = ~0u;
+
+/* Spacing between glyphs, so linear filtering never bleeds */
+static constexpr u32 glyph_padding = 1;
+
+struct GlyphCache::font_source
+{
+    Vector<u8>      data;
+    stbtt_fontinfo  info;
+    f32             size_pixels;
+    f32             scale;
+    Vector<ImWchar> ranges;
+    ImFont*         target;
+};
+
+/* Placeholder UVs. Glyph `id` covers u in [-(2id + 2), -(2id + 1)] and
+ *  v in [-2, -1], so that clipped (interpolated) corners still decode. */
+static ImVec4 PlaceholderUV(u32 id)
+{
+    return ImVec4(
+        -C_CAST<f32>(2 * id + 2), -1.f, -C_CAST<f32>(2 * id + 1), -2.f);
+}
+
+GlyphCache::GlyphCache() :
+    m_full_dirty(false), m_sdf_spread(0), m_atlas(nullptr), m_width(0),
+    m_static_height(0), m_total_height(0), m_blank_uv(0, 0), m_stats()
+{
+}
+
+GlyphCache::~GlyphCache()
+{
+}
+
+void GlyphCache::configure(DynamicGlyphConfig const& config)
+{
+    m_config = config;
+}
+
+void GlyphCache::set_sdf_spread(u32 spread)
+{
+    if(spread != m_sdf_spread)
+        clear_residency();
+
+    m_sdf_spread = spread;
+}
+
+void GlyphCache::add_source(
+    Bytes const&   font_data,
+    f32            size_pixels,
+    const ImWchar* ranges,
+    ImFont*        target)
+{
+    auto src = MkUq<font_source>();
+
+    src->data.assign(font_data.data, font_data.data + font_data.size);
+    src->size_pixels = size_pixels;
+    src->target      = target;
+
+    for(auto it = ranges; it && it[0]; it += 2)
+    {
+        src->ranges.push_back(it[0]);
+        src->ranges.push_back(it[1]);
+    }
+
+    m_sources.push_back(std::move(src));
+}
+
+bool GlyphCache::empty() const
+{
+    return m_sources.empty();
+}
+
+u32 GlyphCache::install(ImFontAtlas& atlas)
+{
+    DProfContext _(IM_API "Installing dynamic glyphs");
+
+    if(m_atlas != &atlas)
+    {
+        m_atlas         = &atlas;
+        m_width         = C_FCAST<u32>(atlas.TexWidth);
+        m_static_height = C_FCAST<u32>(atlas.TexHeight);
+        m_total_height  = m_static_height + m_config.atlas_rows;
+
+        /* Static UVs are remapped into the taller texture */
+        const f32 ratio = C_CAST<f32>(m_static_height) / m_total_height;
+
+        for(auto font : atlas.Fonts)
+            for(auto& g : font->Glyphs)
+            {
+                g.V0 *= ratio;
+                g.V1 *= ratio;
+            }
+
+        atlas.TexUvWhitePixel.y *= ratio;
+        atlas.TexUvScale.y = 1.f / m_total_height;
+
+        m_blank_uv = ImVec2(
+            0.5f / m_width, (m_static_height + 0.5f) / m_total_height);
+
+        for(u32 i = 0; i < m_sources.size(); i++)
+        {
+            auto& src  = *m_sources[i];
+            auto  font = src.target ? src.target : atlas.Fonts[0];
+
+            if(!stbtt_InitFont(
+                   &src.info,
+                   src.data.data(),
+                   stbtt_GetFontOffsetForIndex(src.data.data(), 0)))
+                continue;
+
+            src.scale = stbtt_ScaleForPixelHeight(&src.info, src.size_pixels);
+
+            const f32 ascent = C_CAST<f32>(C_CAST<i32>(font->Ascent + 0.5f));
+
+            for(szptr r = 0; r < src.ranges.size(); r += 2)
+            {
+                for(u32 c = src.ranges[r]; c <= src.ranges[r + 1]; c++)
+                {
+                    if(c < C_FCAST<u32>(font->IndexLookup.Size) &&
+                       font->IndexLookup[C_FCAST<int>(c)] != 0xFFFF)
+                        continue;
+
+                    auto index =
+                        stbtt_FindGlyphIndex(&src.info, C_CAST<int>(c));
+                    if(!index)
+                        continue;
+
+                    int advance, lsb, x0, y0, x1, y1;
+                    stbtt_GetGlyphHMetrics(&src.info, index, &advance, &lsb);
+                    stbtt_GetGlyphBitmapBox(
+                        &src.info,
+                        index,
+                        src.scale,
+                        src.scale,
+                        &x0,
+                        &y0,
+                        &x1,
+                        &y1);
+
+                    const auto id = C_FCAST<u32>(m_glyphs.size());
+                    const auto uv = PlaceholderUV(id);
+
+                    m_glyphs.push_back({i,
+                                        index,
+                                        C_FCAST<u32>(x1 - x0),
+                                        C_FCAST<u32>(y1 - y0),
+                                        false,
+                                        0,
+                                        0,
+                                        0.f,
+                                        0.f,
+                                        0.f,
+                                        0.f});
+
+                    font->AddGlyph(
+                        C_CAST<ImWchar>(c),
+                        x0,
+                        y0 + ascent,
+                        x1,
+                        y1 + ascent,
+                        uv.x,
+                        uv.y,
+                        uv.z,
+                        uv.w,
+                        advance * src.scale);
+                }
+
+                /* Overlapping ranges are skipped through the lookup table */
+                font->BuildLookupTable();
+            }
+        }
+
+        m_stats.dynamic_glyphs = C_FCAST<u32>(m_glyphs.size());
+    }
+
+    clear_residency();
+
+    return m_total_height;
+}
+
+void GlyphCache::resolve(
+    ImDrawData* draw_data, ImTextureID font_texture, u64 frame)
+{
+    if(m_glyphs.empty())
+        return;
+
+    DProfContext _(IM_API "Resolving dynamic glyphs");
+
+    const auto glyph_count = C_FCAST<u32>(m_glyphs.size());
+
+    /* Other textures may use any UVs, only vertices of font commands are
+     *  patched. Patched UVs are in [0, 1], shared vertices are skipped. */
+    for(int n = 0; n < draw_data->CmdListsCount; n++)
+    {
+        auto cmd_list = draw_data->CmdLists[n];
+        auto vertices = cmd_list->VtxBuffer.Data;
+        auto indices  = cmd_list->IdxBuffer.Data;
+
+        for(auto const& cmd : cmd_list->CmdBuffer)
+        {
+            const auto first = indices;
+            indices += cmd.ElemCount;
+
+            if(cmd.UserCallback || cmd.TextureId != font_texture)
+                continue;
+
+            for(auto idx = first; idx != indices; idx++)
+            {
+                auto& vtx = vertices[*idx];
+
+                if(vtx.uv.x >= 0.f)
+                    continue;
+
+                const f32 k  = -vtx.uv.x;
+                const u32 id = C_CAST<u32>((k - 1.f) * 0.5f);
+
+                if(id >= glyph_count || !make_resident(id, frame))
+                {
+                    vtx.uv = m_blank_uv;
+                    continue;
+                }
+
+                auto const& g = m_glyphs[id];
+
+                const f32 t = C_CAST<f32>(2 * id + 2) - k;
+                const f32 s = -1.f - vtx.uv.y;
+
+                vtx.uv.x = g.u0 + t * (g.u1 - g.u0);
+                vtx.uv.y = g.v0 + s * (g.v1 - g.v0);
+            }
+        }
+    }
+}
+
+bool GlyphCache::make_resident(u32 id, u64 frame)
+{
+    auto& g = m_glyphs[id];
+
+    if(g.resident)
+    {
+        if(g.last_used != frame && g.shelf != no_shelf)
+            m_packer.shelves[g.shelf].last_used = frame;
+
+        g.last_used = frame;
+        return true;
+    }
+
+    /* Empty glyphs map onto the transparent rows */
+    if(!g.width || !g.height)
+    {
+        g.resident  = true;
+        g.last_used = frame;
+        g.shelf     = no_shelf;
+        g.u0 = g.u1 = m_blank_uv.x;
+        g.v0 = g.v1 = m_blank_uv.y;
+        return true;
+    }
+
+    u32 shelf_idx, x;
+
+    /* Distance fields need room for the falloff around the glyph */
+    const u32 margin = m_sdf_spread;
+    const u32 cell_w = g.width + 2 * margin + glyph_padding;
+    const u32 cell_h = g.height + 2 * margin + glyph_padding;
+
+    m_evicted.clear();
+    if(!m_packer.allocate(
+           cell_w,
+           cell_h,
+           frame,
+           shelf_idx,
+           x,
+           m_evicted))
+    {
+        m_stats.glyphs_dropped++;
+        return false;
+    }
+
+    for(auto evicted : m_evicted)
+        m_glyphs[evicted].resident = false;
+
+    auto& shelf = m_packer.shelves[shelf_idx];
+
+    shelf.glyphs.push_back(id);
+
+    g.resident  = true;
+    g.last_used = frame;
+    g.shelf     = shelf_idx;
+
+    rasterize(g, x, shelf.y + reserved_rows, cell_w, cell_h);
+
+    const u32 tex_x = x + margin;
+    const u32 tex_y = m_static_height + shelf.y + reserved_rows + margin;
+
+    g.u0 = C_CAST<f32>(tex_x) / m_width;
+    g.u1 = C_CAST<f32>(tex_x + g.width) / m_width;
+    g.v0 = C_CAST<f32>(tex_y) / m_total_height;
+    g.v1 = C_CAST<f32>(tex_y + g.height) / m_total_height;
+
+    if(m_dirty.size() < m_packer.shelves.size())
+        m_dirty.resize(m_packer.shelves.size(), {~0u, 0});
+
+    auto& dirty  = m_dirty[shelf_idx];
+    dirty.first  = std::min(dirty.first, x);
+    dirty.second = std::max(dirty.second, x + cell_w);
+
+    m_stats.glyphs_rasterized++;
+
+    return true;
+}
+
+void GlyphCache::rasterize(glyph& g, u32 x, u32 y, u32 cell_w, u32 cell_h)
+{
+    auto const& src = *m_sources[g.source];
+
+    const u32 margin = m_sdf_spread;
+    const u32 w      = g.width + 2 * margin;
+    const u32 h      = g.height + 2 * margin;
+
+    m_raster.assign(w * h, 0);
+    stbtt_MakeGlyphBitmap(
+        &src.info,
+        &m_raster[margin * w + margin],
+        C_FCAST<int>(g.width),
+        C_FCAST<int>(g.height),
+        C_FCAST<int>(w),
+        src.scale,
+        src.scale,
+        g.glyph_index);
+
+    if(m_sdf_spread)
+    {
+        m_sdf.resize(m_raster.size());
+        GenerateSdf(
+            m_raster.data(), w, h, m_sdf_spread, m_sdf.data(), m_scratch);
+        m_raster.swap(m_sdf);
+    }
+
+    /* The padding is cleared too, a reused shelf holds stale pixels */
+    for(u32 row = 0; row < cell_h; row++)
+    {
+        auto dst = &m_region[(y + row) * m_width + x];
+
+        std::fill(dst, dst + cell_w, 0);
+        if(row < h)
+            std::memcpy(dst, &m_raster[row * w], w);
+    }
+}
+
+Vector<GlyphCache::dirty_span> GlyphCache::collect_dirty()
+{
+    Vector<dirty_span> out;
+
+    if(m_full_dirty)
+    {
+        out.push_back({0, m_static_height, m_width, m_config.atlas_rows});
+        m_full_dirty = false;
+        m_dirty.clear();
+        return out;
+    }
+
+    for(szptr i = 0; i < m_dirty.size(); i++)
+    {
+        auto& dirty = m_dirty[i];
+
+        if(dirty.first >= dirty.second)
+            continue;
+
+        auto const& shelf = m_packer.shelves[i];
+
+        out.push_back({dirty.first,
+                       m_static_height + shelf.y + reserved_rows,
+                       std::min(dirty.second, m_width) - dirty.first,
+                       shelf.height});
+
+        dirty = {~0u, 0};
+    }
+
+    return out;
+}
+
+void GlyphCache::stage(dirty_span const& span)
+{
+    const u32 region_y = span.y - m_static_height;
+
+    m_upload.resize(span.width * span.height);
+
+    for(u32 row = 0; row < span.height; row++)
+        std::memcpy(
+            &m_upload[row * span.width],
+            &m_region[(region_y + row) * m_width + span.x],
+            span.width);
+}
+
+void GlyphCache::clear_residency()
+{
+    for(auto& g : m_glyphs)
+        g.resident = false;
+
+    m_packer.reset(
+        m_width, std::max(m_config.atlas_rows, reserved_rows) - reserved_rows);
+    m_region.assign(m_width * m_config.atlas_rows, 0);
+    m_dirty.clear();
+    m_full_dirty = true;
+}
+
+void GlyphCache::clear()
+{
+    m_sources.clear();
+    m_glyphs.clear();
+    m_region.clear();
+    m_dirty.clear();
+    m_packer.reset(0, 0);
+    m_atlas = nullptr;
+    m_stats = {};
+}
+
+GlyphCacheStats const& GlyphCache::stats()
+{
+    m_stats.resident_glyphs = 0;
+    for(auto const& g : m_glyphs)
+        if(g.resident)
+            m_stats.resident_glyphs++;
+
+    m_stats.shelves_evicted = m_packer.evictions;
+    m_stats.region_bytes    = m_region.size();
+
+    return m_stats;
+}
+
+} // namespace detail
+} // namespace CImGui
+} // namespace Coffee
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <coffee/core/stl_types.h>
+#include <coffee/core/types/chunk.h>
+#include <coffee/imgui/imgui_binding.h>
+
+#include "imgui_sdf.h"
+
+#include <imgui.h>
+
+namespace Coffee {
+namespace CImGui {
+namespace detail {
+
+/* Shelf allocator for the dynamic glyph region.
+ * Shelves are horizontal strips of one height class. When the region is
+ *  full, the least recently used shelf which fits is emptied and reused.
+ *  Shelves used in the current frame are never evicted.
+ */
+struct ShelfPacker
+{
+    struct shelf
+    {
+        u32         y;
+        u32         height;
+        u32         cursor;
+        u64         last_used;
+        Vector<u32> glyphs;
+    };
+
+    static constexpr u32 height_granularity = 4;
+
+    void reset(u32 width, u32 height)
+    {
+        m_width  = width;
+        m_height = height;
+        m_top    = 0;
+        shelves.clear();
+    }
+
+    /* On success, glyphs of an evicted shelf are appended to `evicted` */
+    bool allocate(
+        u32          width,
+        u32          height,
+        u64          frame,
+        u32&         shelf_idx,
+        u32&         x,
+        Vector<u32>& evicted)
+    {
+        if(width > m_width)
+            return false;
+
+        const auto shelf_height = round_height(height);
+
+        shelf* best = nullptr;
+        for(auto& s : shelves)
+        {
+            if(s.height < shelf_height || s.height > shelf_height * 3 / 2 ||
+               s.cursor + width > m_width)
+                continue;
+            if(!best || s.height < best->height)
+                best = &s;
+        }
+
+        if(!best && m_top + shelf_height <= m_height)
+        {
+            shelves.push_back({m_top, shelf_height, 0, frame, {}});
+            m_top += shelf_height;
+            best = &shelves.back();
+        }
+
+        if(!best)
+        {
+            for(auto& s : shelves)
+            {
+                if(s.height < shelf_height || s.last_used >= frame)
+                    continue;
+                if(!best || s.last_used < best->last_used)
+                    best = &s;
+            }
+
+            if(!best)
+                return false;
+
+            evicted.insert(
+                evicted.end(), best->glyphs.begin(), best->glyphs.end());
+            best->glyphs.clear();
+            best->cursor = 0;
+            evictions++;
+        }
+
+        shelf_idx = C_FCAST<u32>(best - shelves.data());
+        x         = best->cursor;
+
+        best->cursor += width;
+        best->last_used = frame;
+
+        return true;
+    }
+
+    Vector<shelf> shelves;
+    u32           evictions = 0;
+
+  private:
+    static u32 round_height(u32 height)
+    {
+        return ((height + height_granularity - 1) / height_granularity) *
+               height_granularity;
+    }
+
+    u32 m_width  = 0;
+    u32 m_height = 0;
+    u32 m_top    = 0;
+};
+
+/* Glyphs rasterised on first use, for large ranges (eg. CJK) of which only
+ *  a few hundred glyphs are ever displayed.
+ *
+ * Glyphs of the registered ranges are added to their ImFont with proper
+ *  metrics but placeholder UVs outside of [0, 1], which encode the glyph's
+ *  slot. After ImGui::Render(), resolve() finds these in the vertex data,
+ *  rasterises missing glyphs into a region below the static atlas, and
+ *  patches the UVs. Glyphs keep their placeholders in the ImFont, which
+ *  lets resolve() see every use and track recency.
+ *
+ * Only modified shelves of the region are uploaded, by flush().
+ */
+struct GlyphCache
+{
+    struct dirty_span
+    {
+        u32 x, y;
+        u32 width, height;
+    };
+
+    GlyphCache();
+    ~GlyphCache();
+
+    void configure(DynamicGlyphConfig const& config);
+
+    /* Store glyphs as distance fields, 0 for coverage */
+    void set_sdf_spread(u32 spread);
+
+    void add_source(
+        Bytes const&   font_data,
+        f32            size_pixels,
+        const ImWchar* ranges,
+        ImFont*        target);
+
+    bool empty() const;
+
+    /* Call with a built atlas. Adds the placeholder glyphs on first use,
+     *  and returns the texture height including the dynamic region. */
+    u32 install(ImFontAtlas& atlas);
+
+    /* Rewrites placeholder UVs to resident glyphs, in the vertices drawn
+     *  with `font_texture` */
+    void resolve(ImDrawData* draw_data, ImTextureID font_texture, u64 frame);
+
+    /* Calls `upload(span, pixels)` for every modified part of the region,
+     *  pixels are tightly packed Alpha8 rows */
+    template<typename Fun>
+    void flush(Fun&& upload)
+    {
+        for(auto const& span : collect_dirty())
+        {
+            stage(span);
+            upload(span, m_upload.data());
+            m_stats.upload_bytes += m_upload.size();
+        }
+    }
+
+    /* All glyphs become non-resident */
+    void clear_residency();
+
+    /* The whole region is uploaded on the next flush(), eg. after a device
+     *  reset. Resident glyphs stay resident. */
+    void invalidate_upload()
+    {
+        m_full_dirty = !m_region.empty();
+    }
+
+    /* Drops sources and placeholders, the atlas must be rebuilt */
+    void clear();
+
+    GlyphCacheStats const& stats();
+
+  private:
+    struct font_source;
+
+    struct glyph
+    {
+        u32 source;
+        i32 glyph_index;
+        u32 width, height;
+
+        bool resident;
+        u64  last_used;
+        u32  shelf;
+        f32  u0, v0, u1, v1;
+    };
+
+    bool make_resident(u32 id, u64 frame);
+    void rasterize(glyph& g, u32 x, u32 y, u32 cell_w, u32 cell_h);
+
+    Vector<dirty_span> collect_dirty();
+    void               stage(dirty_span const& span);
+
+    DynamicGlyphConfig         m_config;
+    Vector<UqPtr<font_source>> m_sources;
+    Vector<glyph>              m_glyphs;
+    ShelfPacker                m_packer;
+    Vector<Pair<u32, u32>>     m_dirty; /* Per shelf [min x, max x) */
+    bool                       m_full_dirty;
+    u32                        m_sdf_spread;
+
+    /* CPU copy of the dynamic region, in region space */
+    Vector<u8>  m_region;
+    Vector<u8>  m_raster;
+    Vector<u8>  m_upload;
+    Vector<u32> m_evicted;
+    Vector<u8>  m_sdf;
+    SdfScratch  m_scratch;
+
+    ImFontAtlas* m_atlas;
+    u32          m_width;
+    u32          m_static_height;
+    u32          m_total_height;
+    ImVec2       m_blank_uv;
+
+    GlyphCacheStats m_stats;
+};
+
+} // namespace detail
+} // namespace CImGui
+} // namespace Coffee
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <coffee/core/libc_types.h>
+
+#include <imgui.h>
+
+#include "imgui_primitive_stream.h"
+
+#include <cstring>
+
+namespace Coffee {
+namespace CImGui {
+namespace detail {
+
+/* Fast non-cryptographic hash, consuming 8 bytes per step.
+ * Only used for change detection, never persisted across builds unless
+ *  the caller mixes in a format version.
+ */
+struct ContentHash
+{
+    static constexpr u64 seed_value = 0x9E3779B97F4A7C15ULL;
+
+    ContentHash(u64 seed = seed_value) : m_state(seed)
+    {
+    }
+
+    ContentHash& bytes(const void* data, szptr size)
+    {
+        auto ptr = C_RCAST<const u8*>(data);
+
+        while(size >= sizeof(u64))
+        {
+            u64 word;
+            std::memcpy(&word, ptr, sizeof(word));
+            mix(word);
+            ptr += sizeof(u64);
+            size -= sizeof(u64);
+        }
+
+        if(size)
+        {
+            u64 word = 0;
+            std::memcpy(&word, ptr, size);
+            mix(word ^ (C_CAST<u64>(size) << 56));
+        }
+
+        return *this;
+    }
+
+    template<typename T>
+    ContentHash& value(T const& v)
+    {
+        return bytes(&v, sizeof(T));
+    }
+
+    u64 digest() const
+    {
+        u64 h = m_state;
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+  private:
+    void mix(u64 word)
+    {
+        word *= 0x87C37B91114253D5ULL;
+        word = (word << 31) | (word >> 33);
+        word *= 0x4CF5AD432745937FULL;
+
+        m_state ^= word;
+        m_state = ((m_state << 27) | (m_state >> 37)) * 5 + 0x52DCE729;
+    }
+
+    u64 m_state;
+};
+
+/* Identifies a list across frames by its window, or by its position for
+ *  lists without one */
+inline u64 DrawListKey(ImDrawList const* list, int index)
+{
+    ContentHash key;
+    if(list->_OwnerName)
+        key.bytes(list->_OwnerName, std::strlen(list->_OwnerName));
+    else
+        key.value(index);
+    return key.digest();
+}
+
+/* Hashes geometry and commands of a single list.
+ * Returns false if the list contains user callbacks, whose side-effects
+ *  cannot be cached. Markers of `primitives` are hashed by their instance
+ *  records instead. */
+inline bool HashDrawList(
+    ImDrawList const*      list,
+    ContentHash&           hash,
+    PrimitiveStream const* primitives = nullptr)
+{
+    bool cacheable = true;
+
+    hash.bytes(
+        list->VtxBuffer.Data,
+        C_FCAST<szptr>(list->VtxBuffer.Size) * sizeof(ImDrawVert));
+    hash.bytes(
+        list->IdxBuffer.Data,
+        C_FCAST<szptr>(list->IdxBuffer.Size) * sizeof(ImDrawIdx));
+
+    for(auto const& cmd : list->CmdBuffer)
+    {
+        hash.value(cmd.ElemCount)
+            .value(cmd.ClipRect)
+            .value(cmd.TextureId);
+
+        if(!cmd.UserCallback)
+            continue;
+
+        if(auto run = primitives ? primitives->find(cmd) : nullptr)
+            hash.bytes(
+                primitives->instances.data() + run->first,
+                run->count * sizeof(PrimitiveInstance));
+        else
+            cacheable = false;
+    }
+
+    return cacheable;
+}
+
+} // namespace detail
+} // namespace CImGui
+} // namespace Coffee
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <coffee/core/stl_types.h>
+#include <coffee/imgui/imgui_binding.h>
+#include <coffee/interfaces/cgraphics_util.h>
+
+#include "imgui_hash.h"
+#include "imgui_shader_view.h"
+
+namespace Coffee {
+namespace CImGui {
+namespace detail {
+
+/* Offscreen layers for RenderFlag_LayerCache, one per ImDrawList owner.
+ * A layer covers the framebuffer-space bounds of its list's clip rects,
+ *  and is only re-rendered when the list's content hash changes. Unchanged
+ *  layers are composited with a single quad.
+ *
+ * Layers are cleared to transparent black and drawn with
+ *  BlendMode::Layer, which leaves them premultiplied. They are composited
+ *  with BlendMode::Premultiplied.
+ */
+template<typename GFX>
+struct LayerCache
+{
+    struct layer
+    {
+        layer() :
+            texture(PixFmt::RGBA8), tex_mode(TexMode_Layer),
+            hash(0), last_frame(0), origin_x(0), origin_y(0), width(0),
+            height(0), valid(false), redraw(false)
+        {
+        }
+
+        ~layer()
+        {
+            framebuffer.dealloc();
+            sampler.dealloc();
+            texture.dealloc();
+        }
+
+        typename GFX::FB_T  framebuffer;
+        typename GFX::S_2D  texture;
+        typename GFX::SM_2D sampler;
+
+        /* Rebuilt along with the surface */
+        UqPtr<RHI::shader_param_view<GFX>> view;
+        i32                                tex_mode;
+
+        u64 hash;
+        u64 last_frame;
+
+        /* Framebuffer-space placement */
+        i32 origin_x, origin_y;
+        u32 width, height;
+
+        bool valid;
+        bool redraw;
+    };
+
+    /* Layer sizes are rounded up to avoid re-allocating on every resize */
+    static constexpr u32 size_granularity = 64;
+
+    /* Layers unused for this many frames are released */
+    static constexpr u64 evict_frames = 120;
+
+    LayerCache(ShPtr<typename GFX::PIP> const& pipeline, Matf4& projection) :
+        m_pipeline(pipeline), m_projection(projection)
+    {
+    }
+
+    static u64 key_of(ImDrawList const* list, int index)
+    {
+        return DrawListKey(list, index);
+    }
+
+    /* Returns the layer for `key`, (re)allocating its surface when the
+     *  bounds outgrew it. `dirty` is set if its content must be redrawn. */
+    layer& acquire(
+        u64 key, u64 frame, ImVec4 const& bounds, u64 hash, bool& dirty)
+    {
+        auto it = m_layers.find(key);
+
+        if(it == m_layers.end())
+            it = m_layers.insert({key, MkUq<layer>()}).first;
+
+        auto& l = *it->second;
+
+        const auto x = C_CAST<i32>(bounds.x);
+        const auto y = C_CAST<i32>(bounds.y);
+        const auto w = round_size(bounds.z - bounds.x);
+        const auto h = round_size(bounds.w - bounds.y);
+
+        dirty = !l.valid || l.hash != hash || l.origin_x != x ||
+                l.origin_y != y;
+
+        if(!l.valid || w > l.width || h > l.height)
+        {
+            allocate(l, w, h);
+            m_textures[C_RCAST<ImTextureID>(&l)] = &l;
+            dirty                                = true;
+        }
+
+        l.origin_x   = x;
+        l.origin_y   = y;
+        l.hash       = hash;
+        l.last_frame = frame;
+        l.valid      = true;
+        l.redraw     = dirty;
+
+        return l;
+    }
+
+    /* The layer holding the whole UI for RenderFlag_SkipUnchanged. It is
+     *  redrawn by every changed frame, and never evicted. */
+    layer& frame_target(u32 width, u32 height)
+    {
+        if(!m_frame)
+            m_frame = MkUq<layer>();
+
+        auto& l = *m_frame;
+
+        if(!l.valid || width > l.width || height > l.height)
+        {
+            allocate(l, round_size(width), round_size(height));
+            m_textures[C_RCAST<ImTextureID>(&l)] = &l;
+            l.valid                              = true;
+        }
+
+        return l;
+    }
+
+    /* Looks up a layer by the texture ID used for its composite quad */
+    layer* find(ImTextureID texture)
+    {
+        auto it = m_textures.find(texture);
+        return it != m_textures.end() ? it->second : nullptr;
+    }
+
+    u32 evict(u64 frame)
+    {
+        u32 evicted = 0;
+
+        for(auto it = m_layers.begin(); it != m_layers.end();)
+        {
+            if(it->second->last_frame + evict_frames < frame)
+            {
+                m_textures.erase(C_RCAST<ImTextureID>(it->second.get()));
+                it = m_layers.erase(it);
+                evicted++;
+            } else
+                ++it;
+        }
+
+        return evicted;
+    }
+
+    szptr memory_usage() const
+    {
+        szptr out = 0;
+        for(auto const& l : m_layers)
+            out += l.second->width * l.second->height * 4;
+        if(m_frame)
+            out += m_frame->width * m_frame->height * 4;
+        return out;
+    }
+
+    void clear()
+    {
+        m_textures.clear();
+        m_layers.clear();
+        m_frame.reset();
+    }
+
+  private:
+    static u32 round_size(f32 size)
+    {
+        auto s = C_CAST<u32>(std::max(size, 1.f));
+        return ((s + size_granularity - 1) / size_granularity) *
+               size_granularity;
+    }
+
+    void allocate(layer& l, u32 width, u32 height)
+    {
+        width  = std::max(width, l.width);
+        height = std::max(height, l.height);
+
+        if(l.width)
+        {
+            l.framebuffer.dealloc();
+            l.sampler.dealloc();
+            l.texture.dealloc();
+        }
+
+        l.texture.allocate(size_2d<u32>{width, height}, PixCmp::RGBA);
+
+        l.framebuffer.alloc();
+        l.framebuffer.attachSurface(l.texture, 0);
+
+        l.sampler.alloc();
+        l.sampler.attach(&l.texture);
+        l.sampler.setFiltering(Filtering::Nearest, Filtering::Nearest);
+
+        l.view = MkUq<RHI::shader_param_view<GFX>>(m_pipeline);
+        BuildShaderView(*l.view, l.sampler, m_projection, l.tex_mode);
+
+        l.width  = width;
+        l.height = height;
+    }
+
+    ShPtr<typename GFX::PIP> m_pipeline;
+    Matf4&                   m_projection;
+
+    Map<u64, UqPtr<layer>>   m_layers;
+    Map<ImTextureID, layer*> m_textures;
+    UqPtr<layer>             m_frame;
+};
+
+} // namespace detail
+} // namespace CImGui
+} // namespace Coffee
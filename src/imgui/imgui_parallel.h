@@ -0,0 +1,54 @@
+#pragma once
+
+#include <coffee/core/libc_types.h>
+#include <coffee/core/stl_types.h>
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <thread>
+
+namespace Coffee {
+namespace CImGui {
+namespace detail {
+
+/* One worker per hardware thread */
+inline u32 DefaultWorkers()
+{
+    return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+/* Runs fun(0..count-1) on up to `workers` threads, in no particular order.
+ * The calling thread is one of the workers. */
+template<typename Fun>
+inline void ParallelFor(u32 count, u32 workers, Fun&& fun)
+{
+    workers = std::min(workers, count);
+
+    if(workers <= 1)
+    {
+        for(u32 i = 0; i < count; i++)
+            fun(i);
+        return;
+    }
+
+    std::atomic<u32> next(0);
+
+    auto worker = [&]() {
+        for(u32 i = next++; i < count; i = next++)
+            fun(i);
+    };
+
+    Vector<std::future<void>> tasks;
+    for(u32 i = 1; i < workers; i++)
+        tasks.push_back(std::async(std::launch::async, worker));
+
+    worker();
+
+    for(auto& task : tasks)
+        task.get();
+}
+
+} // namespace detail
+} // namespace CImGui
+} // namespace Coffee
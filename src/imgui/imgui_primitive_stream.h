@@ -0,0 +1,121 @@
+#pragma once
+
+#include <coffee/core/stl_types.h>
+
+#include <imgui.h>
+
+namespace Coffee {
+namespace CImGui {
+namespace detail {
+
+/* Instance record of RenderFlag_Primitives, expanded into a quad by the
+ *  primitive vertex shader. Circles are rects rounded by half their size. */
+struct PrimitiveInstance
+{
+    /* Min and max corners, in ImGui coordinates */
+    ImVec4 rect;
+    f32    rounding;
+    /* Outline width, 0 for filled shapes */
+    f32   thickness;
+    ImU32 col;
+};
+
+/* Marks the place of a run of instances in an ImDrawList. The GPU renderer
+ *  draws the run instead of calling it, other renderers skip it. */
+inline void PrimitiveMarker(const ImDrawList*, const ImDrawCmd*)
+{
+}
+
+/* Instance records of the current frame, referenced by marker commands.
+ * Consecutive primitives of a list under the same clip rect share one
+ *  marker, and are drawn by one instanced call.
+ */
+struct PrimitiveStream
+{
+    struct run
+    {
+        u32 first;
+        u32 count;
+    };
+
+    void clear()
+    {
+        instances.clear();
+        runs.clear();
+    }
+
+    void add(ImDrawList* list, PrimitiveInstance const& instance)
+    {
+        if(!extends(list))
+        {
+            runs.push_back({C_FCAST<u32>(instances.size()), 0});
+            list->AddCallback(
+                PrimitiveMarker,
+                C_RCAST<void*>(C_FCAST<uintptr_t>(runs.size() - 1)));
+        }
+
+        instances.push_back(instance);
+        runs.back().count++;
+    }
+
+    /* Appends a run of `count` recorded instances without a list, returns
+     *  the UserCallbackData of its marker */
+    void* add_run(PrimitiveInstance const* records, u32 count)
+    {
+        runs.push_back({C_FCAST<u32>(instances.size()), count});
+        instances.insert(instances.end(), records, records + count);
+
+        return C_RCAST<void*>(C_FCAST<uintptr_t>(runs.size() - 1));
+    }
+
+    /* The run of a marker command, null for other callbacks */
+    run const* find(ImDrawCallback callback, void* data) const
+    {
+        if(callback != PrimitiveMarker)
+            return nullptr;
+
+        const auto index = C_RCAST<uintptr_t>(data);
+
+        return index < runs.size() ? &runs[index] : nullptr;
+    }
+
+    run const* find(ImDrawCmd const& cmd) const
+    {
+        return find(cmd.UserCallback, cmd.UserCallbackData);
+    }
+
+    Vector<PrimitiveInstance> instances;
+    Vector<run>               runs;
+
+  private:
+    /* Whether `list` ends with the marker of the newest run, followed by the
+     *  empty command AddCallback() leaves behind. Pushing a clip rect or a
+     *  texture changes that command, and starts a new run. */
+    bool extends(ImDrawList const* list) const
+    {
+        auto const& cmds = list->CmdBuffer;
+
+        if(runs.empty() || cmds.Size < 2)
+            return false;
+
+        auto const& marker = cmds[cmds.Size - 2];
+        auto const& tail   = cmds[cmds.Size - 1];
+
+        return marker.UserCallback == PrimitiveMarker &&
+               C_RCAST<uintptr_t>(marker.UserCallbackData) ==
+                   runs.size() - 1 &&
+               tail.ElemCount == 0 && !tail.UserCallback &&
+               tail.TextureId == marker.TextureId &&
+               tail.ClipRect.x == marker.ClipRect.x &&
+               tail.ClipRect.y == marker.ClipRect.y &&
+               tail.ClipRect.z == marker.ClipRect.z &&
+               tail.ClipRect.w == marker.ClipRect.w;
+    }
+};
+
+/* Records of the frame being built, which NewFrame() clears */
+PrimitiveStream& FramePrimitives();
+
+} // namespace detail
+} // namespace CImGui
+} // namespace Coffee
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <coffee/core/stl_types.h>
+#include <coffee/imgui/imgui_binding.h>
+
+#include "imgui_hash.h"
+
+#include <cstring>
+#include <initializer_list>
+
+namespace Coffee {
+namespace CImGui {
+namespace detail {
+
+/* Process-wide store of linked ImGui pipelines, keyed by a hash of their
+ *  shader sources.
+ * Pipelines are shared between every ImGuiData created on the same device,
+ *  so Shutdown() followed by Init() does not compile again. The cache owns
+ *  the pipelines: it frees them when the device goes away, and otherwise
+ *  keeps them until clear().
+ * Only keys and ShPtrs are handled here, the GFX API is only touched by
+ *  dealloc(), which the NullAPI provides as well.
+ */
+template<typename GFX>
+struct ProgramCache
+{
+    using pipeline_t = typename GFX::PIP;
+
+    /* `sources` should include the version and define prologue */
+    static u64 Key(std::initializer_list<cstring> sources)
+    {
+        ContentHash hash;
+
+        for(auto source : sources)
+        {
+            const auto len = std::strlen(source);
+            hash.value(C_CAST<u64>(len)).bytes(source, len);
+        }
+
+        return hash.digest();
+    }
+
+    /* Returns the pipeline for `key`, which is new and unlinked on a miss */
+    ShPtr<pipeline_t> acquire(u64 key)
+    {
+        auto& e = m_entries[key];
+
+        if(!e.pipeline)
+            e.pipeline = MkShared<pipeline_t>();
+
+        return e.pipeline;
+    }
+
+    /* Whether the pipeline of `key` may be used without compiling. Counts
+     *  a hit or a miss. */
+    bool lookup(u64 key)
+    {
+        auto it = m_entries.find(key);
+
+        if(it == m_entries.end() || !it->second.linked)
+        {
+            m_stats.misses++;
+            return false;
+        }
+
+        m_stats.hits++;
+        m_stats.time_saved += it->second.compile_time;
+        return true;
+    }
+
+    /* Call after the pipeline of `key` linked successfully */
+    void store(u64 key, Chrono::microseconds compile_time)
+    {
+        auto& e = m_entries[key];
+
+        e.linked       = true;
+        e.compile_time = compile_time;
+
+        m_stats.compile_time += compile_time;
+    }
+
+    /* The device went away, every pipeline has to be compiled again */
+    void invalidate()
+    {
+        typename GFX::ERROR ec;
+
+        for(auto& e : m_entries)
+        {
+            if(e.second.linked)
+                e.second.pipeline->dealloc(ec);
+            e.second.linked = false;
+        }
+    }
+
+    void clear()
+    {
+        invalidate();
+        m_entries.clear();
+    }
+
+    ProgramCacheStats const& stats() const
+    {
+        return m_stats;
+    }
+
+  private:
+    struct entry
+    {
+        ShPtr<pipeline_t>    pipeline;
+        Chrono::microseconds compile_time{};
+        bool                 linked = false;
+    };
+
+    Map<u64, entry>   m_entries;
+    ProgramCacheStats m_stats = {};
+};
+
+} // namespace detail
+} // namespace CImGui
+} // namespace Coffee
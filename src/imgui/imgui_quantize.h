@@ -0,0 +1,189 @@
+#pragma once
+
+#include <coffee/core/libc_types.h>
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define COFFEE_IMGUI_QUANTIZE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace Coffee {
+namespace CImGui {
+namespace detail {
+
+/* Vertex of RenderFlag_QuantizedVertices, 16 bytes instead of the 20 of
+ *  an ImDrawVert */
+struct QuantVertex
+{
+    /* Kept as is, anti-aliased fringes, rounded corners and oversampled
+     *  glyphs put ImGui's positions anywhere between pixels */
+    ImVec2 pos;
+    /* Fixed point, in steps of 1 / quant_uv_steps */
+    u16   uv[2];
+    ImU32 col;
+};
+
+/* UVs step by 2^-15, which hits every texel edge of a texture up to 32768
+ *  wide, and every texel centre up to 16384, as ImGui's font atlas UVs and
+ *  white pixel are. A power of two, so the GPU's conversion back is
+ *  exact. */
+static constexpr f32 quant_uv_steps = 32768.f;
+
+/* Accepted range after scaling */
+static constexpr f32 quant_uv_max = 65535.f;
+
+/* Most frames after a fallback fall back as well, see QuantizeBackoff */
+static constexpr u32 quant_backoff_max = 256;
+
+/* Positions and UVs are read as one vector of four floats */
+static_assert(
+    offsetof(ImDrawVert, uv) == offsetof(ImDrawVert, pos) + sizeof(ImVec2),
+    "ImDrawVert layout is not pos, uv, col");
+
+/* Scales `v` to its fixed point range. False if it is out of range, NaN
+ *  or between two steps, vertices are only quantised when they read back
+ *  as they were. */
+inline bool QuantizeValue(f32 v, f32 steps, f32 lo, f32 hi, i32& out)
+{
+    const f32 scaled = v * steps;
+
+    if(!(scaled >= lo && scaled <= hi) || scaled != std::floor(scaled))
+        return false;
+
+    out = C_CAST<i32>(scaled);
+    return true;
+}
+
+inline bool QuantizeVertex(ImDrawVert const& in, QuantVertex& out)
+{
+    i32 v[2];
+
+    if(!QuantizeValue(in.uv.x, quant_uv_steps, 0.f, quant_uv_max, v[0]) ||
+       !QuantizeValue(in.uv.y, quant_uv_steps, 0.f, quant_uv_max, v[1]))
+        return false;
+
+    out.pos   = in.pos;
+    out.uv[0] = C_CAST<u16>(v[0]);
+    out.uv[1] = C_CAST<u16>(v[1]);
+    out.col   = in.col;
+    return true;
+}
+
+/* Converts `count` vertices. False if any of them does not fit exactly,
+ *  `out` is then incomplete and the frame has to be sent as ImDrawVert. */
+inline bool QuantizeVertices(
+    const ImDrawVert* in, szptr count, QuantVertex* out)
+{
+    szptr i = 0;
+
+#if defined(COFFEE_IMGUI_QUANTIZE_SSE2)
+    const __m128 steps = _mm_set1_ps(quant_uv_steps);
+    const __m128 lo    = _mm_setzero_ps();
+    const __m128 hi    = _mm_set1_ps(quant_uv_max);
+
+    /* UVs are biased into the signed range for _mm_packs_epi32(), and
+     *  flipped back after */
+    const __m128i bias = _mm_set1_epi32(32768);
+    const __m128i flip = _mm_set1_epi16(C_CAST<short>(0x8000));
+
+    __m128 invalid = _mm_setzero_ps();
+
+    for(; i + 2 <= count; i += 2)
+    {
+        const __m128 a = _mm_loadu_ps(&in[i].pos.x);
+        const __m128 b = _mm_loadu_ps(&in[i + 1].pos.x);
+
+        /* The UVs of both vertices */
+        const __m128 uv =
+            _mm_mul_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 2, 3, 2)), steps);
+
+        const __m128i iuv = _mm_cvtps_epi32(uv);
+
+        /* Unordered compares, so NaN is invalid too. Values which were
+         *  rounded do not convert back. */
+        invalid = _mm_or_ps(invalid, _mm_cmpnge_ps(uv, lo));
+        invalid = _mm_or_ps(invalid, _mm_cmpnle_ps(uv, hi));
+        invalid = _mm_or_ps(invalid, _mm_cmpneq_ps(_mm_cvtepi32_ps(iuv), uv));
+
+        const __m128i packed = _mm_xor_si128(
+            _mm_packs_epi32(_mm_sub_epi32(iuv, bias), _mm_setzero_si128()),
+            flip);
+
+        _mm_storel_pi(C_RCAST<__m64*>(&out[i].pos), a);
+        _mm_storel_pi(C_RCAST<__m64*>(&out[i + 1].pos), b);
+
+        const i32 uv_a = _mm_cvtsi128_si32(packed);
+        const i32 uv_b = _mm_cvtsi128_si32(_mm_srli_si128(packed, 4));
+        std::memcpy(out[i].uv, &uv_a, sizeof(uv_a));
+        std::memcpy(out[i + 1].uv, &uv_b, sizeof(uv_b));
+
+        out[i].col     = in[i].col;
+        out[i + 1].col = in[i + 1].col;
+    }
+
+    if(_mm_movemask_ps(invalid))
+        return false;
+#endif
+
+    for(; i < count; i++)
+        if(!QuantizeVertex(in[i], out[i]))
+            return false;
+
+    return true;
+}
+
+/* What the vertex shader sees of a quantised vertex, equal to the
+ *  ImDrawVert it was made from */
+inline ImDrawVert DequantizeVertex(QuantVertex const& in)
+{
+    ImDrawVert out;
+
+    out.pos = in.pos;
+    out.uv  = ImVec2(in.uv[0] / quant_uv_steps, in.uv[1] / quant_uv_steps);
+    out.col = in.col;
+
+    return out;
+}
+
+/* Decides which frames are tried. Each fallback doubles the number of
+ *  frames which are then sent as ImDrawVert without converting them, up
+ *  to quant_backoff_max, a quantised frame resets it. */
+struct QuantizeBackoff
+{
+    /* Whether to convert this frame */
+    bool attempt()
+    {
+        if(!skip)
+            return true;
+
+        skip--;
+        return false;
+    }
+
+    /* Result of a frame attempt() allowed */
+    void update(bool quantized)
+    {
+        if(quantized)
+            interval = 0;
+        else
+            interval = interval ? std::min(interval * 2, quant_backoff_max)
+                                : 1;
+
+        skip = interval;
+    }
+
+    u32 interval = 0;
+    u32 skip     = 0;
+};
+
+} // namespace detail
+} // namespace CImGui
+} // namespace Coffee
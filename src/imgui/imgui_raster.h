@@ -0,0 +1,98 @@
+#pragma once
+
+#include <coffee/core/libc_types.h>
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define COFFEE_IMGUI_RASTER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace Coffee {
+namespace CImGui {
+namespace detail {
+
+/* glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA) for one 8-bit channel,
+ *  rounded the same way as the SSE2 path */
+inline u8 BlendChannel(u32 src, u32 dst, u32 alpha)
+{
+    const u32 v = src * alpha + dst * (255 - alpha) + 128;
+    return C_CAST<u8>((v + (v >> 8)) >> 8);
+}
+
+/* Blends one RGBA8 pixel over `dst`, every channel including alpha is
+ *  blended, as the GL path does */
+inline void BlendPixel(u8* dst, const u8* src)
+{
+    const u32 alpha = src[3];
+
+    if(alpha == 0)
+        return;
+
+    if(alpha == 255)
+    {
+        std::memcpy(dst, src, 4);
+        return;
+    }
+
+    for(u32 c = 0; c < 4; c++)
+        dst[c] = BlendChannel(src[c], dst[c], alpha);
+}
+
+/* Blends `count` pixels of the constant colour `src` over `dst` */
+inline void BlendSpanSolid(u8* dst, u32 count, const u8* src)
+{
+    const u32 alpha = src[3];
+
+    if(alpha == 0)
+        return;
+
+    u32 color;
+    std::memcpy(&color, src, sizeof(color));
+
+    if(alpha == 255)
+    {
+        for(u32 i = 0; i < count; i++)
+            std::memcpy(dst + i * 4, &color, sizeof(color));
+        return;
+    }
+
+    u32 i = 0;
+
+#if defined(COFFEE_IMGUI_RASTER_SSE2)
+    const __m128i zero    = _mm_setzero_si128();
+    const __m128i inverse = _mm_set1_epi16(C_CAST<short>(255 - alpha));
+
+    /* src * alpha + 128 for two pixels, in 16-bit lanes */
+    __m128i source = _mm_set1_epi32(C_CAST<int>(color));
+    source         = _mm_unpacklo_epi8(source, zero);
+    source         = _mm_add_epi16(
+        _mm_mullo_epi16(source, _mm_set1_epi16(C_CAST<short>(alpha))),
+        _mm_set1_epi16(128));
+
+    for(; i + 4 <= count; i += 4)
+    {
+        auto ptr = C_RCAST<__m128i*>(dst + i * 4);
+
+        __m128i pixels = _mm_loadu_si128(ptr);
+        __m128i lo     = _mm_unpacklo_epi8(pixels, zero);
+        __m128i hi     = _mm_unpackhi_epi8(pixels, zero);
+
+        lo = _mm_add_epi16(_mm_mullo_epi16(lo, inverse), source);
+        hi = _mm_add_epi16(_mm_mullo_epi16(hi, inverse), source);
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+
+        _mm_storeu_si128(ptr, _mm_packus_epi16(lo, hi));
+    }
+#endif
+
+    for(; i < count; i++)
+        BlendPixel(dst + i * 4, src);
+}
+
+} // namespace detail
+} // namespace CImGui
+} // namespace Coffee
@@ -0,0 +1,296 @@
+#pragma once
+
+#include <coffee/core/stl_types.h>
+#include <coffee/core/types/chunk.h>
+#include <peripherals/libc/memory_ops.h>
+
+#include <imgui.h>
+
+#include "imgui_hash.h"
+
+#include <deque>
+#include <iterator>
+
+namespace Coffee {
+namespace CImGui {
+namespace detail {
+
+/* First-fit allocator of element slots in a retained buffer. Released
+ *  ranges are only reused once the frame which released them is
+ *  `frames_in_flight` frames old, as with StreamRingAllocator. */
+struct RangeAllocator
+{
+    void begin_frame(u64 frame, u32 frames_in_flight)
+    {
+        while(!m_pending.empty() &&
+              m_pending.front().frame + frames_in_flight <= frame)
+        {
+            insert_free(m_pending.front().offset, m_pending.front().size);
+            m_pending.pop_front();
+        }
+    }
+
+    bool allocate(u32 size, u32& offset)
+    {
+        offset = 0;
+
+        if(size == 0)
+            return true;
+
+        for(auto it = m_free.begin(); it != m_free.end(); ++it)
+        {
+            if(it->second < size)
+                continue;
+
+            const u32 remaining = it->second - size;
+
+            offset = it->first;
+            m_free.erase(it);
+
+            if(remaining)
+                m_free[offset + size] = remaining;
+
+            m_used += size;
+            return true;
+        }
+
+        return false;
+    }
+
+    void release(u64 frame, u32 offset, u32 size)
+    {
+        if(size == 0)
+            return;
+
+        m_pending.push_back({frame, offset, size});
+        m_used -= size;
+    }
+
+    /* Forgets all ranges, for storage re-allocated with `capacity` slots */
+    void reset(u32 capacity)
+    {
+        m_free.clear();
+        m_pending.clear();
+        m_capacity = capacity;
+        m_used     = 0;
+
+        if(capacity)
+            m_free[0] = capacity;
+    }
+
+    u32 capacity() const
+    {
+        return m_capacity;
+    }
+
+    u32 used() const
+    {
+        return m_used;
+    }
+
+  private:
+    struct pending
+    {
+        u64 frame;
+        u32 offset;
+        u32 size;
+    };
+
+    /* Merges with the neighbouring free ranges */
+    void insert_free(u32 offset, u32 size)
+    {
+        auto next = m_free.lower_bound(offset);
+
+        if(next != m_free.end() && offset + size == next->first)
+        {
+            size += next->second;
+            next = m_free.erase(next);
+        }
+
+        if(next != m_free.begin())
+        {
+            auto prev = std::prev(next);
+
+            if(prev->first + prev->second == offset)
+            {
+                prev->second += size;
+                return;
+            }
+        }
+
+        m_free[offset] = size;
+    }
+
+    Map<u32, u32>       m_free;
+    std::deque<pending> m_pending;
+
+    u32 m_capacity = 0;
+    u32 m_used     = 0;
+};
+
+/* RenderFlag_RetainedLists, the vertex and element ranges of every
+ *  ImDrawList, keyed by its window. A list is only uploaded when its
+ *  geometry changed, otherwise it is drawn from the ranges it had.
+ * No GPU API is touched here, the binding uploads what assign() asks for.
+ */
+struct RetainedLists
+{
+    struct entry
+    {
+        u64 hash;
+        u64 last_frame;
+        u32 vertex_offset;
+        u32 vertex_count;
+        u32 element_offset;
+        u32 element_count;
+
+        /* Set by assign() when the ranges have to be written */
+        bool upload;
+    };
+
+    /* Assigns ranges to the lists of `draw_data`, in lists(), and releases
+     *  those of windows which were not drawn. False when the storage is
+     *  too small, reset() must then grow it before calling this again. */
+    bool assign(ImDrawData const* draw_data, u64 frame, u32 frames_in_flight)
+    {
+        m_vertices.begin_frame(frame, frames_in_flight);
+        m_elements.begin_frame(frame, frames_in_flight);
+        m_lists.clear();
+
+        for(int n = 0; n < draw_data->CmdListsCount; n++)
+        {
+            auto list = draw_data->CmdLists[n];
+            auto key  = DrawListKey(list, n);
+
+            /* Lists without a window of their own may share its key */
+            auto it = m_entries.find(key);
+            if(it != m_entries.end() && it->second.last_frame == frame)
+                key = ContentHash(key).value(n).digest();
+
+            const auto vertices = C_FCAST<u32>(list->VtxBuffer.Size);
+            const auto elements = C_FCAST<u32>(list->IdxBuffer.Size);
+
+            ContentHash hash;
+            hash.value(vertices).value(elements);
+            hash.bytes(list->VtxBuffer.Data, vertices * sizeof(ImDrawVert));
+            hash.bytes(list->IdxBuffer.Data, elements * sizeof(ImDrawIdx));
+
+            auto  inserted = m_entries.insert({key, entry()});
+            auto& e        = inserted.first->second;
+
+            e.upload     = inserted.second || e.hash != hash.digest();
+            e.last_frame = frame;
+
+            m_lists.push_back(&e);
+
+            if(!e.upload)
+                continue;
+
+            if(!inserted.second)
+            {
+                m_vertices.release(frame, e.vertex_offset, e.vertex_count);
+                m_elements.release(frame, e.element_offset, e.element_count);
+            }
+
+            e.hash          = hash.digest();
+            e.vertex_count  = vertices;
+            e.element_count = elements;
+
+            if(!m_vertices.allocate(vertices, e.vertex_offset) ||
+               !m_elements.allocate(elements, e.element_offset))
+                return false;
+        }
+
+        m_evicted = 0;
+
+        for(auto it = m_entries.begin(); it != m_entries.end();)
+        {
+            auto const& e = it->second;
+
+            if(e.last_frame != frame)
+            {
+                m_vertices.release(frame, e.vertex_offset, e.vertex_count);
+                m_elements.release(frame, e.element_offset, e.element_count);
+                it = m_entries.erase(it);
+                m_evicted++;
+            } else
+                ++it;
+        }
+
+        return true;
+    }
+
+    /* Drops every list, for storage re-allocated to the given slots */
+    void reset(u32 vertex_capacity, u32 element_capacity)
+    {
+        m_entries.clear();
+        m_lists.clear();
+        m_vertices.reset(vertex_capacity);
+        m_elements.reset(element_capacity);
+    }
+
+    /* Geometric growth, to twice the slots of a frame */
+    static u32 grow_capacity(u32 capacity, u32 needed)
+    {
+        if(capacity < min_capacity)
+            capacity = min_capacity;
+
+        while(capacity < needed * 2)
+            capacity *= 2;
+
+        return capacity;
+    }
+
+    /* Entries of the last assign(), in list order */
+    Vector<entry*> const& lists() const
+    {
+        return m_lists;
+    }
+
+    RangeAllocator const& vertices() const
+    {
+        return m_vertices;
+    }
+
+    RangeAllocator const& elements() const
+    {
+        return m_elements;
+    }
+
+    /* Windows released by the last assign() */
+    u32 evicted() const
+    {
+        return m_evicted;
+    }
+
+  private:
+    static constexpr u32 min_capacity = 4096;
+
+    Map<u64, entry> m_entries;
+    Vector<entry*>  m_lists;
+    RangeAllocator  m_vertices;
+    RangeAllocator  m_elements;
+    u32             m_evicted = 0;
+};
+
+/* Copies `size` bytes to `offset` of a retained GFX::BUF_A or GFX::BUF_E */
+template<typename Buffer>
+inline void WriteRange(Buffer& buffer, szptr offset, c_cptr data, szptr size)
+{
+    if(size == 0)
+        return;
+
+    auto target = buffer.map(offset, size);
+
+    if(!target)
+        return;
+
+    MemCpy(
+        Bytes::From(C_RCAST<const u8*>(data), size),
+        Bytes::From(C_RCAST<u8*>(target), size));
+    buffer.unmap();
+}
+
+} // namespace detail
+} // namespace CImGui
+} // namespace Coffee
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <coffee/core/libc_types.h>
+#include <coffee/core/stl_types.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace Coffee {
+namespace CImGui {
+namespace detail {
+
+/* Distance (in pixels) covered by the SDF on each side of an edge */
+static constexpr u32 sdf_spread = 4;
+
+/* Reused between transforms and bitmaps to avoid allocations */
+struct SdfScratch
+{
+    Vector<f32> d;
+    Vector<f32> z;
+    Vector<u32> v;
+    Vector<f32> f;
+
+    Vector<f32> to_inside;
+    Vector<f32> to_outside;
+};
+
+static constexpr f32 sdf_far = 1e20f;
+
+/* Squared 1D Euclidean distance transform (Felzenszwalb & Huttenlocher),
+ *  in place over `n` samples spaced `stride` apart */
+inline void DistanceTransform1D(
+    f32* data, u32 n, szptr stride, SdfScratch& scratch)
+{
+    if(!n)
+        return;
+
+    auto& f = scratch.f;
+    auto& d = scratch.d;
+    auto& v = scratch.v;
+    auto& z = scratch.z;
+
+    f.resize(n);
+    d.resize(n);
+    v.resize(n);
+    z.resize(n + 1);
+
+    for(u32 q = 0; q < n; q++)
+        f[q] = data[q * stride];
+
+    u32 k = 0;
+    v[0]  = 0;
+    z[0]  = -sdf_far;
+    z[1]  = sdf_far;
+
+    for(u32 q = 1; q < n; q++)
+    {
+        auto intersect = [&](u32 p) {
+            const f32 fq = f[q] + C_CAST<f32>(q) * q;
+            const f32 fp = f[p] + C_CAST<f32>(p) * p;
+            return (fq - fp) / (2.f * q - 2.f * p);
+        };
+
+        f32 s = intersect(v[k]);
+        while(s <= z[k])
+        {
+            k--;
+            s = intersect(v[k]);
+        }
+
+        k++;
+        v[k]     = q;
+        z[k]     = s;
+        z[k + 1] = sdf_far;
+    }
+
+    k = 0;
+    for(u32 q = 0; q < n; q++)
+    {
+        while(z[k + 1] < q)
+            k++;
+
+        const f32 dq = C_CAST<f32>(q) - v[k];
+        d[q]         = dq * dq + f[v[k]];
+    }
+
+    for(u32 q = 0; q < n; q++)
+        data[q * stride] = d[q];
+}
+
+inline void DistanceTransform2D(
+    f32* data, u32 width, u32 height, SdfScratch& scratch)
+{
+    for(u32 x = 0; x < width; x++)
+        DistanceTransform1D(data + x, height, width, scratch);
+    for(u32 y = 0; y < height; y++)
+        DistanceTransform1D(data + y * width, width, 1, scratch);
+}
+
+/* Converts an Alpha8 coverage bitmap into a signed distance field.
+ * 0.5 (128) is the edge, values grow towards the inside and reach 0 or 1
+ *  at `spread` pixels from it. Texels are classified by their coverage,
+ *  the edge is placed halfway between neighbouring texels, so it is only
+ *  accurate to about half a texel of the source bitmap.
+ */
+inline void GenerateSdf(
+    const u8*   coverage,
+    u32         width,
+    u32         height,
+    u32         spread,
+    u8*         out,
+    SdfScratch& scratch)
+{
+    const szptr count = C_CAST<szptr>(width) * height;
+
+    auto& to_inside  = scratch.to_inside;
+    auto& to_outside = scratch.to_outside;
+
+    to_inside.resize(count);
+    to_outside.resize(count);
+
+    for(szptr i = 0; i < count; i++)
+    {
+        const bool inside = coverage[i] >= 128;
+        to_inside[i]      = inside ? 0.f : sdf_far;
+        to_outside[i]     = inside ? sdf_far : 0.f;
+    }
+
+    DistanceTransform2D(to_inside.data(), width, height, scratch);
+    DistanceTransform2D(to_outside.data(), width, height, scratch);
+
+    const f32 scale = 1.f / (2.f * spread);
+
+    for(szptr i = 0; i < count; i++)
+    {
+        /* Positive inside */
+        const f32 dist = coverage[i] >= 128
+                             ? std::sqrt(to_outside[i]) - 0.5f
+                             : 0.5f - std::sqrt(to_inside[i]);
+        const f32 value = std::min(std::max(0.5f + dist * scale, 0.f), 1.f);
+
+        out[i] = C_CAST<u8>(value * 255.f + 0.5f);
+    }
+}
+
+inline void GenerateSdf(
+    const u8* coverage, u32 width, u32 height, u32 spread, u8* out)
+{
+    SdfScratch scratch;
+    GenerateSdf(coverage, width, height, spread, out, scratch);
+}
+
+} // namespace detail
+} // namespace CImGui
+} // namespace Coffee
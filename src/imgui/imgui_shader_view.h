@@ -0,0 +1,49 @@
+#pragma once
+
+#include <coffee/core/types/chunk.h>
+#include <coffee/interfaces/cgraphics_util.h>
+
+namespace Coffee {
+namespace CImGui {
+namespace detail {
+
+/* Selects how the fragment shader interprets the bound texture */
+enum TextureMode : i32
+{
+    TexMode_RGBA = 0,
+    /* Single-channel coverage, eg. an R8 font atlas */
+    TexMode_Alpha = 1,
+    /* Premultiplied offscreen layer, sampled as RGBA. See
+     *  imgui_layer_cache.h */
+    TexMode_Layer = 2,
+    /* Single-channel signed distance field, see imgui_sdf.h */
+    TexMode_Sdf = 3,
+};
+
+/* Binds the ImGui shader's uniforms for one texture. `projection` and
+ *  `tex_mode` are referenced, not copied, and must outlive the view. */
+template<typename GFX>
+inline void BuildShaderView(
+    RHI::shader_param_view<GFX>& view,
+    typename GFX::SM_2D&         sampler,
+    Matf4&                       projection,
+    i32&                         tex_mode)
+{
+    view.get_pipeline_params();
+
+    for(auto const& unif : view.constants())
+    {
+        if(unif.m_name == "Texture")
+            view.set_sampler(unif, sampler.handle());
+        if(unif.m_name == "ProjMtx")
+            view.set_constant(unif, Bytes::Create(projection));
+        if(unif.m_name == "TexMode")
+            view.set_constant(unif, Bytes::Create(tex_mode));
+    }
+
+    view.build_state();
+}
+
+} // namespace detail
+} // namespace CImGui
+} // namespace Coffee
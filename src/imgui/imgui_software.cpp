@@ -0,0 +1,482 @@
+#include <coffee/imgui/imgui_software.h>
+
+#include <coffee/core/CProfiling>
+
+#include "imgui_parallel.h"
+#include "imgui_raster.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#define IM_API "ImGui::"
+
+namespace Coffee {
+namespace CImGui {
+
+namespace {
+
+/* a * x + b * y + c, sampled at pixel centres */
+struct plane
+{
+    f32 a, b, c;
+
+    f32 at(f32 x, f32 y) const
+    {
+        return a * x + b * y + c;
+    }
+};
+
+/* Edges are positive inside. Pixels centred exactly on an edge belong to
+ *  the triangle only for top-left edges, so shared edges are covered once. */
+struct edge
+{
+    plane eq;
+    bool  top_left;
+};
+
+enum attribute
+{
+    Attr_U,
+    Attr_V,
+    Attr_R,
+    Attr_G,
+    Attr_B,
+    Attr_A,
+
+    Attr_Count
+};
+
+struct triangle
+{
+    edge  edges[3];
+    plane attrs[Attr_Count];
+
+    /* Pixel bounds, clipped, exclusive maximum */
+    i32 x0, y0, x1, y1;
+
+    SoftwareTexture const* texture;
+
+    /* Constant colour and texel, blended as spans */
+    bool solid;
+    u8   color[4];
+};
+
+struct clip_rect
+{
+    i32 x0, y0, x1, y1;
+};
+
+static const SoftwareTexture white_texture = {nullptr, 0, 0, false};
+
+inline void Sample(
+    SoftwareTexture const& texture, f32 u, f32 v, u8 (&texel)[4])
+{
+    if(!texture.pixels)
+    {
+        texel[0] = texel[1] = texel[2] = texel[3] = 255;
+        return;
+    }
+
+    const auto x = C_CAST<i32>(std::floor(u * texture.width));
+    const auto y = C_CAST<i32>(std::floor(v * texture.height));
+
+    const auto cx = C_CAST<u32>(
+        std::min(std::max(x, 0), C_CAST<i32>(texture.width) - 1));
+    const auto cy = C_CAST<u32>(
+        std::min(std::max(y, 0), C_CAST<i32>(texture.height) - 1));
+
+    const szptr i = C_CAST<szptr>(cy) * texture.width + cx;
+
+    if(texture.alpha_only)
+    {
+        texel[0] = texel[1] = texel[2] = 255;
+        texel[3]                       = texture.pixels[i];
+    } else
+        std::memcpy(texel, texture.pixels + i * 4, 4);
+}
+
+inline u8 Modulate(f32 color, u8 texel)
+{
+    const auto c = C_CAST<u32>(std::min(std::max(color, 0.f), 255.f) + 0.5f);
+    return C_CAST<u8>((c * texel + 127) / 255);
+}
+
+inline plane EdgeEquation(ImVec2 const& a, ImVec2 const& b)
+{
+    return {a.y - b.y, b.x - a.x, a.x * b.y - a.y * b.x};
+}
+
+/* Returns false for degenerate and fully clipped triangles */
+bool SetupTriangle(
+    ImDrawVert const*      verts[3],
+    ImVec2 const&          scale,
+    clip_rect const&       clip,
+    SoftwareTexture const& texture,
+    triangle&              out)
+{
+    ImVec2 p[3];
+    for(u32 i = 0; i < 3; i++)
+        p[i] = ImVec2(verts[i]->pos.x * scale.x, verts[i]->pos.y * scale.y);
+
+    f32 area = (p[1].x - p[0].x) * (p[2].y - p[0].y) -
+               (p[1].y - p[0].y) * (p[2].x - p[0].x);
+
+    if(area == 0.f || !std::isfinite(area))
+        return false;
+
+    /* ImGui emits both windings */
+    if(area < 0.f)
+    {
+        std::swap(p[1], p[2]);
+        std::swap(verts[1], verts[2]);
+        area = -area;
+    }
+
+    const f32 min_x = std::min({p[0].x, p[1].x, p[2].x});
+    const f32 min_y = std::min({p[0].y, p[1].y, p[2].y});
+    const f32 max_x = std::max({p[0].x, p[1].x, p[2].x});
+    const f32 max_y = std::max({p[0].y, p[1].y, p[2].y});
+
+    out.x0 = std::max(clip.x0, C_CAST<i32>(std::floor(min_x)));
+    out.y0 = std::max(clip.y0, C_CAST<i32>(std::floor(min_y)));
+    out.x1 = std::min(clip.x1, C_CAST<i32>(std::ceil(max_x)));
+    out.y1 = std::min(clip.y1, C_CAST<i32>(std::ceil(max_y)));
+
+    if(out.x0 >= out.x1 || out.y0 >= out.y1)
+        return false;
+
+    /* Edge i is opposite of vertex i, and is its barycentric weight */
+    out.edges[0].eq = EdgeEquation(p[1], p[2]);
+    out.edges[1].eq = EdgeEquation(p[2], p[0]);
+    out.edges[2].eq = EdgeEquation(p[0], p[1]);
+
+    for(auto& e : out.edges)
+        e.top_left = e.eq.a > 0.f || (e.eq.a == 0.f && e.eq.b < 0.f);
+
+    f32 values[Attr_Count][3];
+    for(u32 i = 0; i < 3; i++)
+    {
+        const ImU32 col     = verts[i]->col;
+        values[Attr_U][i] = verts[i]->uv.x;
+        values[Attr_V][i] = verts[i]->uv.y;
+        values[Attr_R][i] = C_CAST<f32>((col >> IM_COL32_R_SHIFT) & 0xFF);
+        values[Attr_G][i] = C_CAST<f32>((col >> IM_COL32_G_SHIFT) & 0xFF);
+        values[Attr_B][i] = C_CAST<f32>((col >> IM_COL32_B_SHIFT) & 0xFF);
+        values[Attr_A][i] = C_CAST<f32>((col >> IM_COL32_A_SHIFT) & 0xFF);
+    }
+
+    const f32 inv_area = 1.f / area;
+
+    for(u32 a = 0; a < Attr_Count; a++)
+    {
+        auto& attr = out.attrs[a];
+        attr       = {0.f, 0.f, 0.f};
+
+        for(u32 i = 0; i < 3; i++)
+        {
+            const f32 w = values[a][i] * inv_area;
+            attr.a += out.edges[i].eq.a * w;
+            attr.b += out.edges[i].eq.b * w;
+            attr.c += out.edges[i].eq.c * w;
+        }
+    }
+
+    out.texture = &texture;
+    out.solid   = verts[0]->col == verts[1]->col &&
+                verts[0]->col == verts[2]->col &&
+                (!texture.pixels || (verts[0]->uv.x == verts[1]->uv.x &&
+                                     verts[0]->uv.x == verts[2]->uv.x &&
+                                     verts[0]->uv.y == verts[1]->uv.y &&
+                                     verts[0]->uv.y == verts[2]->uv.y));
+
+    if(out.solid)
+    {
+        u8 texel[4];
+        Sample(texture, verts[0]->uv.x, verts[0]->uv.y, texel);
+
+        for(u32 c = 0; c < 4; c++)
+            out.color[c] = Modulate(values[Attr_R + c][0], texel[c]);
+    }
+
+    return true;
+}
+
+/* Finds the pixels [x0, x1) of row `y` covered by `t` */
+inline bool RowSpan(triangle const& t, i32 y, i32& x0, i32& x1)
+{
+    const f32 yc = y + 0.5f;
+
+    for(auto const& e : t.edges)
+    {
+        const f32 k = e.eq.b * yc + e.eq.c;
+
+        if(e.eq.a == 0.f)
+        {
+            if(k < 0.f || (k == 0.f && !e.top_left))
+                return false;
+            continue;
+        }
+
+        /* Bounded first, so that the conversion cannot overflow */
+        const f32 cross = std::min(
+            std::max(-k / e.eq.a - 0.5f, C_CAST<f32>(x0 - 1)),
+            C_CAST<f32>(x1 + 1));
+        const i32 edge_x = C_CAST<i32>(std::ceil(cross));
+
+        /* a > 0 edges are always top-left, and inclusive */
+        if(e.eq.a > 0.f)
+            x0 = std::max(x0, edge_x);
+        else
+            x1 = std::min(x1, edge_x);
+    }
+
+    return x0 < x1;
+}
+
+} // namespace
+
+struct SoftwareRenderer::state
+{
+    SoftwareConfig                    config;
+    Map<ImTextureID, SoftwareTexture> textures;
+
+    Vector<u8> target;
+    u32        width  = 0;
+    u32        height = 0;
+
+    Vector<triangle>    triangles;
+    Vector<Vector<u32>> bins;
+    Vector<u64>         tile_pixels;
+
+    SoftwareStats stats = {};
+};
+
+SoftwareRenderer::SoftwareRenderer(SoftwareConfig const& config) :
+    m_state(MkUq<state>())
+{
+    m_state->config           = config;
+    m_state->config.tile_size = std::max(config.tile_size, 8u);
+}
+
+SoftwareRenderer::~SoftwareRenderer()
+{
+}
+
+void SoftwareRenderer::addTexture(
+    ImTextureID id, SoftwareTexture const& texture)
+{
+    m_state->textures[id] = texture;
+}
+
+void SoftwareRenderer::removeTexture(ImTextureID id)
+{
+    m_state->textures.erase(id);
+}
+
+void SoftwareRenderer::render(ImDrawData* draw_data)
+{
+    DProfContext _(IM_API "Software rendering");
+
+    using clock = Chrono::high_resolution_clock;
+
+    auto& s     = *m_state;
+    auto& stats = s.stats;
+    auto  start = clock::now();
+
+    stats = {};
+
+    ImGuiIO&   io     = ImGui::GetIO();
+    const auto scale  = io.DisplayFramebufferScale;
+    const auto width  = C_CAST<i32>(io.DisplaySize.x * scale.x);
+    const auto height = C_CAST<i32>(io.DisplaySize.y * scale.y);
+
+    s.width  = C_CAST<u32>(std::max(width, 0));
+    s.height = C_CAST<u32>(std::max(height, 0));
+    s.target.resize(C_CAST<szptr>(s.width) * s.height * 4);
+
+    for(szptr i = 0; i < s.target.size(); i += 4)
+        std::memcpy(&s.target[i], &s.config.clear_color, 4);
+
+    if(!draw_data || s.target.empty())
+        return;
+
+    const u32 tile_size = s.config.tile_size;
+    const u32 tiles_x   = (s.width + tile_size - 1) / tile_size;
+    const u32 tiles_y   = (s.height + tile_size - 1) / tile_size;
+    const u32 tiles     = tiles_x * tiles_y;
+
+    s.bins.resize(tiles);
+    for(auto& bin : s.bins)
+        bin.clear();
+    s.triangles.clear();
+
+    {
+        DProfContext _(IM_API "Setting up triangles");
+
+        for(int n = 0; n < draw_data->CmdListsCount; n++)
+        {
+            const ImDrawList* cmd_list   = draw_data->CmdLists[n];
+            const ImDrawIdx*  idx_buffer = cmd_list->IdxBuffer.Data;
+            const ImDrawVert* vtx_buffer = cmd_list->VtxBuffer.Data;
+
+            for(auto const& cmd : cmd_list->CmdBuffer)
+            {
+                if(cmd.UserCallback)
+                {
+                    cmd.UserCallback(cmd_list, &cmd);
+                    idx_buffer += cmd.ElemCount;
+                    continue;
+                }
+
+                /* Truncated like the GL scissor rect */
+                const clip_rect clip = {
+                    std::max(C_CAST<i32>(cmd.ClipRect.x * scale.x), 0),
+                    std::max(C_CAST<i32>(cmd.ClipRect.y * scale.y), 0),
+                    std::min(C_CAST<i32>(cmd.ClipRect.z * scale.x), width),
+                    std::min(C_CAST<i32>(cmd.ClipRect.w * scale.y), height),
+                };
+
+                auto texture_it = s.textures.find(cmd.TextureId);
+                auto const& texture =
+                    texture_it != s.textures.end() ? texture_it->second
+                                                   : white_texture;
+
+                for(u32 i = 0; clip.x0 < clip.x1 && clip.y0 < clip.y1 &&
+                               i + 2 < cmd.ElemCount;
+                    i += 3)
+                {
+                    ImDrawVert const* verts[3] = {
+                        &vtx_buffer[idx_buffer[i]],
+                        &vtx_buffer[idx_buffer[i + 1]],
+                        &vtx_buffer[idx_buffer[i + 2]],
+                    };
+
+                    triangle t;
+                    if(!SetupTriangle(verts, scale, clip, texture, t))
+                        continue;
+
+                    const auto index = C_CAST<u32>(s.triangles.size());
+                    s.triangles.push_back(t);
+
+                    const u32 bx0 = C_CAST<u32>(t.x0) / tile_size;
+                    const u32 by0 = C_CAST<u32>(t.y0) / tile_size;
+                    const u32 bx1 = C_CAST<u32>(t.x1 - 1) / tile_size;
+                    const u32 by1 = C_CAST<u32>(t.y1 - 1) / tile_size;
+
+                    for(u32 by = by0; by <= by1; by++)
+                        for(u32 bx = bx0; bx <= bx1; bx++)
+                            s.bins[by * tiles_x + bx].push_back(index);
+                }
+
+                idx_buffer += cmd.ElemCount;
+            }
+        }
+    }
+
+    auto setup_done  = clock::now();
+    stats.setup_time = Chrono::duration_cast<Chrono::microseconds>(
+        setup_done - start);
+
+    s.tile_pixels.assign(tiles, 0);
+
+    const u32 workers =
+        s.config.threads ? s.config.threads : detail::DefaultWorkers();
+
+    {
+        DProfContext _(IM_API "Rasterizing tiles");
+
+        detail::ParallelFor(tiles, workers, [&](u32 tile) {
+            const i32 tx0 = C_CAST<i32>((tile % tiles_x) * tile_size);
+            const i32 ty0 = C_CAST<i32>((tile / tiles_x) * tile_size);
+            const i32 tx1 =
+                std::min(tx0 + C_CAST<i32>(tile_size), C_CAST<i32>(s.width));
+            const i32 ty1 =
+                std::min(ty0 + C_CAST<i32>(tile_size), C_CAST<i32>(s.height));
+
+            u64 pixels = 0;
+
+            for(auto index : s.bins[tile])
+            {
+                auto const& t = s.triangles[index];
+
+                const i32 y0 = std::max(t.y0, ty0);
+                const i32 y1 = std::min(t.y1, ty1);
+
+                for(i32 y = y0; y < y1; y++)
+                {
+                    i32 x0 = std::max(t.x0, tx0);
+                    i32 x1 = std::min(t.x1, tx1);
+
+                    if(!RowSpan(t, y, x0, x1))
+                        continue;
+
+                    auto row = &s.target[(C_CAST<szptr>(y) * s.width) * 4];
+                    pixels += C_CAST<u64>(x1 - x0);
+
+                    if(t.solid)
+                    {
+                        detail::BlendSpanSolid(
+                            row + x0 * 4, C_CAST<u32>(x1 - x0), t.color);
+                        continue;
+                    }
+
+                    const f32 xc = x0 + 0.5f;
+                    const f32 yc = y + 0.5f;
+
+                    f32 values[Attr_Count];
+                    for(u32 a = 0; a < Attr_Count; a++)
+                        values[a] = t.attrs[a].at(xc, yc);
+
+                    for(i32 x = x0; x < x1; x++)
+                    {
+                        u8 texel[4];
+                        u8 color[4];
+                        Sample(
+                            *t.texture, values[Attr_U], values[Attr_V], texel);
+
+                        for(u32 c = 0; c < 4; c++)
+                            color[c] = Modulate(values[Attr_R + c], texel[c]);
+
+                        detail::BlendPixel(row + x * 4, color);
+
+                        for(u32 a = 0; a < Attr_Count; a++)
+                            values[a] += t.attrs[a].a;
+                    }
+                }
+            }
+
+            s.tile_pixels[tile] = pixels;
+        });
+    }
+
+    stats.triangles = s.triangles.size();
+    stats.tiles     = tiles;
+    for(auto pixels : s.tile_pixels)
+        stats.pixels += pixels;
+    stats.raster_time = Chrono::duration_cast<Chrono::microseconds>(
+        clock::now() - setup_done);
+}
+
+const u8* SoftwareRenderer::pixels() const
+{
+    return m_state->target.data();
+}
+
+u32 SoftwareRenderer::width() const
+{
+    return m_state->width;
+}
+
+u32 SoftwareRenderer::height() const
+{
+    return m_state->height;
+}
+
+SoftwareStats const& SoftwareRenderer::stats() const
+{
+    return m_state->stats;
+}
+
+} // namespace CImGui
+} // namespace Coffee
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <coffee/core/libc_types.h>
+#include <coffee/imgui/imgui_binding.h>
+
+#include "imgui_backend.h"
+
+namespace Coffee {
+namespace CImGui {
+namespace detail {
+
+struct ScissorRect
+{
+    i32 x, y, w, h;
+
+    bool operator==(ScissorRect const& other) const
+    {
+        return x == other.x && y == other.y && w == other.w && h == other.h;
+    }
+    bool operator!=(ScissorRect const& other) const
+    {
+        return !(*this == other);
+    }
+};
+
+/* Tracks the render state applied by the ImGui pass, so that transitions
+ *  which would not change anything are never sent to GFX.
+ * The pass uses one blend, raster and depth state, given to begin_frame().
+ *  Each is set the first time apply() runs in a frame, whatever the host
+ *  had bound, since only some of their fields could be compared. Later
+ *  calls are skipped until invalidate(), or for blending, until the blend
+ *  mode changes. Only states which were set are restored.
+ * The shadow is only valid within one frame, since the host is free to
+ *  change state between frames.
+ */
+template<typename GFX>
+struct StateShadow
+{
+    using Traits = BackendTraits<GFX>;
+
+    StateShadow(RenderStats& stats) :
+        m_stats(stats), m_blend(nullptr), m_raster(nullptr), m_depth(nullptr),
+        m_blend_mode(BlendMode::Straight), m_restore(true),
+        m_blend_changed(false), m_raster_changed(false),
+        m_depth_changed(false), m_view_changed(false), m_blend_valid(false),
+        m_raster_valid(false), m_depth_valid(false), m_scissor_valid(false)
+    {
+    }
+
+    /* With `restore` set, the host's state is queried now and put back in
+     *  end_frame(). Without it, the host promises to reset state itself.
+     *  The states are referenced until end_frame(). */
+    void begin_frame(
+        bool                           restore,
+        typename GFX::BLNDSTATE const& blend,
+        typename GFX::RASTSTATE const& raster,
+        typename GFX::DEPTSTATE const& depth)
+    {
+        m_blend          = &blend;
+        m_raster         = &raster;
+        m_depth          = &depth;
+        m_restore        = restore;
+        m_blend_changed  = false;
+        m_raster_changed = false;
+        m_depth_changed  = false;
+        m_view_changed   = false;
+        m_blend_valid    = false;
+        m_raster_valid   = false;
+        m_depth_valid    = false;
+        m_scissor_valid  = false;
+
+        if(!m_restore)
+            return;
+
+        GFX::GetBlendState(m_prev_blend);
+        GFX::GetViewportState(m_prev_view);
+        GFX::GetRasterizerState(m_prev_raster);
+        GFX::GetDepthState(m_prev_depth);
+    }
+
+    void end_frame()
+    {
+        if(!m_restore)
+            return;
+
+        restore(m_view_changed, [this]() {
+            GFX::SetViewportState(m_prev_view);
+        });
+        restore(m_blend_changed, [this]() {
+            GFX::SetBlendState(m_prev_blend);
+        });
+        restore(m_raster_changed, [this]() {
+            GFX::SetRasterizerState(m_prev_raster);
+        });
+        restore(m_depth_changed, [this]() {
+            GFX::SetDepthState(m_prev_depth);
+        });
+    }
+
+    /* Before drawing, with the blend factors of `mode` */
+    void apply(BlendMode mode = BlendMode::Straight)
+    {
+        if(m_blend_valid && m_blend_mode == mode)
+            elide();
+        else
+        {
+            GFX::SetBlendState(*m_blend);
+            Traits::set_blend_mode(mode);
+
+            m_blend_mode    = mode;
+            m_blend_valid   = true;
+            m_blend_changed = true;
+            m_stats.state_changes_issued++;
+        }
+
+        if(m_raster_valid)
+            elide();
+        else
+        {
+            GFX::SetRasterizerState(*m_raster);
+            m_raster_valid   = true;
+            m_raster_changed = true;
+            m_stats.state_changes_issued++;
+        }
+
+        if(m_depth_valid)
+            elide();
+        else
+        {
+            GFX::SetDepthState(*m_depth);
+            m_depth_valid   = true;
+            m_depth_changed = true;
+            m_stats.state_changes_issued++;
+        }
+    }
+
+    void apply_scissor(typename GFX::VIEWSTATE& view, ScissorRect const& rect)
+    {
+        if(m_scissor_valid && m_scissor == rect)
+            return elide();
+
+        view.m_scissor[0] = {rect.x, rect.y, rect.w, rect.h};
+        GFX::SetViewportState(view);
+
+        m_scissor       = rect;
+        m_scissor_valid = true;
+        m_view_changed  = true;
+        m_stats.state_changes_issued++;
+    }
+
+    /* Viewport state is re-sent after switching framebuffers */
+    void invalidate_scissor()
+    {
+        m_scissor_valid = false;
+    }
+
+    /* User callbacks may change anything, which is set again before the
+     *  next draw and restored after the frame */
+    void invalidate()
+    {
+        m_scissor_valid  = false;
+        m_blend_valid    = false;
+        m_raster_valid   = false;
+        m_depth_valid    = false;
+        m_blend_changed  = true;
+        m_raster_changed = true;
+        m_depth_changed  = true;
+        m_view_changed   = true;
+    }
+
+  private:
+    void elide()
+    {
+        m_stats.state_changes_elided++;
+    }
+
+    template<typename Fun>
+    void restore(bool changed, Fun&& fun)
+    {
+        if(!changed)
+            return elide();
+
+        fun();
+        m_stats.state_changes_issued++;
+    }
+
+    RenderStats& m_stats;
+
+    typename GFX::BLNDSTATE m_prev_blend;
+    typename GFX::VIEWSTATE m_prev_view;
+    typename GFX::RASTSTATE m_prev_raster;
+    typename GFX::DEPTSTATE m_prev_depth;
+
+    typename GFX::BLNDSTATE const* m_blend;
+    typename GFX::RASTSTATE const* m_raster;
+    typename GFX::DEPTSTATE const* m_depth;
+
+    BlendMode m_blend_mode;
+
+    bool m_restore;
+    bool m_blend_changed;
+    bool m_raster_changed;
+    bool m_depth_changed;
+    bool m_view_changed;
+    bool m_blend_valid;
+    bool m_raster_valid;
+    bool m_depth_valid;
+    bool m_scissor_valid;
+
+    ScissorRect m_scissor;
+};
+
+} // namespace detail
+} // namespace CImGui
+} // namespace Coffee
@@ -0,0 +1,303 @@
+#pragma once
+
+#include <coffee/core/stl_types.h>
+#include <coffee/core/types/chunk.h>
+#include <coffee/imgui/imgui_binding.h>
+#include <peripherals/libc/memory_ops.h>
+
+#include <deque>
+
+namespace Coffee {
+namespace CImGui {
+namespace detail {
+
+/* Bookkeeping for a ring of streamed data with N frames in flight.
+ * Regions are tagged with the frame that wrote them, and are only reused
+ *  once that frame is `frames_in_flight` frames old. This gives fence-like
+ *  reuse without querying the driver. No GPU API is touched here, the
+ *  buffer itself is handled by StreamRing<Buffer>.
+ */
+struct StreamRingAllocator
+{
+    struct region
+    {
+        u64   frame;
+        szptr offset;
+        szptr size;
+    };
+
+    StreamRingAllocator(StreamingConfig const& config = {}) :
+        m_config(config), m_capacity(0), m_head(0), m_frame(0),
+        m_frame_bytes(0), m_window_peak(0), m_idle_frames(0),
+        m_pending_capacity(0), m_stats()
+    {
+    }
+
+    void configure(StreamingConfig const& config)
+    {
+        m_config = config;
+    }
+
+    StreamingConfig const& config() const
+    {
+        return m_config;
+    }
+
+    /* Retire regions old enough to be reused */
+    void begin_frame(u64 frame)
+    {
+        m_frame       = frame;
+        m_frame_bytes = 0;
+
+        while(!m_regions.empty() &&
+              m_regions.front().frame + m_config.frames_in_flight <= frame)
+            m_regions.pop_front();
+
+        if(m_regions.empty())
+            m_head = 0;
+    }
+
+    /* Updates statistics and decides whether the ring may shrink */
+    void end_frame()
+    {
+        m_stats.frame_bytes = m_frame_bytes;
+        m_stats.high_water_mark =
+            std::max(m_stats.high_water_mark, m_frame_bytes);
+        m_window_peak = std::max(m_window_peak, m_frame_bytes);
+
+        const szptr wanted = target_capacity(m_window_peak);
+
+        if(wanted < m_capacity / 2)
+            m_idle_frames++;
+        else
+        {
+            m_idle_frames = 0;
+            m_window_peak = m_frame_bytes;
+        }
+
+        if(m_config.shrink_idle_frames &&
+           m_idle_frames >= m_config.shrink_idle_frames)
+        {
+            m_pending_capacity = wanted;
+            m_idle_frames      = 0;
+            m_window_peak      = 0;
+        }
+    }
+
+    /* Finds space for `size` bytes, offset aligned to `align` bytes.
+     * Returns false when the ring has to grow before it fits. */
+    bool allocate(szptr size, szptr align, szptr& offset)
+    {
+        if(size == 0)
+        {
+            offset = 0;
+            return true;
+        }
+
+        szptr candidate = align_up(m_head, align);
+
+        if(m_regions.empty())
+        {
+            if(candidate + size > m_capacity)
+                candidate = 0;
+            if(size > m_capacity)
+                return false;
+        } else
+        {
+            const szptr tail = m_regions.front().offset;
+
+            if(!wrapped())
+            {
+                /* Occupied: [tail, head) */
+                if(candidate + size > m_capacity)
+                {
+                    if(size > tail)
+                        return false;
+                    candidate = 0;
+                    m_stats.wrap_count++;
+                }
+            } else if(candidate + size > tail)
+                /* Occupied: [tail, capacity) + [0, head) */
+                return false;
+        }
+
+        m_regions.push_back({m_frame, candidate, size});
+        m_head = candidate + size;
+        offset = candidate;
+
+        m_frame_bytes += size;
+        m_stats.in_flight_high_water_mark =
+            std::max(m_stats.in_flight_high_water_mark, in_flight_bytes());
+
+        return true;
+    }
+
+    /* Drops all regions and resizes the ring. Draws already submitted keep
+     *  the orphaned storage alive, so this is safe mid-frame. */
+    void reset(szptr capacity)
+    {
+        if(capacity > m_capacity)
+            m_stats.grow_count++;
+        else if(capacity < m_capacity)
+            m_stats.shrink_count++;
+
+        m_regions.clear();
+        m_head             = 0;
+        m_capacity         = capacity;
+        m_pending_capacity = 0;
+        m_stats.capacity   = capacity;
+    }
+
+    /* Geometric growth, large enough to hold `size` more bytes */
+    szptr grow_capacity(szptr size) const
+    {
+        szptr capacity = std::max(m_capacity, m_config.min_capacity);
+        szptr needed   = target_capacity(m_frame_bytes + size);
+
+        while(capacity < needed)
+            capacity = std::max(
+                capacity + 1,
+                C_FCAST<szptr>(capacity * m_config.growth_factor));
+
+        return capacity;
+    }
+
+    /* Non-zero when end_frame() decided to shrink the ring */
+    szptr pending_capacity() const
+    {
+        return m_pending_capacity;
+    }
+
+    szptr capacity() const
+    {
+        return m_capacity;
+    }
+
+    szptr in_flight_bytes() const
+    {
+        szptr out = 0;
+        for(auto const& r : m_regions)
+            out += r.size;
+        return out;
+    }
+
+    StreamStats const& stats() const
+    {
+        return m_stats;
+    }
+
+  private:
+    static szptr align_up(szptr offset, szptr align)
+    {
+        return align > 1 ? ((offset + align - 1) / align) * align : offset;
+    }
+
+    bool wrapped() const
+    {
+        return m_regions.back().offset < m_regions.front().offset;
+    }
+
+    szptr target_capacity(szptr frame_bytes) const
+    {
+        szptr capacity = std::max<szptr>(m_config.min_capacity, 1);
+        szptr needed   = frame_bytes * m_config.frames_in_flight;
+
+        while(capacity < needed)
+            capacity <<= 1;
+
+        return capacity;
+    }
+
+    StreamingConfig    m_config;
+    std::deque<region> m_regions;
+
+    szptr m_capacity;
+    szptr m_head;
+    u64   m_frame;
+    szptr m_frame_bytes;
+    szptr m_window_peak;
+    u32   m_idle_frames;
+    szptr m_pending_capacity;
+
+    StreamStats m_stats;
+};
+
+/* Binds a StreamRingAllocator to a GFX::BUF_A or GFX::BUF_E, re-allocating
+ *  the buffer storage when the ring grows or shrinks */
+template<typename Buffer>
+struct StreamRing
+{
+    StreamRing(Buffer& buffer) : m_buffer(buffer)
+    {
+    }
+
+    void begin_frame(u64 frame)
+    {
+        m_alloc.begin_frame(frame);
+
+        if(m_alloc.pending_capacity())
+            reallocate(m_alloc.pending_capacity());
+    }
+
+    void end_frame()
+    {
+        m_alloc.end_frame();
+    }
+
+    /* Copies `size` bytes into the ring, returns the byte offset */
+    szptr upload(c_cptr data, szptr size, szptr align)
+    {
+        szptr offset = 0;
+
+        if(!m_alloc.allocate(size, align, offset))
+        {
+            reallocate(m_alloc.grow_capacity(size));
+            m_alloc.allocate(size, align, offset);
+        }
+
+        if(size == 0)
+            return offset;
+
+        auto target = m_buffer.map(offset, size);
+
+        if(target)
+        {
+            MemCpy(
+                Bytes::From(C_RCAST<const u8*>(data), size),
+                Bytes::From(C_RCAST<u8*>(target), size));
+            m_buffer.unmap();
+        }
+
+        return offset;
+    }
+
+    void configure(StreamingConfig const& config)
+    {
+        m_alloc.configure(config);
+    }
+
+    /* Forget the storage, used when the device objects are lost */
+    void release()
+    {
+        m_alloc.reset(0);
+    }
+
+    StreamRingAllocator const& allocator() const
+    {
+        return m_alloc;
+    }
+
+  private:
+    void reallocate(szptr capacity)
+    {
+        m_alloc.reset(capacity);
+        m_buffer.commit(capacity, nullptr);
+    }
+
+    Buffer&             m_buffer;
+    StreamRingAllocator m_alloc;
+};
+
+} // namespace detail
+} // namespace CImGui
+} // namespace Coffee
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <coffee/core/stl_types.h>
+#include <coffee/interfaces/cgraphics_util.h>
+
+#include "imgui_shader_view.h"
+
+#include <imgui.h>
+
+#include <mutex>
+
+namespace Coffee {
+namespace CImGui {
+namespace detail {
+
+/* Maps ImTextureIDs handed out to the user onto surfaces.
+ * The sampler and shader view of an entry are created on first use, and
+ *  re-created whenever the ImGui pipeline changes, so textures may be
+ *  registered before the device objects exist and survive device resets.
+ * add() and remove() may be called from another thread than the one
+ *  drawing. Removed entries are kept until collect(), which is called where
+ *  the graphics context is current, so their samplers are freed there.
+ */
+template<typename GFX>
+struct TextureRegistry
+{
+    struct entry
+    {
+        entry(typename GFX::S_2D& surface, Filtering filter, i32 tex_mode) :
+            surface(&surface), filter(filter), tex_mode(tex_mode),
+            pipeline(nullptr)
+        {
+        }
+
+        ~entry()
+        {
+            release();
+        }
+
+        void release()
+        {
+            if(!view)
+                return;
+
+            view.reset();
+            sampler.dealloc();
+            pipeline = nullptr;
+        }
+
+        typename GFX::S_2D* surface;
+        typename GFX::SM_2D sampler;
+        Filtering           filter;
+        i32                 tex_mode;
+
+        UqPtr<RHI::shader_param_view<GFX>> view;
+        typename GFX::PIP const*           pipeline;
+    };
+
+    ImTextureID add(
+        typename GFX::S_2D& surface,
+        Filtering           filter,
+        i32                 tex_mode = TexMode_RGBA)
+    {
+        auto e  = MkUq<entry>(surface, filter, tex_mode);
+        auto id = C_RCAST<ImTextureID>(e.get());
+
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_entries.insert({id, std::move(e)});
+        return id;
+    }
+
+    void remove(ImTextureID id)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        auto it = m_entries.find(id);
+
+        if(it == m_entries.end())
+            return;
+
+        m_retired.push_back(std::move(it->second));
+        m_entries.erase(it);
+    }
+
+    /* Frees the entries removed since the last call */
+    void collect()
+    {
+        Vector<UqPtr<entry>> retired;
+
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            retired.swap(m_retired);
+        }
+    }
+
+    /* Returns the shader view for `id`, or null if it is not registered */
+    RHI::shader_param_view<GFX>* view(
+        ImTextureID                     id,
+        ShPtr<typename GFX::PIP> const& pipeline,
+        Matf4&                          projection)
+    {
+        entry* found = nullptr;
+
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            auto it = m_entries.find(id);
+
+            if(it != m_entries.end())
+                found = it->second.get();
+        }
+
+        /* A concurrent remove() only retires the entry */
+        if(!found)
+            return nullptr;
+
+        auto& e = *found;
+
+        if(!e.view || e.pipeline != pipeline.get())
+        {
+            e.release();
+
+            e.sampler.alloc();
+            e.sampler.attach(e.surface);
+            e.sampler.setFiltering(e.filter, e.filter);
+
+            e.view     = MkUq<RHI::shader_param_view<GFX>>(pipeline);
+            e.pipeline = pipeline.get();
+            BuildShaderView(*e.view, e.sampler, projection, e.tex_mode);
+        }
+
+        return e.view.get();
+    }
+
+    /* Drops GPU-side objects, keeping the registrations */
+    void release()
+    {
+        collect();
+
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        for(auto& e : m_entries)
+            e.second->release();
+    }
+
+    szptr size() const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_entries.size();
+    }
+
+  private:
+    mutable std::mutex             m_lock;
+    Map<ImTextureID, UqPtr<entry>> m_entries;
+    Vector<UqPtr<entry>>           m_retired;
+};
+
+} // namespace detail
+} // namespace CImGui
+} // namespace Coffee
@@ -0,0 +1,80 @@
+/* Host tool, bakes the default font atlas into a C++ source file.
+ * Invoked from src/imgui/CMakeLists.txt as
+ *
+ *  ImGuiAtlasBaker <output.cpp>
+ *
+ * The generated blob is picked up by CreateFontsTexture() when the runtime
+ *  font configuration hashes equal to the baked one.
+ */
+
+#include "../imgui_atlas_builder.h"
+#include "../imgui_atlas_cache.h"
+
+#include <cstdio>
+
+using namespace Coffee;
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        std::fprintf(stderr, "usage: %s <output.cpp>\n", argv[0]);
+        return 1;
+    }
+
+    auto& atlas = *ImGui::GetIO().Fonts;
+
+    const auto hash = CImGui::detail::AtlasCache::ConfigHash(atlas);
+
+    if(!CImGui::detail::AtlasCache::Cacheable(atlas) ||
+       !CImGui::detail::BuildAtlas(atlas))
+    {
+        std::fprintf(stderr, "failed to build font atlas\n");
+        return 1;
+    }
+
+    Vector<u8> blob;
+
+    if(!CImGui::detail::AtlasCache::Serialize(atlas, hash, blob))
+    {
+        std::fprintf(stderr, "failed to serialize font atlas\n");
+        return 1;
+    }
+
+    auto out = std::fopen(argv[1], "wb");
+
+    if(!out)
+    {
+        std::fprintf(stderr, "failed to open %s\n", argv[1]);
+        return 1;
+    }
+
+    std::fprintf(
+        out,
+        "/* Generated by ImGuiAtlasBaker, do not edit */\n"
+        "#include <coffee/core/libc_types.h>\n\n"
+        "namespace Coffee {\n"
+        "namespace CImGui {\n"
+        "namespace detail {\n\n"
+        "extern const u8    baked_atlas[];\n"
+        "extern const szptr baked_atlas_size;\n\n"
+        "alignas(8) const u8 baked_atlas[] = {");
+
+    for(szptr i = 0; i < blob.size(); i++)
+        std::fprintf(out, "%s0x%02x,", (i % 16) ? "" : "\n    ", blob[i]);
+
+    std::fprintf(
+        out,
+        "\n};\n\n"
+        "const szptr baked_atlas_size = %zu;\n\n"
+        "} // namespace detail\n"
+        "} // namespace CImGui\n"
+        "} // namespace Coffee\n",
+        blob.size());
+
+    std::fclose(out);
+
+    ImGui::Shutdown();
+
+    return 0;
+}
@@ -4,6 +4,7 @@
 #include <coffee/comp_app/subsystems.h>
 #include <coffee/core/libc_types.h>
 #include <coffee/core/stl_types.h>
+#include <coffee/core/types/chunk.h>
 #include <peripherals/stl/string_ops.h>
 #include <platforms/process.h>
 #include <platforms/sysinfo.h>
@@ -37,15 +38,308 @@ using imgui_error_code = domain_error_code<ImError, imgui_error_category>;
 
 using namespace Display;
 
+enum RenderFlags : u32
+{
+    RenderFlag_None = 0x0,
+
+    /* Pack every ImDrawList into one vertex and one element upload per
+     *  frame, drawing each command with vertex/element offsets */
+    RenderFlag_BatchUpload = 0x1,
+
+    /* Do not query and restore blend/viewport/raster/depth state around the
+     *  UI pass, for hosts that reset their state every frame anyway */
+    RenderFlag_NoStateRestore = 0x2,
+
+    /* Hash the draw data every frame and draw the UI into an offscreen
+     *  frame target. When the hash matches the previous frame, the target
+     *  is composited again instead of uploading and drawing the lists.
+     *  With RenderFlag_RetainedLists, or when a user callback is drawn, the
+     *  previous frame's draws are replayed from the resident buffers. */
+    RenderFlag_SkipUnchanged = 0x4,
+
+    /* Render every window into its own offscreen layer, which is only
+     *  redrawn when that window's content changes. Layers are composited
+     *  onto the default framebuffer. Implies RenderFlag_BatchUpload. */
+    RenderFlag_LayerCache = 0x8,
+
+    /* Build the font atlas with GetTexDataAsAlpha8() into an R8 texture,
+     *  a quarter of the RGBA size. Read when the device objects are
+     *  created, and ignored on API levels without R8 textures. */
+    RenderFlag_AlphaFontAtlas = 0x10,
+
+    /* Restore the font atlas from the baked default atlas or the on-disk
+     *  cache instead of rasterising it. The cache is keyed by a hash of the
+     *  font configuration, and rewritten when it does not match. */
+    RenderFlag_FontAtlasCache = 0x20,
+
+    /* Store the font atlas as a signed distance field, which scales under
+     *  DisplayFramebufferScale and FontGlobalScale without a rebuild. It is
+     *  generated from the 1x atlas, edges are placed to about half a texel,
+     *  so moderate scales work best. Requires RenderFlag_AlphaFontAtlas,
+     *  read with it. */
+    RenderFlag_SdfFontAtlas = 0x40,
+
+    /* Clip in the fragment shader against a rect carried by every vertex,
+     *  so commands which only differ in clip rect are drawn by one call.
+     *  Read when the device objects are created, implies
+     *  RenderFlag_BatchUpload. Layers of RenderFlag_LayerCache still use
+     *  the scissor box. */
+    RenderFlag_ShaderClip = 0x80,
+
+    /* Send the shapes of imgui_primitives.h as instance records, expanded
+     *  on the GPU, instead of tessellated vertices. Read when recording
+     *  them and when the device objects are created, so set it before. */
+    RenderFlag_Primitives = 0x100,
+
+    /* Stream 16 byte vertices with UVs in fixed point 1/32768 steps,
+     *  instead of the 20 byte ImDrawVert. Font atlas and user texture UVs
+     *  fit, dynamic glyphs only when the atlas height is a power of two.
+     *  Frames with a UV which does not fit exactly are sent unquantised,
+     *  so the output is unchanged, and are tried less often while that
+     *  keeps happening. Read when the device objects are created, implies
+     *  RenderFlag_BatchUpload and is ignored with RenderFlag_ShaderClip. */
+    RenderFlag_QuantizedVertices = 0x200,
+
+    /* Keep the vertices and elements of every list resident, keyed by its
+     *  window, and only upload the lists whose geometry changed. Read when
+     *  the device objects are created, and ignored with
+     *  RenderFlag_ShaderClip or RenderFlag_QuantizedVertices. Lists are
+     *  drawn directly while it is set, RenderFlag_LayerCache is not
+     *  applied. */
+    RenderFlag_RetainedLists = 0x400,
+
+    /* EndFrame() snapshots the draw data instead of rendering it, and
+     *  SubmitPendingFrame() draws it on the thread owning the graphics
+     *  context while the next frame is built. Device objects are then only
+     *  created by SubmitPendingFrame(). Not applied to a SoftwareRenderer,
+     *  set it before the first NewFrame(). */
+    RenderFlag_DeferredSubmit = 0x800,
+
+    RenderFlag_Default = RenderFlag_BatchUpload | RenderFlag_AlphaFontAtlas |
+                         RenderFlag_FontAtlasCache,
+};
+
+/* Vertex and element data is streamed through ring buffers */
+struct StreamingConfig
+{
+    /* Frames that may still be read by the GPU */
+    u32 frames_in_flight = 3;
+    /* Frames of low usage before the ring is shrunk, 0 disables shrinking */
+    u32 shrink_idle_frames = 600;
+
+    szptr min_capacity  = 64 * 1024;
+    f32   growth_factor = 2.f;
+};
+
+struct StreamStats
+{
+    szptr capacity;
+    szptr frame_bytes;
+    szptr high_water_mark;
+    szptr in_flight_high_water_mark;
+    u32   grow_count;
+    u32   shrink_count;
+    u32   wrap_count;
+};
+
+/* Counters for the last frame submitted by the renderer */
+struct RenderStats
+{
+    u32   upload_calls;
+    szptr upload_bytes;
+
+    /* ImDrawCmds before and after merging, and state-sharing runs */
+    u32 draws_before;
+    u32 draws_after;
+    u32 draw_runs;
+
+    /* Runs which had to switch to a different texture */
+    u32 texture_binds;
+
+    /* Batched frame whose indices address the vertices of every list, so
+     *  commands merge across lists. Not with more vertices than ImDrawIdx
+     *  addresses. */
+    bool shared_vertices;
+
+    /* RenderFlag_Primitives, instanced draws and the records they drew */
+    u32 primitive_draws;
+    u32 primitive_instances;
+
+    /* RenderFlag_QuantizedVertices, vertex bytes not uploaded this frame,
+     *  and the frames which failed to quantise since device creation.
+     *  Frames skipped after a failure are not counted. */
+    szptr quantized_bytes_saved;
+    u64   quantize_fallbacks;
+
+    /* RenderFlag_RetainedLists, lists drawn from their resident data and
+     *  lists uploaded, with their bytes. Evicted lists were not drawn. */
+    u32   retained_lists_reused;
+    u32   retained_lists_uploaded;
+    u32   retained_lists_evicted;
+    szptr retained_bytes_reused;
+    szptr retained_bytes_uploaded;
+
+    /* RenderFlag_DeferredSubmit, frames published by EndFrame() since
+     *  startup, and those replaced by a newer one before being drawn */
+    u64 frames_published;
+    u64 frames_replaced;
+
+    /* Render state transitions sent to GFX, and those skipped as no-ops */
+    u32 state_changes_issued;
+    u32 state_changes_elided;
+
+    /* RenderFlag_LayerCache */
+    u32   layers_rendered;
+    u32   layers_reused;
+    u32   layers_evicted;
+    szptr layer_bytes;
+
+    /* Totals since device creation, for RenderFlag_SkipUnchanged */
+    u64 frame_cache_hits;
+    u64 frame_cache_misses;
+
+    StreamStats vertex_stream;
+    StreamStats element_stream;
+};
+
+/* Glyphs added through AddDynamicGlyphs() are rasterised on first use into
+ *  a region of `atlas_rows` rows below the static font atlas */
+struct DynamicGlyphConfig
+{
+    u32 atlas_rows = 1024;
+};
+
+struct GlyphCacheStats
+{
+    u32   dynamic_glyphs;
+    u32   resident_glyphs;
+    u64   glyphs_rasterized;
+    u64   glyphs_dropped;
+    u32   shelves_evicted;
+    szptr region_bytes;
+    u64   upload_bytes;
+};
+
+struct FontAtlasStats
+{
+    enum class Source
+    {
+        Built,
+        Baked,
+        DiskCache,
+    };
+
+    Source source;
+    bool   distance_field;
+    u32   width;
+    u32   height;
+    szptr bytes;
+    bool  alpha_only;
+
+    Chrono::microseconds build_time;
+    Chrono::microseconds upload_time;
+
+    GlyphCacheStats glyph_cache;
+};
+
+/* Device objects are created in stages, one per NewFrame() */
+enum class DeviceStatus
+{
+    Unloaded,
+    Allocating,
+    CompilingShaders,
+    LinkingShaders,
+    VertexLayout,
+    UploadingFonts, /* Waits for the font atlas worker */
+    Ready,
+    Failed,
+};
+
+struct ProgramCacheStats
+{
+    u32 hits;
+    u32 misses;
+
+    /* Compile and link time of the pipelines in the cache, and the sum of
+     *  it over all hits */
+    Chrono::microseconds compile_time;
+    Chrono::microseconds time_saved;
+};
+
+/* Time spent in the device creation stages. After the first
+ *  InvalidateDeviceObjects(), stages count towards recreate_time, which
+ *  covers the last reset only. */
+struct DeviceStats
+{
+    Chrono::microseconds create_time;
+    Chrono::microseconds invalidate_time;
+    Chrono::microseconds recreate_time;
+    u32                  resets;
+
+    ProgramCacheStats program_cache;
+};
+
 IMGUI_API bool Init(Components::EntityContainer& container);
+/* Destroys the device objects. With RenderFlag_DeferredSubmit, the thread
+ *  calling SubmitPendingFrame() must be stopped or joined first. */
 IMGUI_API void Shutdown();
-IMGUI_API void NewFrame(Components::EntityContainer& container);
+
+/* Linked pipelines are kept across Shutdown() and Init(). Frees those of
+ *  the backend in use, call after Shutdown() and before the graphics
+ *  context goes away. */
+IMGUI_API void ReleaseProgramCache();
+
+/* Until FrameReady(), NewFrame() advances device creation by one stage
+ *  and does not start an ImGui frame. No ImGui calls may be made in
+ *  between, and EndFrame() does nothing. Returns whether an ImGui frame
+ *  was started, which with RenderFlag_DeferredSubmit may differ from a
+ *  later FrameReady(). */
+IMGUI_API bool NewFrame(Components::EntityContainer& container);
 IMGUI_API void EndFrame();
+/* Device objects are Ready, or a software renderer is installed. With
+ *  RenderFlag_DeferredSubmit, as last seen by SubmitPendingFrame(). */
+IMGUI_API bool FrameReady();
+
+/* RenderFlag_DeferredSubmit, draws the frame EndFrame() published last,
+ *  waiting up to `timeout` for one. Call it from the thread owning the
+ *  graphics context, which also creates the device objects through it,
+ *  one stage per call. False if nothing was drawn.
+ * The widgets of the next frame run meanwhile, so dynamic glyphs, render
+ *  flags and device objects must not be changed from the widget thread. */
+IMGUI_API bool SubmitPendingFrame(
+    Components::duration const& timeout = Components::duration::zero());
 
 // Use if you want to reset your rendering device without losing ImGui state.
 IMGUI_API void InvalidateDeviceObjects(imgui_error_code& ec);
+/* Blocks until every remaining stage has run */
 IMGUI_API bool CreateDeviceObjects(imgui_error_code& ec);
 
+IMGUI_API DeviceStatus       GetDeviceStatus();
+IMGUI_API cstring            DeviceStatusName(DeviceStatus status);
+IMGUI_API DeviceStats const& GetDeviceStats();
+
+IMGUI_API void SetStreamingConfig(StreamingConfig const& config);
+IMGUI_API void SetRenderFlags(u32 flags);
+IMGUI_API u32  GetRenderFlags();
+
+/* Registers a TrueType font whose glyphs in `ranges` are only rasterised
+ *  once displayed. Glyphs are merged into `target`, or the first font of
+ *  the atlas, skipping those it already has. Call before Init(). */
+IMGUI_API void AddDynamicGlyphs(
+    Bytes const&   font_data,
+    f32            size_pixels,
+    const ImWchar* ranges,
+    ImFont*        target = nullptr);
+IMGUI_API void SetDynamicGlyphConfig(DynamicGlyphConfig const& config);
+
+IMGUI_API RenderStats const&    GetRenderStats();
+IMGUI_API FontAtlasStats const& GetFontAtlasStats();
+
+/* For ImGuiSystem's idle mode, request a full frame on the next tick, or
+ *  at the latest after `within` has passed */
+IMGUI_API void RequestRedraw();
+IMGUI_API void RequestRedraw(Components::duration const& within);
+
 using ImGuiWidget = Function<void(
     Components::EntityContainer&,
     Components::time_point const&,
@@ -78,11 +372,33 @@ struct ImGuiSystem : Components::RestrictedSubsystem<
     virtual void end_restricted(Proxy&, Components::time_point const&) final;
 
     ImGuiSystem& addWidget(ImGuiWidget&& widget);
+    ImGuiSystem& setRenderFlags(u32 flags);
+    ImGuiSystem& setSkipUnchanged(bool enabled);
+
+    /* In idle mode, NewFrame and the widgets only run when input arrived,
+     *  the window was resized or a redraw was requested. Other ticks draw
+     *  the previous frame's output again, user callbacks are called with a
+     *  copy of their command and a null parent list. */
+    ImGuiSystem& setIdleMode(bool enabled);
+
+    /* Whether the current tick ran a full ImGui frame */
+    bool frameActive() const
+    {
+        return m_frameActive;
+    }
 
   private:
+    bool frameRequired(Proxy& p, Components::time_point const& t);
+
     time_point          m_previousTime;
+    time_point          m_redrawDeadline;
     Vector<ImGuiWidget> m_widgets;
+    ImVec2              m_displaySize;
+    u64                 m_inputGeneration;
+    u32                 m_settleFrames;
     bool                m_textInputActive;
+    bool                m_idleMode;
+    bool                m_frameActive;
 };
 
 namespace Widgets {
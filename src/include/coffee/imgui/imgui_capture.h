@@ -0,0 +1,63 @@
+#pragma once
+
+#include <coffee/imgui/imgui_binding.h>
+
+namespace Coffee {
+namespace CImGui {
+
+namespace detail {
+struct PrimitiveStream;
+}
+
+/* Recorded ImDrawData, for replaying real frames into a renderer without
+ *  running the widgets.
+ * Frames keep their draw lists, commands, clip rects, texture IDs and
+ *  display size. The font atlas is referenced by its configuration hash,
+ *  and resolved to the TexID of the atlas loaded when replaying. Other
+ *  texture IDs are kept as-is, they are only meaningful to the process
+ *  which recorded them. Markers of RenderFlag_Primitives keep their
+ *  instance records, other user callbacks are dropped.
+ */
+struct DrawCapture
+{
+    DrawCapture();
+    ~DrawCapture();
+
+    /* Appends `draw_data`, which must not have had its clip rects scaled
+     *  yet, along with the current display size. Primitive markers are
+     *  looked up in `primitives`. */
+    void record(
+        ImDrawData const*              draw_data,
+        detail::PrimitiveStream const* primitives = nullptr);
+    void clear();
+
+    /* Binary form, see imgui_capture.cpp for the layout */
+    void serialize(Vector<u8>& out) const;
+    /* Replaces the content, false if `data` is not a valid capture for
+     *  this build's vertex and index formats */
+    bool deserialize(const u8* data, szptr size);
+
+    u32 frames() const;
+
+    /* Whether the loaded font atlas is the one the capture was made with */
+    bool atlasMatches() const;
+
+    /* Rebuilds frame `index` and applies its display size to the ImGui IO.
+     *  The result is owned by the capture, and valid until the next call.
+     *  Renderers scale clip rects in place, so rebuild before every
+     *  submission. Primitive records replace those of the current frame. */
+    ImDrawData* frame(u32 index);
+
+  private:
+    struct state;
+
+    UqPtr<state> m_state;
+};
+
+/* Records the next `frames` frames rendered by EndFrame() into `capture`,
+ *  or every frame until StopCapture() for 0 */
+IMGUI_API void StartCapture(DrawCapture* capture, u32 frames = 0);
+IMGUI_API void StopCapture();
+
+} // namespace CImGui
+} // namespace Coffee
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <coffee/imgui/imgui_binding.h>
+
+namespace Coffee {
+namespace CImGui {
+
+/* Shapes which RenderFlag_Primitives sends to the GPU as one instance
+ *  record each, instead of the vertices ImDrawList tessellates them into.
+ *  Without the flag, or with a software renderer, they forward to the
+ *  ImDrawList functions of the same name.
+ * Rounding applies to all corners. Records only live until the next
+ *  NewFrame(). DrawCapture stores them with the marker commands which
+ *  reference them, replayed frames draw them with RenderFlag_Primitives.
+ */
+IMGUI_API void AddRect(
+    ImDrawList*   list,
+    ImVec2 const& a,
+    ImVec2 const& b,
+    ImU32         col,
+    f32           rounding  = 0.f,
+    f32           thickness = 1.f);
+IMGUI_API void AddRectFilled(
+    ImDrawList*   list,
+    ImVec2 const& a,
+    ImVec2 const& b,
+    ImU32         col,
+    f32           rounding = 0.f);
+IMGUI_API void AddCircle(
+    ImDrawList*   list,
+    ImVec2 const& centre,
+    f32           radius,
+    ImU32         col,
+    f32           thickness = 1.f);
+IMGUI_API void AddCircleFilled(
+    ImDrawList* list, ImVec2 const& centre, f32 radius, ImU32 col);
+
+} // namespace CImGui
+} // namespace Coffee
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <coffee/imgui/imgui_binding.h>
+
+namespace Coffee {
+namespace CImGui {
+
+/* Pixels referenced by a SoftwareRenderer, which must outlive their
+ *  registration. Alpha-only textures are sampled as white with alpha. */
+struct SoftwareTexture
+{
+    const u8* pixels;
+    u32       width;
+    u32       height;
+    bool      alpha_only;
+};
+
+struct SoftwareConfig
+{
+    /* Rasterising threads, 0 picks one per hardware thread */
+    u32 threads = 0;
+    /* Tiles are square and rasterised independently */
+    u32 tile_size = 64;
+    /* Written to every pixel before rendering, RGBA in memory order */
+    u32 clear_color = 0;
+};
+
+/* Counters for the last render() */
+struct SoftwareStats
+{
+    u64 triangles;
+    u64 pixels;
+    u32 tiles;
+
+    Chrono::microseconds setup_time;
+    Chrono::microseconds raster_time;
+};
+
+/* Rasterises ImDrawData into an RGBA8 buffer without a GPU, for headless
+ *  screenshots and UI regression checks.
+ * Triangles are set up and binned into tiles serially, tiles are then
+ *  rasterised on worker threads, each in submission order. Clip rects,
+ *  nearest texture sampling and the blending of the GL path are applied.
+ *  Spans of constant colour, such as window backgrounds, are blended with
+ *  SSE2 where available.
+ */
+struct SoftwareRenderer
+{
+    SoftwareRenderer(SoftwareConfig const& config = {});
+    ~SoftwareRenderer();
+
+    /* Textures not registered are treated as white */
+    void addTexture(ImTextureID id, SoftwareTexture const& texture);
+    void removeTexture(ImTextureID id);
+
+    /* Resizes the target to the framebuffer size of `draw_data` */
+    void render(ImDrawData* draw_data);
+
+    const u8* pixels() const;
+    u32       width() const;
+    u32       height() const;
+
+    SoftwareStats const& stats() const;
+
+  private:
+    struct state;
+
+    UqPtr<state> m_state;
+};
+
+/* Replaces the GL renderer, null switches back to it. While installed,
+ *  NewFrame() does not create device objects, and the font atlas is built
+ *  as Alpha8 and registered with `renderer`. Glyphs added through
+ *  AddDynamicGlyphs() are not drawn by it. */
+IMGUI_API void SetSoftwareRenderer(SoftwareRenderer* renderer);
+
+} // namespace CImGui
+} // namespace Coffee
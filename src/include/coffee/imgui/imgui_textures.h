@@ -0,0 +1,73 @@
+#pragma once
+
+#include <coffee/graphics/apis/CGLeamRHI>
+#include <coffee/imgui/imgui_binding.h>
+
+namespace Coffee {
+namespace CImGui {
+
+#if defined(COFFEE_IMGUI_USE_GLEAM)
+using ImGuiAPI = RHI::GLEAM::GLEAM_API;
+#else
+using ImGuiAPI = RHI::NullAPI;
+#endif
+
+/* The renderer for a specific GFX API. Instantiated for the GLEAM API and
+ *  the NullAPI, other APIs need an explicit instantiation in
+ *  imgui_binding.cpp, and a BackendTraits specialisation when they expose
+ *  native handles.
+ * The untemplated functions forward to the API picked by UseBackend(),
+ *  ImGuiAPI by default. Every API has its own device objects, only the one
+ *  in use is driven by Init(), Shutdown() and ImGuiSystem.
+ */
+template<typename GFX>
+IMGUI_API void UseBackend();
+
+template<typename GFX>
+IMGUI_API bool NewFrame(Components::EntityContainer& container);
+template<typename GFX>
+IMGUI_API bool CreateDeviceObjects(imgui_error_code& ec);
+template<typename GFX>
+IMGUI_API void InvalidateDeviceObjects(imgui_error_code& ec);
+/* Releases the device objects of GFX, the pipeline cache is kept */
+template<typename GFX>
+IMGUI_API void DestroyDeviceObjects();
+template<typename GFX>
+IMGUI_API void RenderDrawData(ImDrawData* draw_data);
+
+template<typename GFX>
+IMGUI_API DeviceStatus GetDeviceStatus();
+template<typename GFX>
+IMGUI_API RenderStats const& GetRenderStats();
+template<typename GFX>
+IMGUI_API DeviceStats const& GetDeviceStats();
+template<typename GFX>
+IMGUI_API FontAtlasStats const& GetFontAtlasStats();
+
+/* Linked pipelines of GFX, see ReleaseProgramCache() */
+template<typename GFX>
+IMGUI_API void ReleaseProgramCache();
+
+/* Makes `surface` usable with ImGui::Image() and ImDrawList::AddImage().
+ * The surface is referenced and must outlive its registration. Commands
+ *  using the same texture are drawn together, and the texture is only
+ *  re-bound when it changes between draws.
+ * Both may be called from the widget thread with RenderFlag_DeferredSubmit,
+ *  the sampler is freed on the thread drawing. The surface must then stay
+ *  alive until SubmitPendingFrame() has drawn the following frame.
+ * Textures are registered with one API, and only found by its renderer.
+ */
+template<typename GFX>
+IMGUI_API ImTextureID RegisterTexture(
+    typename GFX::S_2D& surface, Filtering filter = Filtering::Linear);
+template<typename GFX>
+IMGUI_API void UnregisterTexture(ImTextureID texture);
+
+/* Registers with the backend picked by UseBackend(). Null if its surfaces
+ *  are not ImGuiAPI::S_2D, use RegisterTexture<GFX>() then. */
+IMGUI_API ImTextureID RegisterTexture(
+    ImGuiAPI::S_2D& surface, Filtering filter = Filtering::Linear);
+IMGUI_API void UnregisterTexture(ImTextureID texture);
+
+} // namespace CImGui
+} // namespace Coffee
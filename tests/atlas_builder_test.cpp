@@ -0,0 +1,93 @@
+#include <coffee/core/CUnitTesting>
+
+#include "imgui_atlas_builder.h"
+
+#include <cstring>
+
+using namespace Coffee;
+
+/* The default font, and the default font again merged into it */
+static void MergedConfig(ImFontAtlas& atlas)
+{
+    atlas.AddFontDefault();
+
+    ImFontConfig merged;
+    merged.MergeMode = true;
+    atlas.AddFontDefault(&merged);
+}
+
+static bool SameGlyphs(ImFont const& a, ImFont const& b)
+{
+    if(a.Glyphs.Size != b.Glyphs.Size)
+        return false;
+
+    for(int i = 0; i < a.Glyphs.Size; i++)
+    {
+        auto const& ga = a.Glyphs[i];
+        auto const& gb = b.Glyphs[i];
+
+        if(ga.Codepoint != gb.Codepoint || ga.XAdvance != gb.XAdvance ||
+           ga.X0 != gb.X0 || ga.Y0 != gb.Y0 || ga.X1 != gb.X1 ||
+           ga.Y1 != gb.Y1 || ga.U0 != gb.U0 || ga.V0 != gb.V0 ||
+           ga.U1 != gb.U1 || ga.V1 != gb.V1)
+            return false;
+    }
+
+    return true;
+}
+
+/* BuildAtlas() must produce what ImFontAtlas::Build() does */
+static bool SameAsBuild(void (*config)(ImFontAtlas&), u32 workers)
+{
+    ImFontAtlas reference;
+    ImFontAtlas parallel;
+
+    config(reference);
+    config(parallel);
+
+    if(!reference.Build() ||
+       !CImGui::detail::BuildAtlas(parallel, workers))
+        return false;
+
+    unsigned char *ref_pixels, *pixels;
+    int            ref_w, ref_h, w, h;
+
+    reference.GetTexDataAsAlpha8(&ref_pixels, &ref_w, &ref_h);
+    parallel.GetTexDataAsAlpha8(&pixels, &w, &h);
+
+    if(ref_w != w || ref_h != h ||
+       std::memcmp(ref_pixels, pixels, C_CAST<szptr>(w * h)) != 0)
+        return false;
+
+    if(reference.Fonts.Size != parallel.Fonts.Size)
+        return false;
+
+    for(int i = 0; i < reference.Fonts.Size; i++)
+        if(!SameGlyphs(*reference.Fonts[i], *parallel.Fonts[i]))
+            return false;
+
+    return true;
+}
+
+bool default_font()
+{
+    return SameAsBuild([](ImFontAtlas& atlas) { atlas.AddFontDefault(); }, 4);
+}
+
+bool merged_font()
+{
+    return SameAsBuild(MergedConfig, 4);
+}
+
+bool merged_font_serial()
+{
+    return SameAsBuild(MergedConfig, 1);
+}
+
+COFFEE_TESTS_BEGIN(3)
+
+    {default_font, "Default font matches ImFontAtlas::Build()"},
+    {merged_font, "Merged font matches ImFontAtlas::Build()"},
+    {merged_font_serial, "Merged font on one worker"}
+
+COFFEE_TESTS_END()
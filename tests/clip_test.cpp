@@ -0,0 +1,75 @@
+#include <coffee/core/CUnitTesting>
+
+#include "imgui_clip.h"
+
+using namespace Coffee;
+
+using CImGui::detail::ClipTest;
+using CImGui::detail::PackClipRect;
+
+static constexpr int fb_width  = 64;
+static constexpr int fb_height = 48;
+
+/* What glScissor() passes for the box the binding sets for `clip`, see
+ *  ScissorOf() in imgui_binding.cpp. Boxes of negative size are empty. */
+static bool ScissorTest(ImVec4 const& clip, int px, int py)
+{
+    const int x = C_CAST<int>(clip.x);
+    const int y = C_CAST<int>(fb_height - clip.w);
+    const int w = C_CAST<int>(clip.z - clip.x);
+    const int h = C_CAST<int>(clip.w - clip.y);
+
+    return px >= x && py >= y && px < x + w && py < y + h;
+}
+
+/* Every pixel of the framebuffer, tested at its centre like gl_FragCoord */
+static bool MatchesScissor(ImVec4 const& clip)
+{
+    u16 packed[4];
+    PackClipRect(clip, fb_height, packed);
+
+    for(int py = 0; py < fb_height; py++)
+        for(int px = 0; px < fb_width; px++)
+            if(ClipTest(packed, px + 0.5f, py + 0.5f) !=
+               ScissorTest(clip, px, py))
+                return false;
+
+    return true;
+}
+
+bool integer_rects()
+{
+    return MatchesScissor({0.f, 0.f, 64.f, 48.f}) &&
+           MatchesScissor({8.f, 4.f, 40.f, 30.f}) &&
+           MatchesScissor({63.f, 47.f, 64.f, 48.f});
+}
+
+bool fractional_rects()
+{
+    /* Truncated like the scissor box, not rounded */
+    return MatchesScissor({8.5f, 4.25f, 40.75f, 30.5f}) &&
+           MatchesScissor({0.9f, 0.1f, 1.9f, 47.9f});
+}
+
+bool offscreen_rects()
+{
+    return MatchesScissor({-16.f, -8.f, 20.f, 12.f}) &&
+           MatchesScissor({50.f, 40.f, 100.f, 90.f}) &&
+           MatchesScissor({-100.f, -100.f, -50.f, -50.f});
+}
+
+bool empty_rects()
+{
+    return MatchesScissor({10.f, 10.f, 10.f, 20.f}) &&
+           MatchesScissor({10.f, 10.f, 20.f, 10.f}) &&
+           MatchesScissor({20.f, 20.f, 10.f, 10.f});
+}
+
+COFFEE_TESTS_BEGIN(4)
+
+    {integer_rects, "Integer clip rects"},
+    {fractional_rects, "Fractional clip rects"},
+    {offscreen_rects, "Clip rects outside of the framebuffer"},
+    {empty_rects, "Empty and inverted clip rects"}
+
+COFFEE_TESTS_END()
@@ -0,0 +1,86 @@
+#include <coffee/core/CUnitTesting>
+#include <coffee/graphics/apis/CGLeamRHI>
+
+#include "imgui_program_cache.h"
+
+using namespace Coffee;
+
+using Cache = CImGui::detail::ProgramCache<RHI::NullAPI>;
+
+static const Chrono::microseconds compile_time(1500);
+
+bool source_keys()
+{
+    const auto key = Cache::Key({"#version 330\n", "void main(){}"});
+
+    /* Sources are length-prefixed, moving text between them changes it */
+    return key == Cache::Key({"#version 330\n", "void main(){}"}) &&
+           key != Cache::Key({"#version 330\nvoid", " main(){}"}) &&
+           key != Cache::Key({"#version 300 es\n", "void main(){}"});
+}
+
+bool lookup_and_store()
+{
+    Cache      cache;
+    const auto key = Cache::Key({"vertex", "fragment"});
+
+    /* Acquiring alone does not link anything */
+    auto pipeline = cache.acquire(key);
+    if(cache.lookup(key))
+        return false;
+
+    cache.store(key, compile_time);
+
+    if(!cache.lookup(key) || !cache.lookup(key))
+        return false;
+
+    /* The same pipeline is shared by later contexts */
+    if(cache.acquire(key) != pipeline)
+        return false;
+
+    auto const& stats = cache.stats();
+    return stats.hits == 2 && stats.misses == 1 &&
+           stats.compile_time == compile_time &&
+           stats.time_saved == compile_time * 2;
+}
+
+bool invalidate()
+{
+    Cache      cache;
+    const auto key = Cache::Key({"vertex", "fragment"});
+
+    auto pipeline = cache.acquire(key);
+    cache.store(key, compile_time);
+    cache.invalidate();
+
+    /* Pipelines are compiled again, into the same object */
+    if(cache.lookup(key) || cache.acquire(key) != pipeline)
+        return false;
+
+    cache.store(key, compile_time);
+
+    return cache.lookup(key) && cache.stats().hits == 1 &&
+           cache.stats().misses == 1;
+}
+
+bool clear()
+{
+    Cache      cache;
+    const auto key = Cache::Key({"vertex", "fragment"});
+
+    auto pipeline = cache.acquire(key);
+    cache.store(key, compile_time);
+    cache.clear();
+
+    /* Pipelines are released, later contexts get new ones */
+    return !cache.lookup(key) && cache.acquire(key) != pipeline;
+}
+
+COFFEE_TESTS_BEGIN(4)
+
+    {source_keys, "Keys of shader sources"},
+    {lookup_and_store, "Hits and misses of lookup()"},
+    {invalidate, "Invalidated pipelines miss"},
+    {clear, "Cleared pipelines are released"}
+
+COFFEE_TESTS_END()
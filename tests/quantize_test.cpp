@@ -0,0 +1,170 @@
+#include <coffee/core/CUnitTesting>
+#include <coffee/core/stl_types.h>
+
+#include "imgui_quantize.h"
+
+#include <limits>
+
+using namespace Coffee;
+
+using CImGui::detail::DequantizeVertex;
+using CImGui::detail::quant_backoff_max;
+using CImGui::detail::QuantizeBackoff;
+using CImGui::detail::QuantizeVertex;
+using CImGui::detail::QuantizeVertices;
+using CImGui::detail::QuantVertex;
+
+static ImDrawVert Vertex(f32 x, f32 y, f32 u, f32 v)
+{
+    ImDrawVert out;
+    out.pos = ImVec2(x, y);
+    out.uv  = ImVec2(u, v);
+    out.col = 0xFF00FF80;
+    return out;
+}
+
+static bool Same(ImDrawVert const& a, ImDrawVert const& b)
+{
+    return a.pos.x == b.pos.x && a.pos.y == b.pos.y && a.uv.x == b.uv.x &&
+           a.uv.y == b.uv.y && a.col == b.col;
+}
+
+/* Odd counts go through the vector path and the scalar tail */
+static bool Converts(Vector<ImDrawVert> const& vertices)
+{
+    Vector<QuantVertex> out(vertices.size());
+    return QuantizeVertices(vertices.data(), vertices.size(), out.data());
+}
+
+bool exact_round_trip()
+{
+    /* Texel edges of a 512 and a 4096 wide atlas, the white pixel's
+     *  centre, and positions off any pixel grid */
+    Vector<ImDrawVert> vertices = {
+        Vertex(0.f, 0.f, 0.f, 0.f),
+        Vertex(12.5f, 300.125f, 37.f / 512.f, 1.f),
+        Vertex(-4096.f, 4095.875f, 4095.f / 4096.f, 1.f / 4096.f),
+        Vertex(1920.f, 1080.f, 0.5f, 0.25f),
+        Vertex(7.375f, -20.75f, 1.f / 32768.f, 65535.f / 32768.f),
+        Vertex(10.3f, 1.f / 3.f, 0.5f / 1024.f, 0.5f / 64.f),
+        Vertex(-70000.f, 0.70710677f, 0.f, 0.f),
+    };
+
+    Vector<QuantVertex> out(vertices.size());
+
+    if(!QuantizeVertices(vertices.data(), vertices.size(), out.data()))
+        return false;
+
+    for(szptr i = 0; i < vertices.size(); i++)
+    {
+        QuantVertex scalar;
+
+        if(!QuantizeVertex(vertices[i], scalar) ||
+           !Same(DequantizeVertex(out[i]), vertices[i]) ||
+           !Same(DequantizeVertex(scalar), vertices[i]))
+            return false;
+    }
+
+    return true;
+}
+
+bool any_position()
+{
+    QuantVertex out;
+
+    /* Anti-aliased fringes and rounded corners, in every lane */
+    for(szptr lane = 0; lane < 3; lane++)
+    {
+        Vector<ImDrawVert> vertices(3, Vertex(1.f, 1.f, 0.5f, 0.5f));
+        vertices[lane].pos = ImVec2(10.35355f, 3.f + 2.12132f);
+
+        if(!Converts(vertices))
+            return false;
+    }
+
+    return QuantizeVertex(Vertex(0.1f, 1e7f, 0.f, 0.f), out) &&
+           out.pos.x == 0.1f && out.pos.y == 1e7f;
+}
+
+bool inexact_uvs()
+{
+    QuantVertex out;
+
+    for(szptr lane = 0; lane < 3; lane++)
+    {
+        Vector<ImDrawVert> vertices(3, Vertex(1.f, 1.f, 0.5f, 0.5f));
+        vertices[lane].uv.x = 1.f / 3.f;
+
+        if(Converts(vertices))
+            return false;
+
+        vertices[lane].uv = ImVec2(0.5f, 1.f / 65536.f);
+
+        if(Converts(vertices))
+            return false;
+    }
+
+    return !QuantizeVertex(Vertex(0.f, 0.f, 0.3f, 0.f), out);
+}
+
+bool out_of_range()
+{
+    const f32 nan = std::numeric_limits<f32>::quiet_NaN();
+
+    return !Converts({Vertex(0.f, 0.f, 2.f, 0.f), Vertex(0, 0, 0, 0)}) &&
+           !Converts({Vertex(0.f, 0.f, -0.5f, 0.f), Vertex(0, 0, 0, 0)}) &&
+           !Converts({Vertex(0.f, 0.f, nan, 0.f), Vertex(0, 0, 0, 0)}) &&
+           !Converts({Vertex(0.f, 0.f, 0.f, nan)});
+}
+
+/* Frames tried out of the next `frames` */
+static u32 Attempts(QuantizeBackoff& backoff, u32 frames, bool quantized)
+{
+    u32 tried = 0;
+
+    for(u32 i = 0; i < frames; i++)
+        if(backoff.attempt())
+        {
+            backoff.update(quantized);
+            tried++;
+        }
+
+    return tried;
+}
+
+bool backoff()
+{
+    QuantizeBackoff backoff;
+
+    /* Every frame while they quantise */
+    if(Attempts(backoff, 10, true) != 10)
+        return false;
+
+    /* Fallbacks at 0, 2, 5, 10, 19 and 36 */
+    if(Attempts(backoff, 37, false) != 6)
+        return false;
+
+    /* Capped, then tried once per quant_backoff_max + 1 frames */
+    Attempts(backoff, 4 * quant_backoff_max, false);
+
+    if(backoff.interval != quant_backoff_max ||
+       Attempts(backoff, 3 * (quant_backoff_max + 1), false) != 3)
+        return false;
+
+    /* A quantised frame resets it */
+    while(!backoff.attempt())
+        ;
+    backoff.update(true);
+
+    return Attempts(backoff, 10, true) == 10;
+}
+
+COFFEE_TESTS_BEGIN(5)
+
+    {exact_round_trip, "Quantised vertices read back unchanged"},
+    {any_position, "Positions off the pixel grid are quantised"},
+    {inexact_uvs, "UVs between steps are not quantised"},
+    {out_of_range, "Out of range and NaN UVs are not quantised"},
+    {backoff, "Repeated fallbacks are tried less often"}
+
+COFFEE_TESTS_END()
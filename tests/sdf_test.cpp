@@ -0,0 +1,99 @@
+#include <coffee/core/CUnitTesting>
+
+#include "imgui_sdf.h"
+
+using namespace Coffee;
+
+using CImGui::detail::GenerateSdf;
+using CImGui::detail::SdfScratch;
+
+static constexpr u32 size   = 24;
+static constexpr u32 spread = 4;
+
+/* An 8x8 solid square at (8, 8), as a rasterised glyph */
+static Vector<u8> SquareGlyph()
+{
+    Vector<u8> coverage(size * size, 0);
+
+    for(u32 y = 8; y < 16; y++)
+        for(u32 x = 8; x < 16; x++)
+            coverage[y * size + x] = 255;
+
+    return coverage;
+}
+
+static Vector<u8> Sdf(Vector<u8> const& coverage)
+{
+    Vector<u8> out(coverage.size());
+    GenerateSdf(coverage.data(), size, size, spread, out.data());
+    return out;
+}
+
+bool edge_straddles_half()
+{
+    auto sdf = Sdf(SquareGlyph());
+
+    /* Half a texel on either side of the edge */
+    for(u32 y = 8; y < 16; y++)
+    {
+        auto left  = sdf[y * size + 7];
+        auto right = sdf[y * size + 8];
+
+        if(left >= 128 || right <= 128 || left + right != 255)
+            return false;
+    }
+
+    return true;
+}
+
+bool known_distances()
+{
+    auto sdf = Sdf(SquareGlyph());
+
+    /* 3.5 texels inside, 0.5 + 3.5 / 8 */
+    if(sdf[12 * size + 11] != 239)
+        return false;
+
+    /* Beyond the spread on both sides */
+    return sdf[0] == 0 && sdf[12 * size + 2] == 0;
+}
+
+bool monotonic()
+{
+    auto sdf = Sdf(SquareGlyph());
+
+    for(u32 x = 1; x < 12; x++)
+        if(sdf[12 * size + x] < sdf[12 * size + x - 1])
+            return false;
+
+    return true;
+}
+
+bool scratch_reuse()
+{
+    auto glyph = SquareGlyph();
+    auto blank = Vector<u8>(size * size, 0);
+
+    SdfScratch scratch;
+    Vector<u8> out(glyph.size());
+
+    GenerateSdf(blank.data(), size, size, spread, out.data(), scratch);
+
+    const auto inside  = scratch.to_inside.data();
+    const auto outside = scratch.to_outside.data();
+
+    GenerateSdf(glyph.data(), size, size, spread, out.data(), scratch);
+
+    /* Same-sized bitmaps do not allocate, and do not see earlier ones */
+    return scratch.to_inside.data() == inside &&
+           scratch.to_outside.data() == outside && out == Sdf(glyph);
+}
+
+COFFEE_TESTS_BEGIN(4)
+
+    {edge_straddles_half, "Edge between inside and outside texels"},
+    {known_distances, "Distances of a square glyph"},
+    {monotonic, "Values grow towards the inside"},
+    {scratch_reuse, "Scratch buffers are reused"}
+
+COFFEE_TESTS_END()
@@ -0,0 +1,166 @@
+#include <coffee/core/CUnitTesting>
+#include <coffee/graphics/apis/CGLeamRHI>
+
+#include "imgui_stream_buffer.h"
+
+using namespace Coffee;
+
+using Allocator = CImGui::detail::StreamRingAllocator;
+
+static CImGui::StreamingConfig TestConfig(u32 frames_in_flight)
+{
+    CImGui::StreamingConfig config;
+    config.frames_in_flight   = frames_in_flight;
+    config.shrink_idle_frames = 0;
+    config.min_capacity       = 1024;
+    return config;
+}
+
+bool wrap_around()
+{
+    Allocator alloc(TestConfig(2));
+    alloc.reset(1024);
+
+    szptr offset = 0;
+
+    alloc.begin_frame(1);
+    if(!alloc.allocate(400, 1, offset) || offset != 0)
+        return false;
+    alloc.end_frame();
+
+    alloc.begin_frame(2);
+    if(!alloc.allocate(400, 1, offset) || offset != 400)
+        return false;
+    alloc.end_frame();
+
+    /* Frame 1 is retired, the next region does not fit behind frame 2 */
+    alloc.begin_frame(3);
+    if(!alloc.allocate(400, 1, offset) || offset != 0)
+        return false;
+
+    /* Wrapped, so only [0, 400) behind the head was free */
+    if(alloc.allocate(1, 1, offset))
+        return false;
+
+    return alloc.stats().wrap_count == 1;
+}
+
+bool fence_reuse()
+{
+    Allocator alloc(TestConfig(3));
+    alloc.reset(1024);
+
+    szptr offset = 0;
+
+    alloc.begin_frame(1);
+    if(!alloc.allocate(512, 1, offset))
+        return false;
+    alloc.end_frame();
+
+    alloc.begin_frame(2);
+    if(!alloc.allocate(512, 1, offset) || offset != 512)
+        return false;
+    alloc.end_frame();
+
+    /* Frame 1 may still be read */
+    alloc.begin_frame(3);
+    if(alloc.allocate(16, 1, offset))
+        return false;
+    alloc.end_frame();
+
+    alloc.begin_frame(4);
+    if(!alloc.allocate(256, 16, offset) || offset != 0)
+        return false;
+    alloc.end_frame();
+
+    return alloc.in_flight_bytes() == 512 + 256;
+}
+
+bool alignment()
+{
+    Allocator alloc(TestConfig(2));
+    alloc.reset(1024);
+
+    szptr offset = 0;
+
+    alloc.begin_frame(1);
+    if(!alloc.allocate(3, 1, offset) || offset != 0)
+        return false;
+    if(!alloc.allocate(20, 20, offset) || offset != 20)
+        return false;
+
+    return true;
+}
+
+bool growth()
+{
+    Allocator alloc(TestConfig(3));
+    szptr     offset = 0;
+
+    alloc.begin_frame(1);
+    if(alloc.allocate(1000, 1, offset))
+        return false;
+
+    /* Room for the frame times the frames in flight */
+    const szptr capacity = alloc.grow_capacity(1000);
+    if(capacity < 3000 || capacity < alloc.config().min_capacity)
+        return false;
+
+    alloc.reset(capacity);
+    if(!alloc.allocate(1000, 1, offset) || offset != 0)
+        return false;
+
+    return alloc.stats().grow_count == 1 && alloc.capacity() == capacity;
+}
+
+bool shrink()
+{
+    auto config               = TestConfig(2);
+    config.shrink_idle_frames = 4;
+
+    Allocator alloc(config);
+    alloc.reset(64 * 1024);
+
+    szptr offset = 0;
+
+    for(u64 frame = 1; frame <= 4; frame++)
+    {
+        alloc.begin_frame(frame);
+        alloc.allocate(100, 1, offset);
+        alloc.end_frame();
+    }
+
+    return alloc.pending_capacity() == config.min_capacity;
+}
+
+bool null_api_ring()
+{
+    RHI::NullAPI::BUF_A buffer(RSCA::Streaming | RSCA::WriteOnly, 0);
+
+    CImGui::detail::StreamRing<RHI::NullAPI::BUF_A> ring(buffer);
+    ring.configure(TestConfig(2));
+
+    const Vector<u8> data(3000, 0xFF);
+
+    ring.begin_frame(1);
+    const auto first  = ring.upload(data.data(), data.size(), 1);
+    const auto second = ring.upload(data.data(), 100, 4);
+    ring.end_frame();
+
+    auto const& alloc = ring.allocator();
+
+    return first == 0 && second == 3000 && alloc.capacity() == 8192 &&
+           alloc.stats().grow_count == 1 &&
+           alloc.stats().frame_bytes == 3100;
+}
+
+COFFEE_TESTS_BEGIN(6)
+
+    {wrap_around, "Wrap-around behind the oldest region"},
+    {fence_reuse, "Regions are reused once out of flight"},
+    {alignment, "Aligned offsets"},
+    {growth, "Growth to the frames in flight"},
+    {shrink, "Shrinking after idle frames"},
+    {null_api_ring, "Uploads through a NullAPI buffer"}
+
+COFFEE_TESTS_END()